@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ts2cpp
+{
+    // Simple bump allocator. Memory is handed out from large blocks and is only ever released all at once, either when the
+    // arena is destroyed or reset. Destructors are never run, so only trivially destructible types may be created in an arena
+    struct arena
+    {
+        arena() = default;
+        arena(const arena&) = delete;
+        arena& operator=(const arena&) = delete;
+
+        ~arena()
+        {
+            while (head)
+            {
+                auto next = head->next;
+                ::operator delete(head);
+                head = next;
+            }
+        }
+
+        // Releases everything allocated so far. One regular sized block is kept around so that an arena that gets reset and
+        // refilled with a similar amount of data over and over again doesn't keep going back to the heap
+        void reset() noexcept
+        {
+            block* keep = nullptr;
+            while (head)
+            {
+                auto next = head->next;
+                if (!keep && (head->size == default_block_size))
+                {
+                    keep = head;
+                }
+                else
+                {
+                    --block_count;
+                    bytes_reserved -= head->size;
+                    ::operator delete(head);
+                }
+                head = next;
+            }
+
+            head = keep;
+            block_pos = nullptr;
+            block_remaining = 0;
+            if (keep)
+            {
+                keep->next = nullptr;
+                block_pos = reinterpret_cast<char*>(keep) + header_size;
+                block_remaining = default_block_size - header_size;
+            }
+        }
+
+        void* allocate(std::size_t size, std::size_t align)
+        {
+            assert((align & (align - 1)) == 0);
+            auto pos = align_up(reinterpret_cast<std::uintptr_t>(block_pos), align);
+            auto padding = static_cast<std::size_t>(pos - reinterpret_cast<std::uintptr_t>(block_pos));
+            if (!block_pos || (padding + size > block_remaining))
+            {
+                return allocate_slow(size, align);
+            }
+
+            block_pos += padding + size;
+            block_remaining -= padding + size;
+            return reinterpret_cast<void*>(pos);
+        }
+
+        template <typename T>
+        T* allocate_array(std::size_t count)
+        {
+            static_assert(std::is_trivially_destructible_v<T>, "Arena allocated types are never destroyed");
+            return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        }
+
+        template <typename T, typename... Args>
+        T* make(Args&&... args)
+        {
+            static_assert(std::is_trivially_destructible_v<T>, "Arena allocated types are never destroyed");
+            return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        // Statistics, mostly useful for diagnosing memory usage
+        std::size_t block_count = 0;
+        std::size_t bytes_reserved = 0;
+
+    private:
+        struct block
+        {
+            block* next;
+            std::size_t size;
+        };
+
+        static constexpr std::size_t default_block_size = 64 * 1024;
+        static constexpr std::size_t header_size =
+            (sizeof(block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+        static std::uintptr_t align_up(std::uintptr_t value, std::size_t align) noexcept
+        {
+            return (value + (align - 1)) & ~static_cast<std::uintptr_t>(align - 1);
+        }
+
+        char* new_block(std::size_t size)
+        {
+            auto ptr = static_cast<block*>(::operator new(size));
+            ptr->size = size;
+            ++block_count;
+            bytes_reserved += size;
+            return reinterpret_cast<char*>(ptr) + header_size;
+        }
+
+        void* allocate_slow(std::size_t size, std::size_t align)
+        {
+            auto needed = header_size + size + align - 1;
+            if (needed > default_block_size / 4)
+            {
+                // Allocations that would take up a sizable portion of a block get a block of their own. It's linked in
+                // after the current block so that we can keep allocating out of the remainder of the current one
+                auto data = new_block(needed);
+                auto ptr = reinterpret_cast<block*>(data - header_size);
+                if (head)
+                {
+                    ptr->next = head->next;
+                    head->next = ptr;
+                }
+                else
+                {
+                    ptr->next = nullptr;
+                    head = ptr;
+                }
+
+                return reinterpret_cast<void*>(align_up(reinterpret_cast<std::uintptr_t>(data), align));
+            }
+
+            auto data = new_block(default_block_size);
+            auto ptr = reinterpret_cast<block*>(data - header_size);
+            ptr->next = head;
+            head = ptr;
+            block_pos = data;
+            block_remaining = default_block_size - header_size;
+            return allocate(size, align);
+        }
+
+        block* head = nullptr;
+        char* block_pos = nullptr;
+        std::size_t block_remaining = 0;
+    };
+}
@@ -1,18 +1,28 @@
 #pragma once
 
-#include <map>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
 #include <optional>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <variant>
 #include <vector>
 
 namespace json
 {
     struct value;
+    struct decode_error; // json_decode.h
+    struct decoder;
 
-    enum class value_type
+    enum class value_type : std::uint8_t
     {
         null,
         boolean,
@@ -25,30 +35,417 @@ namespace json
     using null_t = std::nullptr_t;
     using boolean_t = bool;
     using number_t = double;
+    using integer_t = std::int64_t; // For numbers that ts2cpp was told are always integers
     using string_t = std::string;
     template <typename T = value> using array_t = std::vector<T>;
-    using object_t = std::map<string_t, value, std::less<>>;
+
+    // Associative container with string keys, stored as a contiguous array of key/value pairs in insertion order. JSON
+    // objects rarely have more than a handful of members, where a linear scan over contiguous memory beats chasing
+    // pointers through a tree. Once a map grows past 'index_threshold' entries, a hash index is kept alongside the array
+    // so that lookups stay constant time.
+    // NOTE: Unlike std::map, adding or removing entries invalidates references and iterators to existing entries
+    template <typename T>
+    class flat_map
+    {
+    public:
+        using key_type = string_t;
+        using mapped_type = T;
+        using value_type = std::pair<string_t, T>;
+        using size_type = std::size_t;
+        using iterator = typename std::vector<value_type>::iterator;
+        using const_iterator = typename std::vector<value_type>::const_iterator;
+
+        static constexpr size_type index_threshold = 16;
+
+        iterator begin() noexcept { return entries.begin(); }
+        const_iterator begin() const noexcept { return entries.begin(); }
+        iterator end() noexcept { return entries.end(); }
+        const_iterator end() const noexcept { return entries.end(); }
+
+        size_type size() const noexcept { return entries.size(); }
+        bool empty() const noexcept { return entries.empty(); }
+
+        void clear() noexcept
+        {
+            entries.clear();
+            fingerprints.clear();
+            buckets.clear();
+        }
+
+        void reserve(size_type count)
+        {
+            entries.reserve(count);
+            fingerprints.reserve(count);
+        }
+
+        iterator find(std::string_view key) noexcept { return entries.begin() + find_index(key); }
+        const_iterator find(std::string_view key) const noexcept { return entries.begin() + find_index(key); }
+        size_type count(std::string_view key) const noexcept { return (find_index(key) != entries.size()) ? 1 : 0; }
+
+        T& at(std::string_view key)
+        {
+            auto index = find_index(key);
+            if (index == entries.size()) throw std::out_of_range("flat_map::at");
+            return entries[index].second;
+        }
+        const T& at(std::string_view key) const { return const_cast<flat_map*>(this)->at(key); }
+
+        // NOTE: The key is only copied if it's not already present
+        T& operator[](std::string_view key)
+        {
+            auto index = find_index(key);
+            return (index != entries.size()) ? entries[index].second : append(string_t(key)).second;
+        }
+        T& operator[](string_t&& key) { return try_emplace(std::move(key)).first->second; }
+        T& operator[](const char* key) { return (*this)[std::string_view(key)]; }
+
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace(string_t key, Args&&... args)
+        {
+            auto index = find_index(key);
+            if (index != entries.size()) return { entries.begin() + index, false };
+
+            append(std::move(key), std::forward<Args>(args)...);
+            return { entries.end() - 1, true };
+        }
+
+        std::pair<iterator, bool> emplace(string_t key, T val) { return try_emplace(std::move(key), std::move(val)); }
+        std::pair<iterator, bool> insert(value_type entry) { return try_emplace(std::move(entry.first), std::move(entry.second)); }
+
+        iterator erase(const_iterator pos)
+        {
+            fingerprints.erase(fingerprints.begin() + (pos - entries.begin()));
+            auto result = entries.erase(pos);
+            if (!buckets.empty()) rebuild_index();
+            return result;
+        }
+
+        size_type erase(std::string_view key)
+        {
+            auto index = find_index(key);
+            if (index == entries.size()) return 0;
+            erase(entries.begin() + index);
+            return 1;
+        }
+
+    private:
+        template <typename... Args>
+        value_type& append(string_t key, Args&&... args)
+        {
+            // Skip the first few rounds of growth, which most objects would otherwise go through
+            if (entries.capacity() == 0) reserve(8);
+
+            fingerprints.push_back(fingerprint(key));
+            auto& result = entries.emplace_back(std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                std::forward_as_tuple(std::forward<Args>(args)...));
+            add_to_index(entries.size() - 1);
+            return result;
+        }
+
+        static std::size_t hash(std::string_view key) noexcept
+        {
+            return std::hash<std::string_view>{}(key);
+        }
+
+        // Length plus first and last character, which tells most keys apart without touching their text
+        static std::uint32_t fingerprint(std::string_view key) noexcept
+        {
+            if (key.empty()) return 0;
+            return (static_cast<std::uint32_t>(key.size()) << 16) |
+                (static_cast<std::uint32_t>(static_cast<unsigned char>(key.front())) << 8) |
+                static_cast<std::uint32_t>(static_cast<unsigned char>(key.back()));
+        }
+
+        size_type find_index(std::string_view key) const noexcept
+        {
+            if (buckets.empty())
+            {
+                // Scans a dense array of fingerprints, only comparing the keys themselves on a match
+                auto print = fingerprint(key);
+                for (size_type i = 0; i < fingerprints.size(); ++i)
+                {
+                    if ((fingerprints[i] == print) && (entries[i].first == key)) return i;
+                }
+
+                return entries.size();
+            }
+
+            // Open addressing with linear probing; each bucket holds an entry index plus one, with zero meaning empty
+            auto mask = buckets.size() - 1;
+            for (auto slot = hash(key) & mask; buckets[slot]; slot = (slot + 1) & mask)
+            {
+                auto index = buckets[slot] - 1;
+                if (entries[index].first == key) return index;
+            }
+
+            return entries.size();
+        }
+
+        void add_to_index(size_type index)
+        {
+            if (entries.size() <= index_threshold) return;
+
+            // Keep the table at most half full
+            if (entries.size() * 2 > buckets.size())
+            {
+                rebuild_index();
+                return;
+            }
+
+            insert_bucket(index);
+        }
+
+        void insert_bucket(size_type index)
+        {
+            auto mask = buckets.size() - 1;
+            auto slot = hash(entries[index].first) & mask;
+            while (buckets[slot]) slot = (slot + 1) & mask;
+            buckets[slot] = static_cast<std::uint32_t>(index + 1);
+        }
+
+        void rebuild_index()
+        {
+            buckets.clear();
+            if (entries.size() <= index_threshold) return;
+
+            size_type capacity = 64;
+            while (capacity < entries.size() * 4) capacity *= 2;
+            buckets.resize(capacity);
+            for (size_type i = 0; i < entries.size(); ++i)
+            {
+                insert_bucket(i);
+            }
+        }
+
+        std::vector<value_type> entries;
+        std::vector<std::uint32_t> fingerprints; // One per entry
+        std::vector<std::uint32_t> buckets; // Empty until the map is large enough to need it
+    };
+
+    using object_t = flat_map<value>;
 
     template <typename T>
     using optional_t = std::optional<T>;
 
-    struct value
+    // An optional-like view of a member whose presence is tracked by a bit in a 'presence' set, rather than by
+    // 'std::optional'. ts2cpp's compact layout hands these out from accessor functions named after each optional member
+    template <typename T>
+    struct optional_ref
     {
+        using value_type = std::remove_const_t<T>;
+        using bits_type = std::conditional_t<std::is_const_v<T>, const std::uint8_t, std::uint8_t>;
+
+        optional_ref(T& value, bits_type& bits, std::uint8_t mask) noexcept : ptr(&value), bits(&bits), mask(mask) {}
+
+        bool has_value() const noexcept { return (*bits & mask) != 0; }
+        explicit operator bool() const noexcept { return has_value(); }
+
+        T& operator*() const noexcept { return *ptr; }
+        T* operator->() const noexcept { return ptr; }
+
+        T& value() const
+        {
+            if (!has_value()) throw std::bad_optional_access();
+            return *ptr;
+        }
+
+        template <typename U>
+        value_type value_or(U&& fallback) const
+        {
+            return has_value() ? *ptr : static_cast<value_type>(std::forward<U>(fallback));
+        }
+
+        // NOTE: The old value is kept around when reset so that its memory can be reused
+        void reset() const noexcept { *bits &= ~mask; }
+
+        template <typename... Args>
+        T& emplace(Args&&... args) const
+        {
+            *ptr = value_type(std::forward<Args>(args)...);
+            *bits |= mask;
+            return *ptr;
+        }
+
+        template <typename U>
+        const optional_ref& operator=(U&& newValue) const
+        {
+            *ptr = std::forward<U>(newValue);
+            *bits |= mask;
+            return *this;
+        }
+
+        const optional_ref& operator=(std::nullopt_t) const noexcept
+        {
+            reset();
+            return *this;
+        }
+
+    private:
+        T* ptr;
+        bits_type* bits;
+        std::uint8_t mask;
+    };
+
+    // One bit per optional member of a generated struct, numbered in declaration order, set when the member has a value. Used by ts2cpp's compact
+    // layout in place of 'std::optional', whose flag costs as much as the value's alignment once padded
+    template <std::size_t Count>
+    struct presence
+    {
+        constexpr bool test(std::size_t index) const noexcept { return (bits[index / 8] & (1u << (index % 8))) != 0; }
+
+        constexpr void set(std::size_t index, bool value = true) noexcept
+        {
+            auto mask = static_cast<std::uint8_t>(1u << (index % 8));
+            if (value) bits[index / 8] |= mask;
+            else bits[index / 8] &= static_cast<std::uint8_t>(~mask);
+        }
+
         template <typename T>
-        value(T&& val) : data(std::forward<T>(val)) {}
+        optional_ref<T> ref(T& value, std::size_t index) noexcept
+        {
+            return { value, bits[index / 8], static_cast<std::uint8_t>(1u << (index % 8)) };
+        }
+
+        template <typename T>
+        optional_ref<const T> ref(const T& value, std::size_t index) const noexcept
+        {
+            return { value, bits[index / 8], static_cast<std::uint8_t>(1u << (index % 8)) };
+        }
+
+        std::uint8_t bits[(Count + 7) / 8] = {};
+    };
+
+    // Objects whose keys aren't known ahead of time, but whose values all have the same type (i.e. TypeScript's
+    // '{ [key: string]: T }')
+    template <typename T>
+    using map_t = flat_map<T>;
+
+    // A JSON value in 16 bytes: an 8 byte aligned payload followed by a type tag. Booleans and numbers are stored in the
+    // payload directly, as are strings of up to 'small_string_capacity' bytes. Longer strings, arrays, and objects live
+    // on the heap and the payload holds a pointer to them, so that the size of a value (and therefore the density of an
+    // array of them) doesn't depend on the size of the largest alternative.
+    // NOTE: Since short strings aren't 'std::string's, 'string()' returns a view. Use 'get<string_t>()' to modify a
+    // string in place, which moves it to the heap first if needed
+    struct value
+    {
+        static constexpr std::size_t small_string_capacity = 14;
+
+        value() noexcept = default;
+        value(null_t) noexcept {}
+        value(boolean_t val) noexcept : kind(value_type::boolean) { new (storage) boolean_t(val); }
+        value(number_t val) noexcept : kind(value_type::number) { new (storage) number_t(val); }
+
+        template <typename T, std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, int> = 0>
+        value(T val) noexcept : value(static_cast<number_t>(val)) {}
+
+        value(std::string_view val) { set_string(val); }
+        value(const char* val) { set_string(val); }
+        value(const string_t& val) { set_string(val); }
+        value(string_t&& val)
+        {
+            if (val.size() <= small_string_capacity) set_string(val);
+            else set_heap(value_type::string, new string_t(std::move(val)));
+        }
+
+        value(array_t<> val) { set_heap(value_type::array, new array_t<>(std::move(val))); }
+        value(object_t val) { set_heap(value_type::object, new object_t(std::move(val))); }
+
+        value(const value& other)
+        {
+            switch (other.kind)
+            {
+            case value_type::string:
+                if (other.is_small_string()) copy_bits(other);
+                else set_heap(value_type::string, new string_t(*other.heap<string_t>()));
+                break;
+            case value_type::array: set_heap(value_type::array, new array_t<>(*other.heap<array_t<>>())); break;
+            case value_type::object: set_heap(value_type::object, new object_t(*other.heap<object_t>())); break;
+            default: copy_bits(other); break;
+            }
+        }
+
+        value(value&& other) noexcept
+        {
+            copy_bits(other);
+            other.kind = value_type::null;
+        }
+
+        value& operator=(const value& other)
+        {
+            if (this != &other)
+            {
+                value copy(other);
+                *this = std::move(copy);
+            }
+            return *this;
+        }
+
+        value& operator=(value&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                copy_bits(other);
+                other.kind = value_type::null;
+            }
+            return *this;
+        }
+
+        ~value() { reset(); }
 
         value_type type() const noexcept
         {
-            return static_cast<value_type>(data.index());
+            return kind;
         }
 
-        template <typename T> T& get() { return std::get<T>(data); }
-        template <typename T> const T& get() const { return std::get<T>(data); }
+        // Returns a reference to the stored alternative, throwing 'std::bad_variant_access' if it has a different type.
+        // 'get<std::string_view>()' returns a view of a string however it's stored, the same as 'string()'
+        template <typename T>
+        std::conditional_t<std::is_same_v<T, std::string_view>, std::string_view, T&> get()
+        {
+            if constexpr (std::is_same_v<T, std::string_view>) return string();
+            else return get_alternative<T>();
+        }
+
+        // NOTE: A short string isn't stored as a 'string_t', and a const value can't move it to the heap to make one, so
+        // 'get<string_t>()' returns a copy here. Read strings through 'get<std::string_view>()' or 'string()' to avoid it
+        template <typename T>
+        std::conditional_t<std::is_same_v<T, std::string_view> || std::is_same_v<T, string_t>, T, const T&> get() const
+        {
+            if constexpr (std::is_same_v<T, std::string_view>) return string();
+            else if constexpr (std::is_same_v<T, string_t>) return string_t(string());
+            else return const_cast<value*>(this)->get_alternative<T>();
+        }
+
+        // Replaces the current value with a default constructed 'T' and returns a reference to it
+        template <typename T>
+        T& emplace()
+        {
+            reset();
+            if constexpr (std::is_same_v<T, null_t>)
+            {
+                return get<null_t>();
+            }
+            else if constexpr (std::is_same_v<T, boolean_t> || std::is_same_v<T, number_t>)
+            {
+                *this = T{};
+                return get<T>();
+            }
+            else
+            {
+                set_heap(type_of<T>(), new T());
+                return *heap<T>();
+            }
+        }
 
         boolean_t boolean() const { return get<boolean_t>(); }
         number_t number() const { return get<number_t>(); }
-        string_t& string() { return get<string_t>(); }
-        const string_t& string() const { return get<string_t>(); }
+        std::string_view string() const
+        {
+            check(value_type::string);
+            if (is_small_string()) return small_string();
+            return *heap<string_t>();
+        }
         array_t<>& array() { return get<array_t<>>(); }
         const array_t<>& array() const { return get<array_t<>>(); }
         object_t& object() { return get<object_t>(); }
@@ -82,13 +479,416 @@ namespace json
         value& operator[](std::string_view key) { return get(key); }
         const value& operator[](std::string_view key) const { return get(key); }
 
-        // NOTE: Order is such that 'value_type' correlates to the index
-        std::variant<
-            null_t,
-            boolean_t,
-            number_t,
-            string_t,
-            array_t<>,
-            object_t> data;
+    private:
+        // Marks a string whose contents live on the heap
+        static constexpr std::uint8_t heap_string = 0xFF;
+
+        template <typename T>
+        T& get_alternative()
+        {
+            check(type_of<T>());
+            if constexpr (std::is_same_v<T, string_t>)
+            {
+                if (is_small_string())
+                {
+                    auto str = new string_t(small_string());
+                    set_heap(value_type::string, str);
+                }
+            }
+
+            if constexpr (std::is_same_v<T, null_t>)
+            {
+                static null_t null = nullptr;
+                return null;
+            }
+            else if constexpr (std::is_same_v<T, string_t> || std::is_same_v<T, array_t<>> || std::is_same_v<T, object_t>)
+            {
+                return *heap<T>();
+            }
+            else
+            {
+                return *std::launder(reinterpret_cast<T*>(storage));
+            }
+        }
+
+        template <typename T>
+        static constexpr value_type type_of() noexcept
+        {
+            if constexpr (std::is_same_v<T, null_t>) return value_type::null;
+            else if constexpr (std::is_same_v<T, boolean_t>) return value_type::boolean;
+            else if constexpr (std::is_same_v<T, number_t>) return value_type::number;
+            else if constexpr (std::is_same_v<T, string_t>) return value_type::string;
+            else if constexpr (std::is_same_v<T, array_t<>>) return value_type::array;
+            else
+            {
+                static_assert(std::is_same_v<T, object_t>, "Not a JSON value type");
+                return value_type::object;
+            }
+        }
+
+        void check(value_type expected) const
+        {
+            if (kind != expected) throw std::bad_variant_access();
+        }
+
+        bool is_small_string() const noexcept { return small_size != heap_string; }
+
+        std::string_view small_string() const noexcept
+        {
+            return { reinterpret_cast<const char*>(storage), small_size };
+        }
+
+        template <typename T>
+        T* heap() const noexcept
+        {
+            return static_cast<T*>(*std::launder(reinterpret_cast<void* const*>(storage)));
+        }
+
+        void set_heap(value_type type, void* ptr) noexcept
+        {
+            kind = type;
+            small_size = heap_string;
+            new (storage) void*(ptr);
+        }
+
+        void set_string(std::string_view str)
+        {
+            if (str.size() <= small_string_capacity)
+            {
+                kind = value_type::string;
+                small_size = static_cast<std::uint8_t>(str.size());
+                std::memcpy(storage, str.data(), str.size());
+            }
+            else
+            {
+                set_heap(value_type::string, new string_t(str));
+            }
+        }
+
+        // Only valid when 'this' doesn't own anything
+        void copy_bits(const value& other) noexcept
+        {
+            std::memcpy(storage, other.storage, sizeof(storage));
+            small_size = other.small_size;
+            kind = other.kind;
+        }
+
+        void reset() noexcept
+        {
+            switch (kind)
+            {
+            case value_type::string: if (!is_small_string()) delete heap<string_t>(); break;
+            case value_type::array: delete heap<array_t<>>(); break;
+            case value_type::object: delete heap<object_t>(); break;
+            default: break;
+            }
+
+            kind = value_type::null;
+        }
+
+        alignas(8) unsigned char storage[small_string_capacity] = {};
+        std::uint8_t small_size = heap_string; // Length of a short string
+        value_type kind = value_type::null;
+    };
+
+    // JSON text that's kept exactly as it was received, and only parsed if something asks for its contents. Generated
+    // structs use this for members of type 'any', which tend to get forwarded or ignored rather than inspected. Decoding
+    // one costs a validation pass and a copy of its text, and encoding it again is another copy
+    // NOTE: 'get()' caches what it parses without any synchronization, so even through a const reference a 'raw_value'
+    // can't be read from several threads at once. Call 'get()' before sharing it, or guard it with a lock
+    struct raw_value
+    {
+        raw_value() = default;
+        raw_value(value val) : parsed(std::move(val)) {}
+
+        // Replaces the contents with 'json', which must hold exactly one valid JSON value. Invalid text is rejected here,
+        // leaving the contents as they were, rather than turning up when something calls 'get()'
+        // NOTE: Defined in json_decode.h, along with 'get()' and 'edit()'
+        inline bool assign(std::string_view json, decode_error* error = nullptr);
+
+        // The text as it was received. Empty if this holds a value that was built, or modified, in code
+        std::string_view text() const noexcept { return json_text; }
+
+        // The parsed value, if anything has parsed it yet
+        const value* cached() const noexcept { return parsed ? &*parsed : nullptr; }
+
+        // The value, which gets parsed on first use. Null if nothing has been assigned
+        inline const value& get() const;
+
+        // As above, but for modifying the value. This discards the original text, since it would no longer match
+        inline value& edit();
+
+    private:
+        friend struct decoder;
+
+        // For text that the decoder has already validated
+        void assign_validated(std::string_view json)
+        {
+            json_text.assign(json.data(), json.size());
+            parsed.reset();
+        }
+
+        std::string json_text;
+        mutable std::optional<value> parsed;
+    };
+
+    // Compile-time description of the types generated by ts2cpp. Generated code specializes 'reflection' for every
+    // struct and enum it emits:
+    //
+    //      Structs:    'names', 'keys', 'types', 'optional' and 'nullable' are std::arrays with one entry per member,
+    //                  in declaration order, and 'members' is a std::tuple of the corresponding pointers to member.
+    //                  'keys' holds each name already quoted, escaped, and followed by a colon, ready to be written out
+    //                  by an encoder. 'optional' members may be left out ('foo?: T'), while 'nullable' ones may be null
+    //                  ('foo: T | null'); a member can be both
+    //      Enums:      'names' holds the string for each enumerator; enumerators are numbered from zero
+    //
+    // Both may also have a perfect hash of their names: 'hash_seed', 'hash_positions' and 'hash_slots' (see 'find_name').
+    // Structs generated with the compact layout also have 'presence', a pointer to the 'json::presence' member that
+    // says which optional members have a value, with a bit per optional member (see 'details::presence_bit'); 'members'
+    // then points at the values themselves rather than at 'std::optional's
+    //
+    // Everything is constexpr, so serializers built on top of this get fully inlined per type
+    template <typename T>
+    struct reflection;
+
+    template <typename T, typename = void>
+    struct is_reflected : std::false_type {};
+
+    template <typename T>
+    struct is_reflected<T, std::void_t<decltype(reflection<T>::names)>> : std::true_type {};
+
+    template <typename T>
+    inline constexpr bool is_reflected_v = is_reflected<T>::value;
+
+    // The JSON shape of a generated member
+    enum class type_tag : std::uint8_t
+    {
+        any,
+        boolean,
+        number,
+        string,
+        enumeration,
+        object,
+        array,
+        map,
+        integer, // A number annotated with '@integer'
     };
+
+    namespace details
+    {
+        template <typename T> struct is_optional : std::false_type {};
+        template <typename T> struct is_optional<std::optional<T>> : std::true_type {};
+
+        template <typename T> struct is_array : std::false_type {};
+        template <typename T, typename Alloc> struct is_array<std::vector<T, Alloc>> : std::true_type {};
+
+        template <typename T> struct is_map : std::false_type {};
+        template <typename T> struct is_map<flat_map<T>> : std::true_type {};
+
+        template <typename T> inline constexpr bool dependent_false = false;
+
+        template <typename Info, typename = void>
+        struct has_presence : std::false_type {};
+
+        template <typename Info>
+        struct has_presence<Info, std::void_t<decltype(Info::presence)>> : std::true_type {};
+
+        // The bit in 'presence' for the member at 'index', i.e. how many optional members come before it
+        template <typename Info>
+        constexpr std::size_t presence_bit(std::size_t index) noexcept
+        {
+            std::size_t result = 0;
+            for (std::size_t i = 0; i < index; ++i) result += Info::optional[i] ? 1 : 0;
+            return result;
+        }
+
+        constexpr std::size_t round_up(std::size_t size, std::size_t alignment) noexcept
+        {
+            return (size + alignment - 1) / alignment * alignment;
+        }
+
+        template <typename T, typename Func, std::size_t... Indices>
+        constexpr void for_each_member(T& obj, Func& func, std::index_sequence<Indices...>)
+        {
+            using info = reflection<std::remove_const_t<T>>;
+            (func(info::names[Indices], obj.*std::get<Indices>(info::members)), ...);
+        }
+    }
+
+    // Invokes 'func(name, member)' for each member of a generated struct, in declaration order. With the compact layout,
+    // optional members are passed as their '<name>_value' whether or not they're present
+    template <typename T, typename Func>
+    constexpr void for_each_member(T& obj, Func&& func)
+    {
+        using info = reflection<std::remove_const_t<T>>;
+        details::for_each_member(obj, func, std::make_index_sequence<info::names.size()>{});
+    }
+
+    template <typename T>
+    constexpr std::string_view enum_name(T value) noexcept
+    {
+        static_assert(std::is_enum_v<T>);
+        return reflection<T>::names[static_cast<std::size_t>(value)];
+    }
+
+    namespace details
+    {
+        // The hash behind the perfect hash tables that ts2cpp generates. Only the length of the name and the characters
+        // at 'positions' (where the name is long enough) take part; ts2cpp picks the positions so that no two names in
+        // the set look the same, and then searches for a seed that gives every name its own slot
+        constexpr std::uint32_t name_hash(std::string_view name, std::uint32_t seed, const std::uint8_t* positions,
+            std::size_t positionCount) noexcept
+        {
+            auto hash = (seed ^ static_cast<std::uint32_t>(name.size())) * 0x01000193u;
+            for (std::size_t i = 0; i < positionCount; ++i)
+            {
+                auto pos = positions[i];
+                auto ch = (pos < name.size()) ? static_cast<unsigned char>(name[pos]) : 0u;
+                hash = (hash ^ ch) * 0x01000193u;
+            }
+
+            hash ^= hash >> 15;
+            hash *= 0x2C1B3C6Du;
+            hash ^= hash >> 12;
+            return hash;
+        }
+
+        template <typename Info, typename = void>
+        struct has_name_hash : std::false_type {};
+
+        template <typename Info>
+        struct has_name_hash<Info, std::void_t<decltype(Info::hash_slots)>> : std::true_type {};
+
+        // Index of 'name' within 'Info::names', or 'names.size()' if it isn't one of them
+        template <typename Info>
+        constexpr std::size_t find_name(std::string_view name) noexcept
+        {
+            if constexpr (has_name_hash<Info>::value)
+            {
+                auto hash = name_hash(name, Info::hash_seed, Info::hash_positions.data(), Info::hash_positions.size());
+                std::size_t index = Info::hash_slots[hash & (Info::hash_slots.size() - 1)];
+                return ((index < Info::names.size()) && (Info::names[index] == name)) ? index : Info::names.size();
+            }
+            else
+            {
+                for (std::size_t i = 0; i < Info::names.size(); ++i)
+                {
+                    if (Info::names[i] == name) return i;
+                }
+
+                return Info::names.size();
+            }
+        }
+    }
+
+    // Index of 'name' within 'reflection<T>::names', or 'names.size()' if it isn't one of them. With a generated perfect
+    // hash this is one hash of a few characters followed by a single comparison
+    template <typename T>
+    constexpr std::size_t find_name(std::string_view name) noexcept
+    {
+        return details::find_name<reflection<T>>(name);
+    }
+
+    // Describes how to tell apart the alternatives of a std::variant that ts2cpp generates for a family of messages,
+    // e.g. every interface that extends 'Request' and names its 'command'. Generated code specializes 'dispatch' with:
+    //
+    //      'key':      The member whose string value identifies the alternative
+    //      'names':    The value of 'key' for each alternative after the first. The first alternative is the base
+    //                  interface itself, which catches any value that isn't listed
+    //
+    // along with a perfect hash of 'names', as for 'reflection'
+    template <typename T>
+    struct dispatch;
+
+    template <typename T, typename = void>
+    struct is_dispatched : std::false_type {};
+
+    template <typename T>
+    struct is_dispatched<T, std::void_t<decltype(dispatch<T>::key)>> : std::true_type {};
+
+    template <typename T>
+    inline constexpr bool is_dispatched_v = is_dispatched<T>::value;
+
+    // Objects with more members than this are described as 'any', since validation tracks the members that it has seen
+    // with a fixed size bitset
+    inline constexpr std::size_t max_schema_members = 256;
+
+    // How a 'schema_type' checks a value. Where a type refers to 'schema_field's, they're the 'count' entries of 'fields'
+    // starting at 'first'
+    enum class schema_op : std::uint8_t
+    {
+        any,
+        null,
+        boolean,
+        number,
+        integer,
+        string,
+        enumeration, // One of the field names
+        object, // Fields are the members; others are allowed and ignored
+        array, // 'first' is the element type
+        map, // 'first' is the value type
+        nullable, // 'null' or 'first'
+        one_of, // Any one of the field types
+        dispatch, // The first field names the key and the type to fall back on; the rest map its values to types
+    };
+
+    // Marks a 'schema_type' whose field names have no perfect hash, and so get looked up with a binary search
+    inline constexpr std::uint32_t no_schema_hash = ~std::uint32_t(0);
+
+    struct schema_type
+    {
+        schema_op op;
+        std::uint32_t first;
+        std::uint32_t count;
+        std::uint32_t required; // Number of fields that aren't optional, for objects
+        std::uint32_t hash; // Index into 'hashes' for objects, enumerations, and dispatches
+    };
+
+    struct schema_field
+    {
+        std::uint32_t name; // Offset into 'strings'
+        std::uint32_t name_size;
+        std::uint32_t type;
+        bool optional;
+    };
+
+    // Perfect hash of the names of a type's fields (of all but the first for dispatches), as for the 'hash_*' members of
+    // 'reflection'. 'positions' and 'slots' are offsets into 'bytes', and each slot holds the index of a field. Unused
+    // slots hold zero, which is safe since a name that hashes there can't be the name of the first field
+    struct schema_hash
+    {
+        std::uint32_t seed;
+        std::uint32_t positions;
+        std::uint32_t position_count;
+        std::uint32_t slots;
+        std::uint32_t slot_count;
+    };
+
+    // The tables only refer to each other by index and offset, so they can be written out as is (see json_schema_image.h)
+    static_assert((sizeof(schema_type) == 20) && (sizeof(schema_field) == 16) && (sizeof(schema_hash) == 20));
+
+    // Tables that describe every type generated from one TypeScript file, for checking JSON against those types without
+    // decoding it (see json_validate.h). Generated code defines one per file in 'json::schemas', and the 'reflection' and
+    // 'dispatch' specializations it emits point into it with 'schema_table' and 'schema_index'
+    struct schema
+    {
+        constexpr std::string_view name(const schema_field& field) const noexcept
+        {
+            return std::string_view(strings + field.name, field.name_size);
+        }
+
+        const schema_type* types;
+        const schema_field* fields; // Sorted by name for each type that looks them up
+        const schema_hash* hashes;
+        const std::uint8_t* bytes;
+        const char* strings;
+    };
+
+    // Index of the alternative of 'T' that a message whose discriminating member has the value 'name' decodes as
+    template <typename T>
+    constexpr std::size_t find_alternative(std::string_view name) noexcept
+    {
+        auto index = details::find_name<dispatch<T>>(name);
+        return (index < dispatch<T>::names.size()) ? index + 1 : 0;
+    }
 }
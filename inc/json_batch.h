@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "json_decode.h"
+#include "json_document.h"
+#include "json_parse.h"
+#include "thread_pool.h"
+
+namespace json
+{
+    namespace details
+    {
+        // What each worker keeps from one message to the next. Only 'json::value' needs anything: the parser's structural
+        // index and scratch space get reused instead of being reallocated for every message
+        struct batch_worker
+        {
+            parser values;
+        };
+
+        template <typename T>
+        bool decode_batch_element(std::string_view text, T& out, batch_worker& worker, decode_error& error)
+        {
+            if constexpr (std::is_same_v<T, value>)
+            {
+                if (worker.values.parse(text, out)) return true;
+                error = worker.values.error;
+                return false;
+            }
+            else
+            {
+                return decode(text, out, &error);
+            }
+        }
+
+        // Calls 'decodeOne(worker, index, error)' for each of 'count' messages on the threads of 'pool', where 'worker'
+        // identifies the thread (see 'thread_pool::current_worker'). The messages are split into contiguous chunks,
+        // several per worker so that stealing evens out chunks that turn out to be slow
+        template <typename DecodeOne>
+        bool run_batch(ts2cpp::thread_pool& pool, std::size_t count, std::vector<decode_error>* errors,
+            DecodeOne decodeOne)
+        {
+            if (errors) errors->assign(count, decode_error{});
+
+            std::atomic<bool> failed{ false };
+            auto run = [&](std::size_t first, std::size_t last)
+            {
+                auto worker = pool.current_worker();
+                for (auto i = first; i < last; ++i)
+                {
+                    decode_error error;
+                    if (!decodeOne(worker, i, error))
+                    {
+                        failed.store(true, std::memory_order_relaxed);
+                        if (errors) (*errors)[i] = error;
+                    }
+                }
+            };
+
+            auto chunkSize = std::max<std::size_t>(1, count / (pool.size() * 8));
+            if (count <= chunkSize)
+            {
+                run(0, count);
+                return !failed.load();
+            }
+
+            for (std::size_t first = 0; first < count; first += chunkSize)
+            {
+                auto last = std::min(first + chunkSize, count);
+                pool.submit([&run, first, last] { run(first, last); });
+            }
+
+            pool.wait();
+            return !failed.load();
+        }
+    }
+
+    // Decodes independent messages, e.g. the bodies from 'split_messages', on the threads of 'pool'. 'out[i]' is decoded
+    // from 'bodies[i]', whatever order the work gets done in, and each worker reuses its own decoding state. Returns
+    // false if any message fails to decode; 'errors', if given, then has the error for each message (or a null message
+    // for those that succeeded).
+    // NOTE: This waits for everything that's been submitted to 'pool', so it must not be called from one of its workers
+    template <typename T>
+    bool decode_batch(ts2cpp::thread_pool& pool, const std::vector<std::string_view>& bodies, std::vector<T>& out,
+        std::vector<decode_error>* errors = nullptr)
+    {
+        out.resize(bodies.size());
+
+        // One extra for the calling thread, which is what 'current_worker' returns outside of the pool
+        std::vector<details::batch_worker> workers(pool.size() + 1);
+        return details::run_batch(pool, bodies.size(), errors, [&](std::size_t worker, std::size_t i, decode_error& error)
+        {
+            return details::decode_batch_element(bodies[i], out[i], workers[worker], error);
+        });
+    }
+
+    // Messages parsed by 'decode_batch' into 'json::element's. Each worker parses its share into a 'document' of its
+    // own, i.e. into its own arena, and the documents are kept here along with the elements so that nothing has to be
+    // copied once the work is done. Decoding another batch into the same 'document_batch' releases the previous one's
+    // elements but keeps the memory. Strings are views into the bodies, which have to outlive the batch
+    struct document_batch
+    {
+        const element& operator[](std::size_t index) const noexcept { return roots[index]; }
+        std::size_t size() const noexcept { return roots.size(); }
+
+        // Memory held by the workers' arenas, mostly useful for diagnosing memory usage
+        std::size_t bytes_reserved() const noexcept
+        {
+            std::size_t result = 0;
+            for (auto& doc : documents) result += doc->bytes_reserved();
+            return result;
+        }
+
+    private:
+        friend bool decode_batch(ts2cpp::thread_pool& pool, const std::vector<std::string_view>& bodies,
+            document_batch& out, std::vector<decode_error>* errors);
+
+        std::vector<element> roots;
+        std::vector<std::unique_ptr<document>> documents; // Indexed by worker
+    };
+
+    // As above, for messages that only need to be looked at. A message that fails to parse is left as null
+    inline bool decode_batch(ts2cpp::thread_pool& pool, const std::vector<std::string_view>& bodies,
+        document_batch& out, std::vector<decode_error>* errors = nullptr)
+    {
+        out.roots.assign(bodies.size(), element{});
+        out.documents.resize(pool.size() + 1);
+        for (auto& doc : out.documents)
+        {
+            if (doc) doc->reset();
+            else doc = std::make_unique<document>();
+        }
+
+        return details::run_batch(pool, bodies.size(), errors, [&](std::size_t worker, std::size_t i, decode_error& error)
+        {
+            auto& doc = *out.documents[worker];
+            if (doc.append(bodies[i], out.roots[i])) return true;
+            error = doc.error;
+            return false;
+        });
+    }
+}
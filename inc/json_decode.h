@@ -0,0 +1,929 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "json.h"
+
+namespace json
+{
+    // Where and why decoding failed. 'offset' is the byte offset into the input text
+    struct decode_error
+    {
+        std::size_t offset = 0;
+        const char* message = nullptr;
+    };
+
+    namespace details
+    {
+        inline void append_utf8(std::string& out, std::uint32_t codepoint)
+        {
+            if (codepoint < 0x80)
+            {
+                out.push_back(static_cast<char>(codepoint));
+            }
+            else if (codepoint < 0x800)
+            {
+                out.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+                out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+            }
+            else if (codepoint < 0x10000)
+            {
+                out.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+                out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+            }
+            else
+            {
+                out.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+                out.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+            }
+        }
+
+        struct text_validator;
+
+        // The rule for '@integer' numbers, shared by decoding and by validating a 'json::value': a whole number within
+        // the range of 'integer_t', however it's written ('2', '2.0' and '2e0' are all fine). Returns the error message,
+        // or null if 'number' was converted into 'out'
+        inline const char* to_integer(number_t number, integer_t& out) noexcept
+        {
+            if (number != std::trunc(number)) return "Expected an integer"; // Also catches NaN
+
+            // 2^63 is exactly representable, and is the first value that's out of range
+            if (!((number >= -9223372036854775808.0) && (number < 9223372036854775808.0))) return "Integer out of range";
+            out = static_cast<integer_t>(number);
+            return nullptr;
+        }
+    }
+
+    // Single pass, pull style decoder that reads JSON text directly into the types generated by ts2cpp, using their
+    // 'reflection' specializations to map keys to members. No 'json::value' tree is built; members whose TypeScript type
+    // is 'any' (or a union with no C++ equivalent) are 'raw_value's, which only get validated and copied. Keys that don't
+    // correspond to any member are skipped. Decoding into an object that already holds data reuses the memory held by
+    // its strings and vectors
+    struct decoder
+    {
+        // Guards against stack exhaustion on maliciously nested input
+        static constexpr int max_depth = 512;
+
+        decoder(std::string_view text) : begin(text.data()), current(text.data()), end(text.data() + text.size()) {}
+
+        template <typename T>
+        bool read(T& out)
+        {
+            skip_whitespace();
+            if constexpr (std::is_same_v<T, value>)
+            {
+                return read_value(out);
+            }
+            else if constexpr (std::is_same_v<T, raw_value>)
+            {
+                auto start = current;
+                if (!skip_value()) return false;
+                out.assign_validated(std::string_view(start, static_cast<std::size_t>(current - start)));
+                return true;
+            }
+            else if constexpr (std::is_same_v<T, null_t>)
+            {
+                return read_literal("null") || fail("Expected 'null'");
+            }
+            else if constexpr (std::is_same_v<T, boolean_t>)
+            {
+                return read_boolean(out);
+            }
+            else if constexpr (std::is_same_v<T, number_t>)
+            {
+                return read_number(out);
+            }
+            else if constexpr (std::is_same_v<T, integer_t>)
+            {
+                return read_integer(out);
+            }
+            else if constexpr (std::is_same_v<T, string_t>)
+            {
+                return read_string(out);
+            }
+            else if constexpr (details::is_optional<T>::value)
+            {
+                if (read_literal("null"))
+                {
+                    out.reset();
+                    return true;
+                }
+
+                if (!out) out.emplace();
+                return read(*out);
+            }
+            else if constexpr (details::is_array<T>::value)
+            {
+                return read_array(out);
+            }
+            else if constexpr (details::is_map<T>::value)
+            {
+                return read_map(out);
+            }
+            else if constexpr (std::is_enum_v<T>)
+            {
+                return read_enum(out);
+            }
+            else if constexpr (is_dispatched_v<T>)
+            {
+                return read_dispatched(out);
+            }
+            else if constexpr (is_reflected_v<T>)
+            {
+                return read_object(out);
+            }
+            else
+            {
+                static_assert(details::dependent_false<T>, "Type cannot be decoded from JSON");
+                return false;
+            }
+        }
+
+        // Consumes the next value without storing it anywhere. The value is still checked to be valid JSON, which is what
+        // lets a 'raw_value' be parsed later on without having to deal with errors
+        bool skip_value()
+        {
+            skip_whitespace();
+            if (current == end) return fail("Unexpected end of input");
+
+            switch (*current)
+            {
+            case '"':
+                return skip_string();
+
+            case '{':
+            case '[':
+            {
+                auto close = (*current == '{') ? '}' : ']';
+                if (!enter()) return false;
+                ++current;
+                skip_whitespace();
+                if ((current != end) && (*current == close))
+                {
+                    ++current;
+                    --depth;
+                    return true;
+                }
+
+                while (true)
+                {
+                    if (close == '}')
+                    {
+                        skip_whitespace();
+                        if (!skip_string() || !expect(':')) return false;
+                    }
+
+                    if (!skip_value()) return false;
+
+                    skip_whitespace();
+                    if (current == end) return fail("Unexpected end of input");
+                    else if (*current == close) break;
+                    else if (*current != ',') return fail((close == '}') ? "Expected ',' or '}'" : "Expected ',' or ']'");
+                    ++current;
+                }
+
+                ++current;
+                --depth;
+                return true;
+            }
+
+            case 't':
+                return read_literal("true") || fail("Invalid literal");
+            case 'f':
+                return read_literal("false") || fail("Invalid literal");
+            case 'n':
+                return read_literal("null") || fail("Invalid literal");
+
+            default:
+            {
+                number_t ignored;
+                return read_number(ignored);
+            }
+            }
+        }
+
+        // Succeeds only if nothing but whitespace remains
+        bool finish()
+        {
+            skip_whitespace();
+            return (current == end) || fail("Unexpected data after the end of the value");
+        }
+
+        decode_error error() const noexcept
+        {
+            return { static_cast<std::size_t>(error_position - begin), error_message };
+        }
+
+        const char* begin;
+        const char* current;
+        const char* end;
+        int depth = 0;
+
+        const char* error_message = nullptr;
+        const char* error_position = nullptr;
+
+    private:
+        friend struct details::text_validator; // Validation reuses the scanning primitives
+
+        bool fail(const char* message) noexcept
+        {
+            // Only the innermost failure is interesting
+            if (!error_message)
+            {
+                error_message = message;
+                error_position = current;
+            }
+
+            return false;
+        }
+
+        bool enter()
+        {
+            return (++depth <= max_depth) || fail("Maximum nesting depth exceeded");
+        }
+
+        void skip_whitespace() noexcept
+        {
+            while ((current != end) && ((*current == ' ') || (*current == '\n') || (*current == '\r') || (*current == '\t')))
+            {
+                ++current;
+            }
+        }
+
+        bool expect(char ch)
+        {
+            skip_whitespace();
+            if ((current == end) || (*current != ch))
+            {
+                switch (ch)
+                {
+                case ':': return fail("Expected ':'");
+                case '{': return fail("Expected '{'");
+                case '[': return fail("Expected '['");
+                default: return fail("Expected '\"'");
+                }
+            }
+
+            ++current;
+            return true;
+        }
+
+        bool read_literal(std::string_view literal) noexcept
+        {
+            if (static_cast<std::size_t>(end - current) < literal.size()) return false;
+            if (std::string_view(current, literal.size()) != literal) return false;
+            current += literal.size();
+            return true;
+        }
+
+        bool read_boolean(boolean_t& out)
+        {
+            if (read_literal("true")) out = true;
+            else if (read_literal("false")) out = false;
+            else return fail("Expected 'true' or 'false'");
+            return true;
+        }
+
+        // What 'scan_number' learned about the number it moved past
+        struct number_text
+        {
+            const char* begin;
+            const char* digits_end; // End of the integer part, or of the fraction if there is one
+            bool negative;
+            bool is_integer; // No fraction or exponent
+            int digits; // Digits in the integer part and fraction
+            int exponent; // Power of ten that the digits, read as an integer, get scaled by
+
+            // Reads the digits as an integer. Only exact for up to 19 digits
+            std::uint64_t magnitude() const noexcept
+            {
+                std::uint64_t result = 0;
+                for (auto pos = begin + negative; pos != digits_end; ++pos)
+                {
+                    if (*pos != '.') result = result * 10 + static_cast<std::uint64_t>(*pos - '0');
+                }
+                return result;
+            }
+
+            // Digits before the decimal point once leading zeros are skipped, so zero or less for values below one. Only
+            // meaningful for values that aren't zero
+            int scale() const noexcept
+            {
+                int zeros = 0;
+                for (auto pos = begin + negative; (pos != digits_end) && ((*pos == '0') || (*pos == '.')); ++pos)
+                {
+                    zeros += (*pos == '0');
+                }
+                return digits - zeros + exponent;
+            }
+        };
+
+        // Moves past a number, checking it against the JSON grammar (which is stricter than 'from_chars' about leading
+        // zeros, a leading '+', and digits around the '.'). Nothing gets converted here, so that long numbers, which go to
+        // 'from_chars' anyway, don't pay for it twice
+        bool scan_number(number_text& out)
+        {
+            // NOTE: Everything is kept in locals until the end, since stores through 'out' or to 'current' could alias
+            // the input as far as the compiler knows, which would force a reload for every character
+            auto pos = current;
+            auto last = end;
+            auto is_digit = [&] { return (pos != last) && (static_cast<unsigned char>(*pos - '0') <= 9); };
+
+            bool negative = (pos != last) && (*pos == '-');
+            if (negative) ++pos;
+
+            if (!is_digit()) return fail("Expected a number");
+            auto integerBegin = pos;
+            if (*pos == '0') ++pos;
+            else while (is_digit()) ++pos;
+            auto digits = static_cast<int>(pos - integerBegin);
+
+            bool isInteger = true;
+            int exponent = 0;
+            if ((pos != last) && (*pos == '.'))
+            {
+                ++pos;
+                isInteger = false;
+                if (!is_digit())
+                {
+                    current = pos;
+                    return fail("Invalid number");
+                }
+
+                auto fractionBegin = pos;
+                while (is_digit()) ++pos;
+                exponent = -static_cast<int>(pos - fractionBegin);
+                digits -= exponent;
+            }
+
+            auto digitsEnd = pos;
+            if ((pos != last) && ((*pos == 'e') || (*pos == 'E')))
+            {
+                ++pos;
+                isInteger = false;
+                bool negativeExponent = (pos != last) && (*pos == '-');
+                if ((pos != last) && ((*pos == '+') || (*pos == '-'))) ++pos;
+                if (!is_digit())
+                {
+                    current = pos;
+                    return fail("Invalid number");
+                }
+
+                int value = 0;
+                for (; is_digit(); ++pos)
+                {
+                    if (value < 100000) value = value * 10 + (*pos - '0');
+                }
+                exponent += negativeExponent ? -value : value;
+            }
+
+            out = { current, digitsEnd, negative, isInteger, digits, exponent };
+            current = pos;
+            return true;
+        }
+
+        bool read_number(number_t& out)
+        {
+            number_text text;
+            if (!scan_number(text)) return false;
+
+            // Up to 15 digits convert to a double exactly, as do powers of ten up to 10^22, in which case a single
+            // multiplication or division is correctly rounded (Clinger's fast path)
+            static constexpr number_t powers[] = {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+            };
+            if ((text.digits <= 15) && (text.exponent >= -22) && (text.exponent <= 22))
+            {
+                out = static_cast<number_t>(text.magnitude());
+                if (text.exponent < 0) out /= powers[-text.exponent];
+                else out *= powers[text.exponent];
+                if (text.negative) out = -out;
+                return true;
+            }
+
+            // Everything else goes to 'from_chars', which is correctly rounded (and, in current standard libraries, built
+            // on the Eisel-Lemire algorithm). The text is already known to be valid, so only range errors remain
+            auto [ptr, ec] = std::from_chars(text.begin, current, out);
+            if ((ec == std::errc::result_out_of_range) && (ptr == current) && (text.scale() <= 0))
+            {
+                // Too close to zero for a double, which rounds to zero the way 'strtod' and JavaScript do
+                out = text.negative ? -0.0 : 0.0;
+                return true;
+            }
+            if ((ec != std::errc{}) || (ptr != current))
+            {
+                current = text.begin;
+                return fail("Number too large for a double");
+            }
+
+            return true;
+        }
+
+        bool read_integer(integer_t& out)
+        {
+            number_text text;
+            if (!scan_number(text)) return false;
+
+            if (!text.is_integer)
+            {
+                // A fraction or exponent goes through a double, so beyond 2^53 the value is rounded to one that it can hold
+                current = text.begin;
+                number_t number;
+                if (!read_number(number)) return false;
+                if (auto message = details::to_integer(number, out))
+                {
+                    current = text.begin;
+                    return fail(message);
+                }
+                return true;
+            }
+            else if (text.digits <= 18)
+            {
+                auto magnitude = static_cast<integer_t>(text.magnitude());
+                out = text.negative ? -magnitude : magnitude;
+                return true;
+            }
+
+            auto [ptr, ec] = std::from_chars(text.begin, current, out);
+            if ((ec != std::errc{}) || (ptr != current))
+            {
+                current = text.begin;
+                return fail("Integer out of range");
+            }
+
+            return true;
+        }
+
+        bool read_hex4(std::uint32_t& out)
+        {
+            if (end - current < 4) return fail("Invalid escape sequence");
+
+            out = 0;
+            for (int i = 0; i < 4; ++i)
+            {
+                auto ch = *current++;
+                out <<= 4;
+                if ((ch >= '0') && (ch <= '9')) out |= static_cast<std::uint32_t>(ch - '0');
+                else if ((ch >= 'a') && (ch <= 'f')) out |= static_cast<std::uint32_t>(ch - 'a' + 10);
+                else if ((ch >= 'A') && (ch <= 'F')) out |= static_cast<std::uint32_t>(ch - 'A' + 10);
+                else return fail("Invalid escape sequence");
+            }
+
+            return true;
+        }
+
+        // Called with 'current' just past the backslash
+        bool read_escape(std::string& out)
+        {
+            if (current == end) return fail("Unexpected end of input");
+
+            switch (*current++)
+            {
+            case '"': out.push_back('"'); break;
+            case '\\': out.push_back('\\'); break;
+            case '/': out.push_back('/'); break;
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'u':
+            {
+                std::uint32_t codepoint;
+                if (!read_hex4(codepoint)) return false;
+
+                // Characters outside the BMP are encoded as a surrogate pair
+                if ((codepoint >= 0xD800) && (codepoint <= 0xDBFF))
+                {
+                    std::uint32_t low;
+                    if (!read_literal("\\u") || !read_hex4(low) || (low < 0xDC00) || (low > 0xDFFF))
+                    {
+                        return fail("Invalid surrogate pair");
+                    }
+
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+                else if ((codepoint >= 0xDC00) && (codepoint <= 0xDFFF))
+                {
+                    return fail("Invalid surrogate pair");
+                }
+
+                details::append_utf8(out, codepoint);
+                break;
+            }
+
+            default:
+                --current;
+                return fail("Invalid escape sequence");
+            }
+
+            return true;
+        }
+
+        // Reads a string into 'view' when possible. Strings that contain escape sequences need to be decoded, in which
+        // case the result gets written to 'scratch' and 'view' refers to it
+        bool read_string_view(std::string_view& view, std::string& scratch)
+        {
+            if (!expect('"')) return false;
+
+            auto start = current;
+            while ((current != end) && (*current != '"') && (*current != '\\'))
+            {
+                if (static_cast<unsigned char>(*current) < 0x20) return fail("Unescaped control character in string");
+                ++current;
+            }
+
+            if ((current != end) && (*current == '"'))
+            {
+                view = std::string_view(start, static_cast<std::size_t>(current - start));
+                ++current;
+                return true;
+            }
+
+            scratch.assign(start, current);
+            if (!read_string_tail(scratch)) return false;
+            view = scratch;
+            return true;
+        }
+
+        // Continues reading a string whose unescaped prefix is already in 'out', through the closing quote
+        bool read_string_tail(std::string& out)
+        {
+            while (current != end)
+            {
+                auto start = current;
+                while ((current != end) && (*current != '"') && (*current != '\\'))
+                {
+                    if (static_cast<unsigned char>(*current) < 0x20) return fail("Unescaped control character in string");
+                    ++current;
+                }
+
+                out.append(start, current);
+                if (current == end) break;
+                else if (*current++ == '"') return true;
+                else if (!read_escape(out)) return false;
+            }
+
+            return fail("Unterminated string");
+        }
+
+        bool read_string(string_t& out)
+        {
+            if (!expect('"')) return false;
+            out.clear();
+            return read_string_tail(out);
+        }
+
+        bool skip_string()
+        {
+            if (!expect('"')) return false;
+
+            std::string escaped; // Holds at most one character at a time, so never allocates
+            while (current != end)
+            {
+                auto ch = *current++;
+                if (ch == '"') return true;
+                else if (ch == '\\')
+                {
+                    escaped.clear();
+                    if (!read_escape(escaped)) return false;
+                }
+                else if (static_cast<unsigned char>(ch) < 0x20)
+                {
+                    --current;
+                    return fail("Unescaped control character in string");
+                }
+            }
+
+            return fail("Unterminated string");
+        }
+
+        // Shared by arrays, objects, and maps. 'func' is invoked with 'current' positioned at each element's value (or
+        // key for objects)
+        template <typename Func>
+        bool read_sequence(char open, char close, Func&& func)
+        {
+            if (!expect(open)) return false;
+            if (!enter()) return false;
+
+            skip_whitespace();
+            if ((current != end) && (*current == close))
+            {
+                ++current;
+                --depth;
+                return true;
+            }
+
+            while (true)
+            {
+                if (!func()) return false;
+
+                skip_whitespace();
+                if (current == end) return fail("Unexpected end of input");
+                else if (*current == close) break;
+                else if (*current != ',') return fail((close == '}') ? "Expected ',' or '}'" : "Expected ',' or ']'");
+                ++current;
+            }
+
+            ++current;
+            --depth;
+            return true;
+        }
+
+        template <typename T>
+        bool read_array(T& out)
+        {
+            // Existing elements get decoded into in place so that their memory can be reused
+            std::size_t count = 0;
+            bool result = read_sequence('[', ']', [&]
+            {
+                if (count == out.size()) out.emplace_back();
+                if constexpr (std::is_same_v<typename T::value_type, bool>)
+                {
+                    // The elements of 'std::vector<bool>' are proxies, which a 'bool&' can't bind to
+                    boolean_t element = false;
+                    if (!read(element)) return false;
+                    out[count++] = element;
+                    return true;
+                }
+                else
+                {
+                    return read(out[count++]);
+                }
+            });
+
+            out.resize(count);
+            return result;
+        }
+
+        template <typename T>
+        bool read_map(T& out)
+        {
+            out.clear();
+            std::string scratch;
+            return read_sequence('{', '}', [&]
+            {
+                std::string_view key;
+                if (!read_string_view(key, scratch) || !expect(':')) return false;
+
+                auto itr = out.find(key);
+                if (itr == out.end()) itr = out.emplace(std::string(key), typename T::mapped_type{}).first;
+                return read(itr->second);
+            });
+        }
+
+        template <typename T>
+        bool read_enum(T& out)
+        {
+            std::string_view str;
+            std::string scratch;
+            auto start = current;
+            if (!read_string_view(str, scratch)) return false;
+
+            auto index = find_name<T>(str);
+            if (index < reflection<T>::names.size())
+            {
+                out = static_cast<T>(index);
+                return true;
+            }
+
+            current = start;
+            return fail("Unknown enumeration value");
+        }
+
+        template <typename T, std::size_t Index>
+        bool read_field(T& out)
+        {
+            using info = reflection<T>;
+            if constexpr (details::has_presence<info>::value && info::optional[Index])
+            {
+                // With the compact layout 'null' clears the member's presence bit instead of resetting a std::optional
+                constexpr auto bit = details::presence_bit<info>(Index);
+                auto& present = out.*info::presence;
+                skip_whitespace();
+                present.set(bit, !read_literal("null"));
+                if (!present.test(bit)) return true;
+            }
+
+            return read(out.*std::get<Index>(info::members));
+        }
+
+        template <typename T, std::size_t... Indices>
+        bool read_member(T& out, std::size_t index, std::index_sequence<Indices...>)
+        {
+            bool result = false;
+            static_cast<void>(((index == Indices ? (result = read_field<T, Indices>(out), true) : false) || ...));
+            return result;
+        }
+
+        template <typename T, std::size_t Index>
+        void reset_field(T& out)
+        {
+            using info = reflection<T>;
+            if constexpr (details::has_presence<info>::value && info::optional[Index])
+            {
+                // The value is left alone so that its memory can be reused
+                (out.*info::presence).set(details::presence_bit<info>(Index), false);
+            }
+            else
+            {
+                out.*std::get<Index>(info::members) = {};
+            }
+        }
+
+        template <typename T, std::size_t... Indices>
+        void reset_member(T& out, std::size_t index, std::index_sequence<Indices...>)
+        {
+            static_cast<void>(((index == Indices ? (reset_field<T, Indices>(out), true) : false) || ...));
+        }
+
+        template <typename T>
+        bool read_object(T& out)
+        {
+            using info = reflection<T>;
+            constexpr auto count = info::names.size();
+            using indices = std::make_index_sequence<count>;
+
+            bool seen[count ? count : 1] = {};
+            std::string scratch;
+            auto start = current;
+            bool result = read_sequence('{', '}', [&]
+            {
+                std::string_view key;
+                if (!read_string_view(key, scratch) || !expect(':')) return false;
+
+                auto index = find_name<T>(key);
+                if (index == count) return skip_value();
+
+                seen[index] = true;
+                return read_member(out, index, indices{});
+            });
+
+            if (!result) return false;
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                if (seen[i]) continue;
+                else if (!info::optional[i])
+                {
+                    current = start;
+                    return fail("Object is missing a required member");
+                }
+
+                // Don't let values from a previous decode leak through
+                reset_member(out, i, indices{});
+            }
+
+            return true;
+        }
+
+        template <typename T, std::size_t... Indices>
+        bool read_alternative(T& out, std::size_t index, std::index_sequence<Indices...>)
+        {
+            // Decode into the alternative already held where possible so that its memory gets reused
+            bool result = false;
+            ((index == Indices ?
+                (result = read((out.index() == Indices) ? std::get<Indices>(out) : out.template emplace<Indices>()), true) :
+                false) || ...);
+            return result;
+        }
+
+        // Scans the object for its discriminating member, then rewinds and decodes the whole object as the alternative
+        // that the member's value names. Members ahead of the discriminator get skipped over once before being decoded
+        template <typename T>
+        bool read_dispatched(T& out)
+        {
+            using info = dispatch<T>;
+            auto start = current;
+            auto startDepth = depth;
+
+            std::size_t index = 0;
+            bool found = false;
+            std::string scratch;
+            bool result = read_sequence('{', '}', [&]
+            {
+                std::string_view key;
+                if (!read_string_view(key, scratch) || !expect(':')) return false;
+                if (key != info::key) return skip_value();
+
+                std::string_view name;
+                if (!read_string_view(name, scratch)) return false;
+                index = find_alternative<T>(name);
+                found = true;
+                return false; // Nothing more to look at
+            });
+
+            if (!result && !found) return false;
+
+            current = start;
+            depth = startDepth;
+            return read_alternative(out, index, std::make_index_sequence<std::variant_size_v<T>>{});
+        }
+
+        bool read_value(value& out)
+        {
+            if (current == end) return fail("Unexpected end of input");
+
+            switch (*current)
+            {
+            case '"':
+            {
+                // Short strings are stored inline, so decode to a view first rather than into a 'string_t'
+                std::string_view str;
+                std::string scratch;
+                if (!read_string_view(str, scratch)) return false;
+                out = str;
+                return true;
+            }
+
+            case '[':
+            {
+                auto& arr = out.emplace<array_t<>>();
+                return read_sequence('[', ']', [&] { return read(arr.emplace_back()); });
+            }
+
+            case '{':
+            {
+                auto& obj = out.emplace<object_t>();
+                std::string scratch;
+                return read_sequence('{', '}', [&]
+                {
+                    std::string_view key;
+                    if (!read_string_view(key, scratch) || !expect(':')) return false;
+                    return read(obj[std::string(key)]);
+                });
+            }
+
+            case 't':
+            case 'f':
+                return read_boolean(out.emplace<boolean_t>());
+
+            case 'n':
+                out.emplace<null_t>();
+                return read_literal("null") || fail("Invalid literal");
+
+            default:
+                return read_number(out.emplace<number_t>());
+            }
+        }
+    };
+
+    inline bool raw_value::assign(std::string_view json, decode_error* error)
+    {
+        decoder dec(json);
+        if (!dec.skip_value() || !dec.finish())
+        {
+            if (error) *error = dec.error();
+            return false;
+        }
+
+        assign_validated(json);
+        return true;
+    }
+
+    inline const value& raw_value::get() const
+    {
+        if (!parsed)
+        {
+            // The text was validated when it was assigned, so this can't fail
+            decoder dec(json_text);
+            if (!json_text.empty()) dec.read(parsed.emplace());
+            else parsed.emplace();
+        }
+
+        return *parsed;
+    }
+
+    inline value& raw_value::edit()
+    {
+        get();
+        json_text.clear();
+        return *parsed;
+    }
+
+    // Decodes 'text', which must hold exactly one JSON value, into 'out'. On failure 'out' is left partially decoded
+    template <typename T>
+    bool decode(std::string_view text, T& out, decode_error* error = nullptr)
+    {
+        decoder dec(text);
+        if (dec.read(out) && dec.finish())
+        {
+            return true;
+        }
+
+        if (error) *error = dec.error();
+        return false;
+    }
+}
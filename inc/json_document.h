@@ -0,0 +1,326 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "arena.h"
+#include "json.h"
+#include "json_parse.h"
+
+namespace json
+{
+    struct member;
+
+    // Read only view of the elements of an array or the members of an object within a 'document'
+    template <typename T>
+    struct range
+    {
+        const T* begin() const noexcept { return first; }
+        const T* end() const noexcept { return first + count; }
+        std::size_t size() const noexcept { return count; }
+        bool empty() const noexcept { return count == 0; }
+        const T& operator[](std::size_t index) const noexcept { return first[index]; }
+
+        const T* first = nullptr;
+        std::size_t count = 0;
+    };
+
+    // A value within a 'document'. Mirrors the read only parts of 'json::value', except that strings are returned as
+    // views. Elements are only valid for as long as the document that they came from, and its input text, are alive and
+    // the document hasn't been used to parse something else
+    struct element
+    {
+        value_type type() const noexcept { return kind; }
+
+        boolean_t boolean() const { check(value_type::boolean); return data.boolean; }
+        number_t number() const { check(value_type::number); return data.number; }
+        std::string_view string() const { check(value_type::string); return { data.string, size }; }
+        range<element> array() const { check(value_type::array); return { data.elements, size }; }
+        range<member> object() const { check(value_type::object); return { data.members, size }; }
+
+        const element& at(std::size_t index) const
+        {
+            auto arr = array();
+            if (index >= arr.size()) throw std::out_of_range("Array index out of range");
+            return arr[index];
+        }
+        const element& operator[](std::size_t index) const { return array()[index]; }
+
+        const element* try_get(std::string_view key) const;
+        const element& get(std::string_view key) const;
+        const element& operator[](std::string_view key) const { return get(key); }
+
+        // Makes an owning copy, e.g. for the parts of a message that need to outlive it
+        value to_value() const;
+
+        value_type kind = value_type::null;
+        std::uint32_t size = 0; // Length of a string, or the number of elements/members of an array/object
+        union
+        {
+            boolean_t boolean;
+            number_t number;
+            const char* string;
+            const element* elements;
+            const member* members;
+        } data{};
+
+    private:
+        void check(value_type expected) const
+        {
+            if (kind != expected) throw std::runtime_error("Element does not have the requested type");
+        }
+    };
+
+    struct member
+    {
+        std::string_view key;
+        element value;
+    };
+
+    inline const element* element::try_get(std::string_view key) const
+    {
+        // Search backwards so that, as with 'json::value', the last of any duplicate keys wins
+        auto obj = object();
+        for (auto i = obj.size(); i-- > 0; )
+        {
+            if (obj[i].key == key) return &obj[i].value;
+        }
+
+        return nullptr;
+    }
+
+    inline const element& element::get(std::string_view key) const
+    {
+        if (auto ptr = try_get(key))
+        {
+            return *ptr;
+        }
+
+        std::string msg = "Key '";
+        msg.append(key);
+        msg += "' is not present in the object";
+        throw std::runtime_error(std::move(msg));
+    }
+
+    inline value element::to_value() const
+    {
+        switch (kind)
+        {
+        case value_type::boolean: return data.boolean;
+        case value_type::number: return data.number;
+        case value_type::string: return std::string_view(data.string, size);
+
+        case value_type::array:
+        {
+            array_t<> result;
+            result.reserve(size);
+            for (auto& elem : array()) result.push_back(elem.to_value());
+            return result;
+        }
+
+        case value_type::object:
+        {
+            object_t result;
+            result.reserve(size);
+            for (auto& mem : object()) result[mem.key] = mem.value.to_value();
+            return result;
+        }
+
+        default:
+            return nullptr;
+        }
+    }
+
+    // Parsed JSON text, for messages that get inspected and then thrown away. Strings and keys are views into the input
+    // text, which must outlive the document; only strings that contain escape sequences get decoded, into the
+    // document's arena. Arrays and objects are laid out contiguously in the same arena, which is released all at once.
+    // Parsing with the same document again reuses its memory, so a document that's kept around for a stream of similar
+    // messages stops allocating altogether
+    struct document
+    {
+        document() = default;
+        document(const document&) = delete;
+        document& operator=(const document&) = delete;
+
+        bool parse(std::string_view text)
+        {
+            reset();
+            return append(text, root_element);
+        }
+
+        // Parses another message into the same arena without releasing anything, so that the elements from earlier
+        // calls stay valid. 'root' becomes the new message's top level element; 'root()' is left alone. Used by
+        // 'decode_batch' to give each worker a single arena for all of its messages
+        bool append(std::string_view text, element& root)
+        {
+            root = {};
+            error = {};
+            if (!index.build(text, error)) return false;
+
+            decoder dec(text);
+            details::index_cursor cursor(dec, index);
+            bool result = parse_value(cursor, root) && cursor.finish();
+            element_stack.clear();
+            member_stack.clear();
+            if (!result)
+            {
+                root = {};
+                error = dec.error();
+            }
+
+            return result;
+        }
+
+        // Releases everything that's been parsed, keeping a block of memory for what gets parsed next
+        void reset() noexcept
+        {
+            storage.reset();
+            root_element = {};
+        }
+
+        const element& root() const noexcept { return root_element; }
+
+        decode_error error;
+
+        // Memory held by the arena, mostly useful for diagnosing memory usage
+        std::size_t bytes_reserved() const noexcept { return storage.bytes_reserved; }
+
+    private:
+        bool parse_string(details::index_cursor& cursor, std::string_view& out)
+        {
+            bool isEscaped;
+            if (!cursor.string_bounds(out, isEscaped)) return false;
+            if (!isEscaped) return true;
+
+            // The decoder was left at the opening quote
+            if (!cursor.dec.read(scratch)) return false;
+            auto text = storage.allocate_array<char>(scratch.size());
+            std::memcpy(text, scratch.data(), scratch.size());
+            out = std::string_view(text, scratch.size());
+            return true;
+        }
+
+        // Children are accumulated on a stack that's shared by every level of nesting, and then copied to the arena
+        // once their count is known
+        template <typename T>
+        const T* pop_children(std::vector<T>& stack, std::size_t base, std::uint32_t& count)
+        {
+            count = static_cast<std::uint32_t>(stack.size() - base);
+            if (count == 0) return nullptr;
+
+            auto result = storage.allocate_array<T>(count);
+            std::memcpy(static_cast<void*>(result), stack.data() + base, count * sizeof(T));
+            stack.resize(base);
+            return result;
+        }
+
+        bool parse_value(details::index_cursor& cursor, element& out)
+        {
+            auto& dec = cursor.dec;
+            switch (cursor.next())
+            {
+            case '{':
+            {
+                if (!cursor.enter()) return false;
+
+                auto base = member_stack.size();
+                if (cursor.next() != '}')
+                {
+                    while (true)
+                    {
+                        member mem;
+                        if (!parse_string(cursor, mem.key)) return false;
+                        if (cursor.next() != ':') return cursor.fail("Expected ':'");
+                        ++cursor.pos;
+                        if (!parse_value(cursor, mem.value)) return false;
+                        member_stack.push_back(mem);
+
+                        auto ch = cursor.next();
+                        if (ch == '}') break;
+                        else if (ch != ',') return cursor.fail("Expected ',' or '}'");
+                        ++cursor.pos;
+                    }
+                }
+
+                cursor.leave();
+                out.kind = value_type::object;
+                out.data.members = pop_children(member_stack, base, out.size);
+                return true;
+            }
+
+            case '[':
+            {
+                if (!cursor.enter()) return false;
+
+                auto base = element_stack.size();
+                if (cursor.next() != ']')
+                {
+                    while (true)
+                    {
+                        element elem;
+                        if (!parse_value(cursor, elem)) return false;
+                        element_stack.push_back(elem);
+
+                        auto ch = cursor.next();
+                        if (ch == ']') break;
+                        else if (ch != ',') return cursor.fail("Expected ',' or ']'");
+                        ++cursor.pos;
+                    }
+                }
+
+                cursor.leave();
+                out.kind = value_type::array;
+                out.data.elements = pop_children(element_stack, base, out.size);
+                return true;
+            }
+
+            case '"':
+            {
+                std::string_view str;
+                if (!parse_string(cursor, str)) return false;
+                out.kind = value_type::string;
+                out.size = static_cast<std::uint32_t>(str.size());
+                out.data.string = str.data();
+                return true;
+            }
+
+            case 't':
+            case 'f':
+                out.kind = value_type::boolean;
+                return dec.read(out.data.boolean) && cursor.check_scalar_end();
+
+            case 'n':
+            {
+                null_t ignored;
+                out.kind = value_type::null;
+                return dec.read(ignored) && cursor.check_scalar_end();
+            }
+
+            case '\0':
+                if (dec.current == dec.end) return cursor.fail("Unexpected end of input");
+                return cursor.fail("Unexpected character");
+
+            case ']':
+            case '}':
+            case ':':
+            case ',':
+                return cursor.fail("Unexpected character");
+
+            default:
+                out.kind = value_type::number;
+                return dec.read(out.data.number) && cursor.check_scalar_end();
+            }
+        }
+
+        ts2cpp::arena storage;
+        structural_index index;
+        std::vector<element> element_stack;
+        std::vector<member> member_stack;
+        std::string scratch;
+        element root_element;
+    };
+}
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "json.h"
+
+namespace json
+{
+    // Appends JSON text for the types generated by ts2cpp to a caller supplied buffer. Member names come from the
+    // pre-escaped 'keys' in each type's 'reflection' specialization, and no intermediate 'json::value' is built. Clearing
+    // and reusing the same buffer for each message means that, once it has grown large enough, encoding doesn't allocate
+    struct encoder
+    {
+        encoder(std::string& buffer) : buffer(buffer) {}
+
+        template <typename T>
+        void write(const T& val)
+        {
+            if constexpr (std::is_same_v<T, value>)
+            {
+                write_value(val);
+            }
+            else if constexpr (std::is_same_v<T, raw_value>)
+            {
+                if (!val.text().empty()) buffer.append(val.text().data(), val.text().size());
+                else if (auto parsed = val.cached()) write_value(*parsed);
+                else buffer.append("null", 4);
+            }
+            else if constexpr (std::is_same_v<T, null_t>)
+            {
+                buffer.append("null", 4);
+            }
+            else if constexpr (std::is_same_v<T, boolean_t>)
+            {
+                if (val) buffer.append("true", 4);
+                else buffer.append("false", 5);
+            }
+            else if constexpr (std::is_same_v<T, number_t>)
+            {
+                write_number(val);
+            }
+            else if constexpr (std::is_same_v<T, integer_t>)
+            {
+                write_integer(val);
+            }
+            else if constexpr (std::is_same_v<T, string_t>)
+            {
+                write_string(val);
+            }
+            else if constexpr (details::is_optional<T>::value)
+            {
+                // Only reached for optional array elements and map values; optional members are omitted entirely
+                if (val) write(*val);
+                else buffer.append("null", 4);
+            }
+            else if constexpr (details::is_array<T>::value)
+            {
+                buffer.push_back('[');
+                for (auto&& element : val) // Not 'auto&', which can't bind the proxies of 'std::vector<bool>'
+                {
+                    write<typename T::value_type>(element);
+                    buffer.push_back(',');
+                }
+                close('[', ']');
+            }
+            else if constexpr (details::is_map<T>::value)
+            {
+                buffer.push_back('{');
+                for (auto& [key, element] : val)
+                {
+                    write_string(key);
+                    buffer.push_back(':');
+                    write(element);
+                    buffer.push_back(',');
+                }
+                close('{', '}');
+            }
+            else if constexpr (std::is_enum_v<T>)
+            {
+                write_string(enum_name(val));
+            }
+            else if constexpr (is_dispatched_v<T>)
+            {
+                std::visit([this](auto& alternative) { write(alternative); }, val);
+            }
+            else if constexpr (is_reflected_v<T>)
+            {
+                buffer.push_back('{');
+                write_members(val, std::make_index_sequence<reflection<T>::names.size()>{});
+                close('{', '}');
+            }
+            else
+            {
+                static_assert(details::dependent_false<T>, "Type cannot be encoded as JSON");
+            }
+        }
+
+        void write_string(std::string_view str)
+        {
+            static constexpr char hex[] = "0123456789abcdef";
+
+            buffer.push_back('"');
+            auto pos = str.data();
+            auto end = pos + str.size();
+            while (true)
+            {
+                // Copy everything up to the next character that needs escaping in one go
+                auto start = pos;
+                while ((pos != end) && (*pos != '"') && (*pos != '\\') && (static_cast<unsigned char>(*pos) >= 0x20))
+                {
+                    ++pos;
+                }
+
+                buffer.append(start, pos);
+                if (pos == end) break;
+
+                auto ch = *pos++;
+                switch (ch)
+                {
+                case '"': buffer.append("\\\"", 2); break;
+                case '\\': buffer.append("\\\\", 2); break;
+                case '\b': buffer.append("\\b", 2); break;
+                case '\f': buffer.append("\\f", 2); break;
+                case '\n': buffer.append("\\n", 2); break;
+                case '\r': buffer.append("\\r", 2); break;
+                case '\t': buffer.append("\\t", 2); break;
+                default:
+                {
+                    char escape[] = { '\\', 'u', '0', '0', hex[(ch >> 4) & 0xF], hex[ch & 0xF] };
+                    buffer.append(escape, sizeof(escape));
+                    break;
+                }
+                }
+            }
+            buffer.push_back('"');
+        }
+
+        void write_number(number_t val)
+        {
+            // JSON has no representation for infinities or NaN
+            if (!std::isfinite(val))
+            {
+                buffer.append("null", 4);
+                return;
+            }
+
+            // Most numbers are integers, which are much cheaper to format as such. The magnitude check keeps the conversion
+            // defined, and negative zero needs the '-' that only the floating point path writes
+            if ((std::abs(val) < 9007199254740992.0) && (val != 0 || !std::signbit(val)))
+            {
+                auto integer = static_cast<integer_t>(val);
+                if (static_cast<number_t>(integer) == val)
+                {
+                    write_integer(integer);
+                    return;
+                }
+            }
+
+            // Shortest representation that round trips
+            char text[32];
+            auto result = std::to_chars(text, text + sizeof(text), val);
+            buffer.append(text, result.ptr);
+        }
+
+        void write_integer(integer_t val)
+        {
+            char text[24];
+            auto result = std::to_chars(text, text + sizeof(text), val);
+            buffer.append(text, result.ptr);
+        }
+
+        std::string& buffer;
+
+    private:
+        // Containers write a trailing ',' after every element, which gets replaced by the closing character. This keeps
+        // the "is this the first element" check out of the loop
+        void close(char open, char closeChar)
+        {
+            if (buffer.back() == open) buffer.push_back(closeChar);
+            else buffer.back() = closeChar;
+        }
+
+        template <typename T>
+        void write_member(std::string_view key, const T& member)
+        {
+            buffer.append(key.data(), key.size());
+            write(member);
+            buffer.push_back(',');
+        }
+
+        // Optional members without a value are left out, while a required member that's nullable gets written as null
+        template <typename T, std::size_t Index>
+        void write_field(const T& obj)
+        {
+            using info = reflection<T>;
+            if constexpr (details::has_presence<info>::value && info::optional[Index])
+            {
+                if (!(obj.*info::presence).test(details::presence_bit<info>(Index))) return;
+            }
+
+            auto& member = obj.*std::get<Index>(info::members);
+            using member_type = std::remove_cv_t<std::remove_reference_t<decltype(member)>>;
+            if constexpr (details::is_optional<member_type>::value)
+            {
+                if (member) write_member(info::keys[Index], *member);
+                else if (!info::optional[Index]) write_member(info::keys[Index], null_t{});
+            }
+            else
+            {
+                write_member(info::keys[Index], member);
+            }
+        }
+
+        template <typename T, std::size_t... Indices>
+        void write_members(const T& obj, std::index_sequence<Indices...>)
+        {
+            (write_field<T, Indices>(obj), ...);
+        }
+
+        void write_value(const value& val)
+        {
+            switch (val.type())
+            {
+            case value_type::null: write(null_t{}); break;
+            case value_type::boolean: write(val.boolean()); break;
+            case value_type::number: write_number(val.number()); break;
+            case value_type::string: write_string(val.string()); break;
+            case value_type::array: write(val.array()); break;
+            case value_type::object: write(val.object()); break;
+            }
+        }
+    };
+
+    // Appends the JSON text for 'val' to 'buffer'
+    template <typename T>
+    void encode(const T& val, std::string& buffer)
+    {
+        encoder enc(buffer);
+        enc.write(val);
+    }
+}
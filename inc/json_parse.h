@@ -0,0 +1,430 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json.h"
+#include "json_decode.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define JSON_PARSE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace json
+{
+    namespace details
+    {
+        inline unsigned count_trailing_zeros(std::uint64_t value) noexcept
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index;
+            _BitScanForward64(&index, value);
+            return index;
+#else
+            return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+        }
+
+        // Bit 'i' of the result is the XOR of bits 0 through 'i' of 'bits'
+        inline std::uint64_t prefix_xor(std::uint64_t bits) noexcept
+        {
+            bits ^= bits << 1;
+            bits ^= bits << 2;
+            bits ^= bits << 4;
+            bits ^= bits << 8;
+            bits ^= bits << 16;
+            bits ^= bits << 32;
+            return bits;
+        }
+
+        // One bit per byte of a 64 byte block for each class of character that the structural index cares about
+        struct block_masks
+        {
+            std::uint64_t quote = 0;
+            std::uint64_t backslash = 0;
+            std::uint64_t op = 0; // '{', '}', '[', ']', ':', ','
+            std::uint64_t whitespace = 0;
+            std::uint64_t control = 0; // Anything below ' ', which must be escaped within strings
+        };
+
+#ifdef JSON_PARSE_SSE2
+        inline block_masks classify_block(const char* block) noexcept
+        {
+            auto quote = _mm_set1_epi8('"');
+            auto backslash = _mm_set1_epi8('\\');
+            auto colon = _mm_set1_epi8(':');
+            auto comma = _mm_set1_epi8(',');
+            auto space = _mm_set1_epi8(' ');
+            auto tab = _mm_set1_epi8('\t');
+            auto newline = _mm_set1_epi8('\n');
+            auto carriageReturn = _mm_set1_epi8('\r');
+            auto lastControl = _mm_set1_epi8(0x1F);
+
+            // NOTE: '[' and ']' are '{' and '}' with bit 0x20 cleared, and no other characters map onto them
+            auto caseBit = _mm_set1_epi8(0x20);
+            auto openCurly = _mm_set1_epi8('{');
+            auto closeCurly = _mm_set1_epi8('}');
+
+            block_masks result;
+            for (int i = 0; i < 4; ++i)
+            {
+                auto data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 16));
+                auto folded = _mm_or_si128(data, caseBit);
+                auto ops = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, openCurly), _mm_cmpeq_epi8(folded, closeCurly)),
+                    _mm_or_si128(_mm_cmpeq_epi8(data, colon), _mm_cmpeq_epi8(data, comma)));
+                auto ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(data, space), _mm_cmpeq_epi8(data, tab)),
+                    _mm_or_si128(_mm_cmpeq_epi8(data, newline), _mm_cmpeq_epi8(data, carriageReturn)));
+
+                auto shift = i * 16;
+                result.quote |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(data, quote)))) << shift;
+                result.backslash |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(data, backslash)))) << shift;
+                result.op |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm_movemask_epi8(ops))) << shift;
+                result.whitespace |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm_movemask_epi8(ws))) << shift;
+                result.control |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(
+                    _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(data, lastControl), lastControl)))) << shift;
+            }
+
+            return result;
+        }
+#else
+        inline block_masks classify_block(const char* block) noexcept
+        {
+            block_masks result;
+            for (int i = 0; i < 64; ++i)
+            {
+                auto bit = std::uint64_t(1) << i;
+                if (static_cast<unsigned char>(block[i]) < 0x20) result.control |= bit;
+                switch (block[i])
+                {
+                case '"': result.quote |= bit; break;
+                case '\\': result.backslash |= bit; break;
+                case '{': case '}': case '[': case ']': case ':': case ',': result.op |= bit; break;
+                case ' ': case '\t': case '\n': case '\r': result.whitespace |= bit; break;
+                default: break;
+                }
+            }
+
+            return result;
+        }
+#endif
+    }
+
+    // Offsets of every structural character in a JSON text: braces, brackets, colons, commas, the quotes around each
+    // string, and the first character of every other scalar. Found 64 bytes at a time using SIMD compares and bit
+    // manipulation, so string contents and whitespace are only looked at once. This is the first stage of both 'parser'
+    // and 'document'; the second stage walks the offsets to build a tree without having to scan for token boundaries
+    struct structural_index
+    {
+        // Only fails if the text is too large or a string contains an unescaped control character; everything else is
+        // left for the second stage to diagnose
+        bool build(std::string_view text, decode_error& error)
+        {
+            offsets.clear();
+            if (text.size() >= std::numeric_limits<std::uint32_t>::max())
+            {
+                error = { 0, "Input too large" };
+                return false;
+            }
+
+            offsets.reserve(text.size() / 4 + 2);
+
+            std::uint64_t prevInString = 0; // All ones if the previous block ended inside a string
+            std::uint64_t prevEscaped = 0; // 1 if the previous block ended with an unescaped backslash
+            std::uint64_t prevScalar = 0; // 1 if the last byte of the previous block was part of a scalar
+            std::uint64_t controlError = text.size();
+
+            char tail[64];
+            for (std::size_t offset = 0; offset < text.size(); offset += 64)
+            {
+                auto block = text.data() + offset;
+                if (text.size() - offset < 64)
+                {
+                    // Pad the final partial block with whitespace, which never produces an index
+                    std::memset(tail, ' ', sizeof(tail));
+                    std::memcpy(tail, block, text.size() - offset);
+                    block = tail;
+                }
+
+                auto masks = details::classify_block(block);
+
+                // Backslashes escape the character that follows, unless they are themselves escaped. Escapes are rare
+                // enough that walking the bits one at a time is cheaper than anything clever
+                auto escaped = prevEscaped;
+                prevEscaped = 0;
+                for (auto bits = masks.backslash & ~escaped; bits; )
+                {
+                    auto index = details::count_trailing_zeros(bits);
+                    if (index == 63)
+                    {
+                        prevEscaped = 1;
+                        break;
+                    }
+
+                    escaped |= std::uint64_t(2) << index;
+                    bits &= ~(std::uint64_t(3) << index);
+                }
+
+                // Each unescaped quote toggles whether we're inside a string. The mask includes the opening quote, but not
+                // the closing one
+                auto quotes = masks.quote & ~escaped;
+                auto inString = details::prefix_xor(quotes) ^ prevInString;
+                prevInString = static_cast<std::uint64_t>(static_cast<std::int64_t>(inString) >> 63);
+
+                // Scalars other than strings are runs of characters that are nothing else; only their first character is
+                // interesting
+                auto scalar = ~(masks.op | masks.whitespace | quotes | inString);
+                auto scalarStart = scalar & ~((scalar << 1) | prevScalar);
+                prevScalar = scalar >> 63;
+
+                // Control characters outside of strings show up as the start of an invalid scalar
+                if (auto control = masks.control & inString; control && (controlError == text.size()))
+                {
+                    controlError = offset + details::count_trailing_zeros(control);
+                }
+
+                auto structural = (masks.op & ~inString) | quotes | scalarStart;
+                while (structural)
+                {
+                    offsets.push_back(static_cast<std::uint32_t>(offset + details::count_trailing_zeros(structural)));
+                    structural &= structural - 1;
+                }
+            }
+
+            offsets.push_back(static_cast<std::uint32_t>(text.size()));
+
+            if (controlError != text.size())
+            {
+                error = { static_cast<std::size_t>(controlError), "Unescaped control character in string" };
+                return false;
+            }
+
+            return true;
+        }
+
+        // Followed by a sentinel equal to the length of the text
+        std::vector<std::uint32_t> offsets;
+    };
+
+    namespace details
+    {
+        // Steps through a 'structural_index' for the second stage of a parser. Scalars are read with a 'decoder' so
+        // that every parser accepts exactly the same grammar
+        struct index_cursor
+        {
+            index_cursor(decoder& dec, const structural_index& index) : dec(dec), pos(index.offsets.data()) {}
+
+            // Positions the decoder at the current structural character and returns it, or '\0' at the end of input
+            char next() noexcept
+            {
+                dec.current = dec.begin + *pos;
+                return (dec.current == dec.end) ? '\0' : *dec.current;
+            }
+
+            bool fail(const char* message)
+            {
+                if (!dec.error_message)
+                {
+                    dec.error_message = message;
+                    dec.error_position = dec.current;
+                }
+
+                return false;
+            }
+
+            bool enter()
+            {
+                ++pos;
+                return (++dec.depth <= decoder::max_depth) || fail("Maximum nesting depth exceeded");
+            }
+
+            void leave() noexcept
+            {
+                ++pos;
+                --dec.depth;
+            }
+
+            // Scalars (other than strings) must be followed by whitespace, a structural character, or the end of input
+            bool check_scalar_end()
+            {
+                auto end = dec.begin + pos[1];
+                for (auto ptr = dec.current; ptr != end; ++ptr)
+                {
+                    if ((*ptr != ' ') && (*ptr != '\t') && (*ptr != '\n') && (*ptr != '\r'))
+                    {
+                        dec.current = ptr;
+                        return fail("Invalid literal");
+                    }
+                }
+
+                ++pos;
+                return true;
+            }
+
+            // Finds the contents of the string at the current position, without the quotes. Both quotes are indexed, so
+            // the only scanning left to do is checking for escape sequences. Leaves the decoder at the opening quote so
+            // that escaped strings can be read with it, and then moves past the string
+            bool string_bounds(std::string_view& contents, bool& isEscaped)
+            {
+                if (next() != '"') return fail("Expected '\"'");
+
+                auto start = dec.current + 1;
+                auto end = dec.begin + pos[1];
+                if ((end == dec.end) || (*end != '"'))
+                {
+                    return fail("Unterminated string");
+                }
+
+                contents = std::string_view(start, static_cast<std::size_t>(end - start));
+                isEscaped = std::memchr(start, '\\', contents.size()) != nullptr;
+                pos += 2;
+                return true;
+            }
+
+            bool finish()
+            {
+                return ((next() == '\0') && (dec.current == dec.end)) || fail("Unexpected data after the end of the value");
+            }
+
+            decoder& dec;
+            const std::uint32_t* pos;
+        };
+    }
+
+    // Builds a 'json::value' from JSON text in two passes: a 'structural_index', followed by a walk over those offsets.
+    // Reusing the same parser for many documents reuses the memory for the index
+    struct parser
+    {
+        bool parse(std::string_view text, value& out)
+        {
+            error = {};
+            if (!index.build(text, error)) return false;
+
+            decoder dec(text);
+            details::index_cursor cursor(dec, index);
+            bool result = parse_value(cursor, out) && cursor.finish();
+            if (!result) error = dec.error();
+            return result;
+        }
+
+        decode_error error;
+        structural_index index;
+
+    private:
+        // 'out' refers either to the text or to 'scratch', so it must be used before the next string is parsed
+        bool parse_string(details::index_cursor& cursor, std::string_view& out)
+        {
+            bool isEscaped;
+            if (!cursor.string_bounds(out, isEscaped)) return false;
+            if (!isEscaped) return true;
+
+            // The decoder was left at the opening quote
+            if (!cursor.dec.read(scratch)) return false;
+            out = scratch;
+            return true;
+        }
+
+        bool parse_value(details::index_cursor& cursor, value& out)
+        {
+            auto& dec = cursor.dec;
+            switch (cursor.next())
+            {
+            case '{':
+            {
+                if (!cursor.enter()) return false;
+
+                auto& obj = out.emplace<object_t>();
+                if (cursor.next() != '}')
+                {
+                    std::string_view key;
+                    while (true)
+                    {
+                        if (!parse_string(cursor, key)) return false;
+                        if (cursor.next() != ':') return cursor.fail("Expected ':'");
+                        ++cursor.pos;
+                        if (!parse_value(cursor, obj[key])) return false;
+
+                        auto ch = cursor.next();
+                        if (ch == '}') break;
+                        else if (ch != ',') return cursor.fail("Expected ',' or '}'");
+                        ++cursor.pos;
+                    }
+                }
+
+                cursor.leave();
+                return true;
+            }
+
+            case '[':
+            {
+                if (!cursor.enter()) return false;
+
+                auto& arr = out.emplace<array_t<>>();
+                if (cursor.next() != ']')
+                {
+                    while (true)
+                    {
+                        if (!parse_value(cursor, arr.emplace_back())) return false;
+
+                        auto ch = cursor.next();
+                        if (ch == ']') break;
+                        else if (ch != ',') return cursor.fail("Expected ',' or ']'");
+                        ++cursor.pos;
+                    }
+                }
+
+                cursor.leave();
+                return true;
+            }
+
+            case '"':
+            {
+                std::string_view str;
+                if (!parse_string(cursor, str)) return false;
+                out = str;
+                return true;
+            }
+
+            case 't':
+            case 'f':
+                return dec.read(out.emplace<boolean_t>()) && cursor.check_scalar_end();
+
+            case 'n':
+                return dec.read(out.emplace<null_t>()) && cursor.check_scalar_end();
+
+            case '\0':
+                if (dec.current == dec.end) return cursor.fail("Unexpected end of input");
+                return cursor.fail("Unexpected character");
+
+            case ']':
+            case '}':
+            case ':':
+            case ',':
+                return cursor.fail("Unexpected character");
+
+            default:
+                return dec.read(out.emplace<number_t>()) && cursor.check_scalar_end();
+            }
+        }
+
+        std::string scratch; // Strings with escape sequences get decoded here
+    };
+
+    // Parses 'text', which must hold exactly one JSON value, into 'out'
+    inline bool parse(std::string_view text, value& out, decode_error* error = nullptr)
+    {
+        parser p;
+        if (p.parse(text, out)) return true;
+
+        if (error) *error = p.error;
+        return false;
+    }
+}
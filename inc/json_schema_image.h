@@ -0,0 +1,341 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "json.h"
+
+namespace json
+{
+    // A schema image is the 'json::schema' tables that ts2cpp generates for a file (see 'ts2cpp --image'), written out
+    // as is along with an index of the generated type names. Everything refers to everything else by offset or index,
+    // so a process can map the file and use the tables where they lie, without parsing the TypeScript again. Values are
+    // in the byte order of the machine that generated the image
+    inline constexpr char schema_image_magic[8] = { 'T', 'S', '2', 'C', 'P', 'P', 'S', 'I' };
+    inline constexpr std::uint32_t schema_image_version = 1;
+
+    // Returned by 'schema_image::find_type' for names that aren't in the image
+    inline constexpr std::uint32_t no_schema_type = ~std::uint32_t(0);
+
+    // 'count' entries starting 'offset' bytes into the image
+    struct schema_image_section
+    {
+        std::uint32_t offset;
+        std::uint32_t count;
+    };
+
+    struct schema_image_header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t size; // Of the whole image
+        schema_image_section types;
+        schema_image_section fields;
+        schema_image_section hashes;
+        schema_image_section names;
+        schema_image_section bytes;
+        schema_image_section strings;
+    };
+
+    // Index into 'types' of a generated type, e.g. "DebugProtocol::AnyProtocolMessage". Sorted by name
+    struct schema_image_name
+    {
+        std::uint32_t name; // Offset into 'strings'
+        std::uint32_t name_size;
+        std::uint32_t type;
+    };
+
+    static_assert((sizeof(schema_image_header) == 64) && (sizeof(schema_image_name) == 12));
+
+    // A schema image that's been loaded from memory or mapped from a file. Loading checks every index and offset in the
+    // tables, so that a damaged image can't make validation read out of bounds, but doesn't copy or allocate anything
+    struct schema_image
+    {
+        schema_image() = default;
+        schema_image(const schema_image&) = delete;
+        schema_image& operator=(const schema_image&) = delete;
+        schema_image(schema_image&& other) noexcept { swap(other); }
+        schema_image& operator=(schema_image&& other) noexcept
+        {
+            schema_image(std::move(other)).swap(*this);
+            return *this;
+        }
+
+        ~schema_image() { close(); }
+
+        // Uses an image that's already in memory, which must stay there and be aligned to at least 4 bytes
+        bool load(const void* image, std::size_t imageSize) noexcept
+        {
+            auto result = check(image, imageSize);
+            if (!result)
+            {
+                definition = {};
+                names = nullptr;
+                name_count = 0;
+            }
+
+            return result;
+        }
+
+        // Maps the file and loads it
+        bool open(const char* filename)
+        {
+            close();
+
+#ifdef _WIN32
+            auto file = ::CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE) return fail("Failed to open the schema image");
+
+            LARGE_INTEGER fileSize = {};
+            if (::GetFileSizeEx(file, &fileSize) && (fileSize.QuadPart > 0))
+            {
+                if (auto mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr))
+                {
+                    data = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                    ::CloseHandle(mapping); // The view keeps the mapping alive
+                    if (data) size = static_cast<std::size_t>(fileSize.QuadPart);
+                }
+            }
+
+            ::CloseHandle(file);
+#else
+            auto fd = ::open(filename, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return fail("Failed to open the schema image");
+
+            struct stat info = {};
+            if ((::fstat(fd, &info) == 0) && S_ISREG(info.st_mode) && (info.st_size > 0))
+            {
+                auto len = static_cast<std::size_t>(info.st_size);
+                auto view = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (view != MAP_FAILED)
+                {
+                    data = view;
+                    size = len;
+                }
+            }
+
+            ::close(fd);
+#endif
+
+            if (!data) return fail("Failed to map the schema image");
+            if (load(data, size)) return true;
+
+            auto message = error;
+            close();
+            error = message;
+            return false;
+        }
+
+        void close() noexcept
+        {
+            if (data)
+            {
+#ifdef _WIN32
+                ::UnmapViewOfFile(data);
+#else
+                ::munmap(const_cast<void*>(data), size);
+#endif
+            }
+
+            data = nullptr;
+            size = 0;
+            definition = {};
+            names = nullptr;
+            name_count = 0;
+            error = nullptr;
+        }
+
+        // Index into 'definition.types' of the generated type with the given qualified name, or 'no_schema_type'
+        std::uint32_t find_type(std::string_view name) const noexcept
+        {
+            auto last = names + name_count;
+            auto itr = std::lower_bound(names, last, name, [&](const schema_image_name& entry, std::string_view key)
+            {
+                return type_name(entry) < key;
+            });
+            return ((itr != last) && (type_name(*itr) == name)) ? itr->type : no_schema_type;
+        }
+
+        std::string_view type_name(const schema_image_name& entry) const noexcept
+        {
+            return std::string_view(definition.strings + entry.name, entry.name_size);
+        }
+
+        void swap(schema_image& other) noexcept
+        {
+            std::swap(data, other.data);
+            std::swap(size, other.size);
+            std::swap(definition, other.definition);
+            std::swap(names, other.names);
+            std::swap(name_count, other.name_count);
+            std::swap(error, other.error);
+        }
+
+        schema definition = {};
+        const schema_image_name* names = nullptr;
+        std::uint32_t name_count = 0;
+        const char* error = nullptr;
+
+        // Only set when the image was mapped by 'open'
+        const void* data = nullptr;
+        std::size_t size = 0;
+
+    private:
+        bool fail(const char* message) noexcept
+        {
+            error = message;
+            return false;
+        }
+
+        bool check(const void* image, std::size_t imageSize) noexcept
+        {
+            error = nullptr;
+            auto base = static_cast<const char*>(image);
+            if ((reinterpret_cast<std::uintptr_t>(base) % 4) != 0) return fail("Schema image is misaligned");
+            if (imageSize < sizeof(schema_image_header)) return fail("Schema image is truncated");
+
+            schema_image_header header;
+            std::memcpy(&header, base, sizeof(header));
+            if (std::memcmp(header.magic, schema_image_magic, sizeof(header.magic)) != 0)
+            {
+                return fail("Not a schema image");
+            }
+            if (header.version != schema_image_version) return fail("Unsupported schema image version or byte order");
+            if (header.size != imageSize) return fail("Schema image is truncated");
+
+            auto fits = [&](const schema_image_section& section, std::size_t entrySize)
+            {
+                return ((section.offset % 4) == 0) && (section.offset <= imageSize) &&
+                    (section.count <= (imageSize - section.offset) / entrySize);
+            };
+            if (!fits(header.types, sizeof(schema_type)) || !fits(header.fields, sizeof(schema_field)) ||
+                !fits(header.hashes, sizeof(schema_hash)) || !fits(header.names, sizeof(schema_image_name)) ||
+                !fits(header.bytes, 1) || !fits(header.strings, 1))
+            {
+                return fail("Schema image section is out of bounds");
+            }
+
+            definition.types = reinterpret_cast<const schema_type*>(base + header.types.offset);
+            definition.fields = reinterpret_cast<const schema_field*>(base + header.fields.offset);
+            definition.hashes = reinterpret_cast<const schema_hash*>(base + header.hashes.offset);
+            definition.bytes = reinterpret_cast<const std::uint8_t*>(base + header.bytes.offset);
+            definition.strings = base + header.strings.offset;
+            names = reinterpret_cast<const schema_image_name*>(base + header.names.offset);
+            name_count = header.names.count;
+
+            auto validString = [&](std::uint32_t offset, std::uint32_t length)
+            {
+                return (offset <= header.strings.count) && (length <= header.strings.count - offset);
+            };
+            auto validBytes = [&](std::uint32_t offset, std::uint32_t length)
+            {
+                return (offset <= header.bytes.count) && (length <= header.bytes.count - offset);
+            };
+
+            for (std::uint32_t i = 0; i < header.fields.count; ++i)
+            {
+                // Reading a bool that holds anything but 0 or 1 is undefined, so look at its byte first
+                auto& field = definition.fields[i];
+                unsigned char optional;
+                std::memcpy(&optional, &field.optional, 1);
+                if (!validString(field.name, field.name_size) || (field.type >= header.types.count) || (optional > 1))
+                {
+                    return fail("Schema image field is invalid");
+                }
+            }
+
+            for (std::uint32_t i = 0; i < header.hashes.count; ++i)
+            {
+                auto& hash = definition.hashes[i];
+                if (!validBytes(hash.positions, hash.position_count) || !validBytes(hash.slots, hash.slot_count) ||
+                    (hash.slot_count == 0) || ((hash.slot_count & (hash.slot_count - 1)) != 0))
+                {
+                    return fail("Schema image hash is invalid");
+                }
+            }
+
+            for (std::uint32_t i = 0; i < header.types.count; ++i)
+            {
+                if (!check_type(definition.types[i], header)) return fail("Schema image type is invalid");
+            }
+
+            for (std::uint32_t i = 0; i < name_count; ++i)
+            {
+                if (!validString(names[i].name, names[i].name_size) || (names[i].type >= header.types.count) ||
+                    ((i > 0) && !(type_name(names[i - 1]) < type_name(names[i]))))
+                {
+                    return fail("Schema image name is invalid");
+                }
+            }
+
+            return true;
+        }
+
+        bool check_type(const schema_type& type, const schema_image_header& header) const noexcept
+        {
+            switch (type.op)
+            {
+            case schema_op::any:
+            case schema_op::null:
+            case schema_op::boolean:
+            case schema_op::number:
+            case schema_op::integer:
+            case schema_op::string:
+                return true;
+
+            case schema_op::array:
+            case schema_op::map:
+            case schema_op::nullable:
+                return type.first < header.types.count;
+
+            case schema_op::enumeration:
+            case schema_op::object:
+            case schema_op::one_of:
+            case schema_op::dispatch:
+            {
+                if ((type.first > header.fields.count) || (type.count > header.fields.count - type.first)) return false;
+                bool isObject = (type.op == schema_op::object);
+                if (isObject && ((type.count > max_schema_members) || (type.required > type.count))) return false;
+                if ((type.op == schema_op::dispatch) && (type.count == 0)) return false;
+                if (type.hash == no_schema_hash) return true;
+
+                // Every slot has to land on one of the fields that gets hashed
+                std::uint32_t skip = (type.op == schema_op::dispatch) ? 1 : 0;
+                if ((type.op == schema_op::one_of) || (type.hash >= header.hashes.count) || (type.count == skip))
+                {
+                    return false;
+                }
+
+                auto& hash = definition.hashes[type.hash];
+                for (std::uint32_t i = 0; i < hash.slot_count; ++i)
+                {
+                    if (definition.bytes[hash.slots + i] >= type.count - skip) return false;
+                }
+                return true;
+            }
+            }
+
+            return false;
+        }
+    };
+}
@@ -0,0 +1,570 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <poll.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include "json_decode.h"
+#include "json_encode.h"
+
+namespace json
+{
+#ifdef _WIN32
+    using stream_handle = HANDLE;
+#else
+    using stream_handle = int;
+#endif
+
+    namespace details
+    {
+        // Reads whatever is available, up to 'capacity' bytes. Zero bytes means the other end closed the stream
+        inline bool read_some(stream_handle handle, char* dest, std::size_t capacity, std::size_t& bytesRead)
+        {
+#ifdef _WIN32
+            DWORD count = 0;
+            auto toRead = static_cast<DWORD>((capacity > MAXDWORD) ? MAXDWORD : capacity);
+            if (!::ReadFile(handle, dest, toRead, &count, nullptr))
+            {
+                // Reading from the end of a pipe is reported as an error
+                bytesRead = 0;
+                return ::GetLastError() == ERROR_BROKEN_PIPE;
+            }
+
+            bytesRead = count;
+            return true;
+#else
+            while (true)
+            {
+                auto count = ::read(handle, dest, capacity);
+                if (count >= 0)
+                {
+                    bytesRead = static_cast<std::size_t>(count);
+                    return true;
+                }
+                else if (errno != EINTR)
+                {
+                    return false;
+                }
+            }
+#endif
+        }
+
+        inline bool equals_ignore_case(std::string_view lhs, std::string_view rhs) noexcept
+        {
+            if (lhs.size() != rhs.size()) return false;
+            for (std::size_t i = 0; i < lhs.size(); ++i)
+            {
+                auto a = static_cast<unsigned char>(lhs[i]);
+                auto b = static_cast<unsigned char>(rhs[i]);
+                if (static_cast<unsigned>(a - 'A') < 26) a += 'a' - 'A';
+                if (static_cast<unsigned>(b - 'A') < 26) b += 'a' - 'A';
+                if (a != b) return false;
+            }
+
+            return true;
+        }
+
+        // Finds the Content-Length in a header, not including the blank line that ends it. Each line is "Name: value",
+        // and anything other than 'Content-Length', e.g. 'Content-Type', is ignored. Lengths above 'maxLength' are
+        // rejected before anything gets allocated for them. Returns an error message, if any
+        inline const char* parse_frame_header(std::string_view header, std::size_t maxLength, std::size_t& length,
+            std::size_t& errorOffset)
+        {
+            bool found = false;
+            std::size_t line = 0;
+            while (line < header.size())
+            {
+                auto lineEnd = header.find('\r', line);
+                if (lineEnd == std::string_view::npos) lineEnd = header.size();
+
+                errorOffset = line;
+                auto text = header.substr(line, lineEnd - line);
+                auto colon = text.find(':');
+                if (colon == std::string_view::npos) return "Expected ':' in message header";
+
+                if (equals_ignore_case(text.substr(0, colon), "Content-Length"))
+                {
+                    auto value = text.substr(colon + 1);
+                    while (!value.empty() && (value.front() == ' ')) value.remove_prefix(1);
+                    while (!value.empty() && (value.back() == ' ')) value.remove_suffix(1);
+
+                    auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), length);
+                    if (value.empty() || (ec != std::errc{}) || (ptr != value.data() + value.size()))
+                    {
+                        return "Invalid Content-Length";
+                    }
+                    if (length > maxLength) return "Content-Length exceeds the maximum message size";
+                    found = true;
+                }
+
+                line = lineEnd + 2; // Skip the "\r\n"
+            }
+
+            errorOffset = 0;
+            return found ? nullptr : "Message header has no Content-Length";
+        }
+    }
+
+    // Reads messages framed with "Content-Length: <n>\r\n\r\n" headers, as used by the Debug Adapter Protocol and the
+    // Language Server Protocol, from a pipe or socket. Each read asks for as much as the buffer has room for, so a burst
+    // of small messages (e.g. a flood of 'output' events) is usually picked up by a single call and then handed out one
+    // at a time without touching the stream again. Bodies are returned as views into the buffer, which is reused for the
+    // life of the reader; only a message that doesn't fit makes it grow
+    struct message_reader
+    {
+        static constexpr std::size_t default_capacity = 64 * 1024;
+        static constexpr std::size_t max_header_size = 4096;
+        static constexpr std::size_t default_max_message_size = 256 * 1024 * 1024;
+
+        message_reader(stream_handle handle, std::size_t capacity = default_capacity) :
+            handle(handle),
+            buffer(new char[capacity]),
+            capacity(capacity)
+        {
+        }
+
+        message_reader(const message_reader&) = delete;
+        message_reader& operator=(const message_reader&) = delete;
+
+        // Gets the body of the next message, which stays valid until the next call. Returns false at the end of the
+        // stream, in which case 'error.message' is null if the stream ended cleanly between two messages. Error offsets
+        // are from the start of the stream
+        bool next(std::string_view& body)
+        {
+            error = {};
+            while (true)
+            {
+                if ((body_size == npos) && !parse_header()) return false;
+
+                if ((body_size != npos) && (fill - body_begin >= body_size))
+                {
+                    body = std::string_view(buffer.get() + body_begin, body_size);
+                    consume(body_begin + body_size);
+                    return true;
+                }
+
+                if (!read_more()) return false;
+            }
+        }
+
+        // Reads the next message and decodes it into 'out'. Decoding errors have offsets from the start of the body.
+        // NOTE: A message that fails to decode is still consumed, so the stream stays in sync
+        template <typename T>
+        bool next(T& out)
+        {
+            std::string_view body;
+            return next(body) && decode(body, out, &error);
+        }
+
+        // Total number of bytes read from the stream so far, and the number of reads it took, mostly useful for checking
+        // how well reads are being batched
+        std::uint64_t bytes_read = 0;
+        std::uint64_t read_count = 0;
+
+        // Bodies larger than this fail with an error rather than growing the buffer to fit, so that a bad header from
+        // the peer can't exhaust memory
+        std::size_t max_message_size = default_max_message_size;
+
+        decode_error error;
+
+    private:
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        bool fail(std::size_t bufferOffset, const char* message)
+        {
+            error.offset = static_cast<std::size_t>(consumed + (bufferOffset - begin));
+            error.message = message;
+            return false;
+        }
+
+        // Looks for the blank line that ends the header, picking up from where the last attempt left off so that a
+        // header split across reads doesn't get rescanned. Returns true without setting 'body_size' if it hasn't all
+        // arrived yet
+        bool parse_header()
+        {
+            auto data = buffer.get();
+            auto pos = (scanned > begin + 3) ? scanned - 3 : begin;
+            auto terminator = npos;
+            while (pos + 4 <= fill)
+            {
+                auto ch = static_cast<const char*>(std::memchr(data + pos, '\r', fill - pos));
+                if (!ch) break;
+
+                pos = static_cast<std::size_t>(ch - data);
+                if ((pos + 4 <= fill) && (std::memcmp(ch, "\r\n\r\n", 4) == 0))
+                {
+                    terminator = pos;
+                    break;
+                }
+                ++pos;
+            }
+
+            if (terminator == npos)
+            {
+                scanned = fill;
+                if (fill - begin > max_header_size) return fail(begin, "Message header too long");
+                return true;
+            }
+
+            std::size_t errorOffset;
+            if (auto message = details::parse_frame_header(std::string_view(data + begin, terminator - begin),
+                max_message_size, body_size, errorOffset))
+            {
+                body_size = npos;
+                return fail(begin + errorOffset, message);
+            }
+
+            body_begin = terminator + 4;
+            return true;
+        }
+
+        // Everything before 'pos' has been handed out
+        void consume(std::size_t pos)
+        {
+            consumed += pos - begin;
+            begin = pos;
+            scanned = pos;
+            body_size = npos;
+        }
+
+        bool read_more()
+        {
+            // Make room at the end. A partial message is moved back to the front, but only once the tail gets short,
+            // so that the common case of a buffer that drains completely never copies anything
+            if (begin == fill)
+            {
+                scanned = 0;
+                fill = begin = 0;
+            }
+
+            auto needed = (body_size != npos) ? (body_begin - begin) + body_size : max_header_size + 1;
+            if ((capacity - fill < capacity / 4) || (capacity - begin < needed))
+            {
+                auto size = fill - begin;
+                if (capacity < needed)
+                {
+                    auto newCapacity = (capacity != 0) ? capacity : default_capacity;
+                    while (newCapacity < needed)
+                    {
+                        newCapacity = (newCapacity > npos / 2) ? needed : newCapacity * 2;
+                    }
+
+                    std::unique_ptr<char[]> newBuffer(new char[newCapacity]);
+                    std::memcpy(newBuffer.get(), buffer.get() + begin, size);
+                    buffer = std::move(newBuffer);
+                    capacity = newCapacity;
+                }
+                else
+                {
+                    std::memmove(buffer.get(), buffer.get() + begin, size);
+                }
+
+                if (body_size != npos) body_begin -= begin;
+                scanned -= begin;
+                fill = size;
+                begin = 0;
+            }
+
+            std::size_t count;
+            if (!details::read_some(handle, buffer.get() + fill, capacity - fill, count))
+            {
+                return fail(fill, "Failed to read from the stream");
+            }
+            else if (count == 0)
+            {
+                if (begin == fill) return false;
+                return fail(fill, "Unexpected end of stream");
+            }
+
+            fill += count;
+            bytes_read += count;
+            ++read_count;
+            return true;
+        }
+
+        stream_handle handle;
+        std::unique_ptr<char[]> buffer;
+        std::size_t capacity;
+        std::size_t begin = 0; // First byte that hasn't been handed out
+        std::size_t fill = 0; // End of the data read so far
+        std::size_t scanned = 0; // How far the search for the end of the header got
+        std::size_t body_begin = 0;
+        std::size_t body_size = npos; // Unknown until the header has been parsed
+        std::uint64_t consumed = 0; // Stream offset of 'begin'
+    };
+
+    // Splits text holding a sequence of framed messages, e.g. a recorded session that's been read or mapped into memory,
+    // into the bodies of those messages. Error offsets are from the start of 'text'
+    inline bool split_messages(std::string_view text, std::vector<std::string_view>& bodies, decode_error* error = nullptr)
+    {
+        auto fail = [&](std::size_t offset, const char* message)
+        {
+            if (error) *error = { offset, message };
+            return false;
+        };
+
+        std::size_t pos = 0;
+        while (pos < text.size())
+        {
+            auto terminator = text.find("\r\n\r\n", pos);
+            if (terminator == std::string_view::npos) return fail(pos, "Unexpected end of stream");
+
+            std::size_t length, errorOffset;
+            // NOTE: There's no limit on the length, since bodies are only ever views into 'text'
+            auto header = text.substr(pos, terminator - pos);
+            if (auto message = details::parse_frame_header(header, std::string_view::npos, length, errorOffset))
+            {
+                return fail(pos + errorOffset, message);
+            }
+
+            auto body = terminator + 4;
+            if (text.size() - body < length) return fail(text.size(), "Unexpected end of stream");
+            bodies.push_back(text.substr(body, length));
+            pos = body + length;
+        }
+
+        return true;
+    }
+
+    // Limits on how long 'message_writer' lets messages sit before sending them, and how much it lets pile up
+    struct writer_options
+    {
+        std::size_t max_batch_bytes = 64 * 1024; // Send once this much is waiting
+        std::chrono::microseconds max_delay{ 1000 }; // ...or once the oldest waiting message is this old
+        std::size_t max_pending_bytes = 1024 * 1024; // Block until the peer catches up beyond this
+    };
+
+    // Sends messages framed with "Content-Length: <n>\r\n\r\n" headers, the counterpart to 'message_reader'. Messages
+    // are encoded one after the other into a buffer that's reused, and go out in batches, many per 'writev' call. Each
+    // body is encoded after a gap that's large enough for any header, which then gets written right aligned into the
+    // gap, so nothing has to be moved once the length is known and each message is a single contiguous piece.
+    //
+    // There's no background thread: a batch is sent by the 'write' that fills it up or finds it overdue, so an event
+    // loop should call 'flush' (or 'flush_if_due') before it goes idle. A non-blocking handle only gets waited on for
+    // backpressure, i.e. once 'max_pending_bytes' have piled up; a blocking handle blocks in 'writev' regardless
+    struct message_writer
+    {
+        message_writer(stream_handle handle, const writer_options& options = {}) : handle(handle), options(options) {}
+
+        message_writer(const message_writer&) = delete;
+        message_writer& operator=(const message_writer&) = delete;
+
+        // NOTE: Any error is lost here, so flush explicitly to find out whether everything was sent
+        ~message_writer() { flush(); }
+
+        template <typename T>
+        bool write(const T& msg)
+        {
+            auto start = begin_message();
+            encode(msg, buffer);
+            return end_message(start);
+        }
+
+        // For bodies that are already JSON text
+        bool write_text(std::string_view body)
+        {
+            auto start = begin_message();
+            buffer.append(body.data(), body.size());
+            return end_message(start);
+        }
+
+        // Sends everything that's pending, waiting for the peer if need be
+        bool flush() { return send(true); }
+
+        // Sends the pending messages if the oldest has been waiting for longer than 'max_delay'. Meant to be called
+        // periodically, e.g. from an event loop's timeout
+        bool flush_if_due()
+        {
+            if (segments.empty() || (std::chrono::steady_clock::now() - batch_start < options.max_delay)) return true;
+            return send(false);
+        }
+
+        std::size_t pending_bytes() const noexcept { return pending; }
+
+        // Number of messages and system calls so far, mostly useful for checking how well writes are being batched
+        std::uint64_t message_count = 0;
+        std::uint64_t write_count = 0;
+
+        const char* error = nullptr;
+
+    private:
+        // "Content-Length: " plus up to 20 digits plus "\r\n\r\n"
+        static constexpr std::size_t header_capacity = 40;
+
+        // Messages per 'writev' call, which is the smallest IOV_MAX of the platforms we care about
+        static constexpr int max_vectors = 1024;
+
+        struct segment
+        {
+            std::size_t offset;
+            std::size_t size;
+        };
+
+        std::size_t begin_message()
+        {
+            if (segments.empty()) batch_start = std::chrono::steady_clock::now();
+            buffer.append(header_capacity, '\0');
+            return buffer.size();
+        }
+
+        bool end_message(std::size_t bodyStart)
+        {
+            char header[header_capacity];
+            std::memcpy(header, "Content-Length: ", 16);
+            auto result = std::to_chars(header + 16, header + sizeof(header), buffer.size() - bodyStart);
+            std::memcpy(result.ptr, "\r\n\r\n", 4);
+            auto headerSize = static_cast<std::size_t>(result.ptr + 4 - header);
+
+            auto offset = bodyStart - headerSize;
+            std::memcpy(&buffer[offset], header, headerSize);
+            segments.push_back({ offset, buffer.size() - offset });
+            pending += buffer.size() - offset;
+            ++message_count;
+
+            if ((pending >= options.max_batch_bytes) ||
+                (std::chrono::steady_clock::now() - batch_start >= options.max_delay))
+            {
+                if (!send(false)) return false;
+            }
+
+            // Backpressure: stop taking on more until the peer has caught up
+            return (pending <= options.max_pending_bytes) || send(true);
+        }
+
+        // Writes as much of what's pending as possible, in as few calls as possible. Without 'wait', gives up as soon as
+        // a non-blocking handle would block
+        bool send(bool wait)
+        {
+            while (next_segment < segments.size())
+            {
+                std::size_t count;
+                bool blocked;
+                if (!write_some(count, blocked)) return fail("Failed to write to the stream");
+
+                if (blocked)
+                {
+                    if (!wait) return true;
+                    if (!wait_writable()) return fail("Failed to write to the stream");
+                    continue;
+                }
+
+                ++write_count;
+                pending -= count;
+                while (count > 0)
+                {
+                    auto& seg = segments[next_segment];
+                    auto step = std::min(count, seg.size - segment_sent);
+                    segment_sent += step;
+                    count -= step;
+                    if (segment_sent == seg.size)
+                    {
+                        ++next_segment;
+                        segment_sent = 0;
+                    }
+                }
+            }
+
+            // Everything went out, so start over at the front of the buffer (keeping its memory)
+            buffer.clear();
+            segments.clear();
+            next_segment = 0;
+            return true;
+        }
+
+        bool write_some(std::size_t& count, bool& blocked)
+        {
+            blocked = false;
+#ifdef _WIN32
+            // There's no gather write for pipes, but each message is contiguous
+            auto& seg = segments[next_segment];
+            auto size = seg.size - segment_sent;
+            DWORD written = 0;
+            auto toWrite = static_cast<DWORD>((size > MAXDWORD) ? MAXDWORD : size);
+            if (!::WriteFile(handle, buffer.data() + seg.offset + segment_sent, toWrite, &written, nullptr)) return false;
+
+            count = written;
+            return true;
+#else
+            iovec vectors[max_vectors];
+            int vectorCount = 0;
+            for (auto i = next_segment; (i < segments.size()) && (vectorCount < max_vectors); ++i)
+            {
+                auto skip = (i == next_segment) ? segment_sent : 0;
+                vectors[vectorCount].iov_base = &buffer[segments[i].offset + skip];
+                vectors[vectorCount].iov_len = segments[i].size - skip;
+                ++vectorCount;
+            }
+
+            while (true)
+            {
+                auto result = ::writev(handle, vectors, vectorCount);
+                if (result >= 0)
+                {
+                    count = static_cast<std::size_t>(result);
+                    return true;
+                }
+                else if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                {
+                    blocked = true;
+                    return true;
+                }
+                else if (errno != EINTR)
+                {
+                    return false;
+                }
+            }
+#endif
+        }
+
+        bool wait_writable()
+        {
+#ifdef _WIN32
+            return true; // Writes to a HANDLE block
+#else
+            pollfd fd = { handle, POLLOUT, 0 };
+            while (::poll(&fd, 1, -1) < 0)
+            {
+                if (errno != EINTR) return false;
+            }
+            return true;
+#endif
+        }
+
+        bool fail(const char* message)
+        {
+            error = message;
+            return false;
+        }
+
+        stream_handle handle;
+        writer_options options;
+        std::string buffer;
+        std::vector<segment> segments; // Where each pending message is in 'buffer'
+        std::size_t next_segment = 0; // First message that hasn't been sent in full
+        std::size_t segment_sent = 0; // How much of it has been sent
+        std::size_t pending = 0;
+        std::chrono::steady_clock::time_point batch_start;
+    };
+}
@@ -0,0 +1,497 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#include "json.h"
+#include "json_decode.h"
+
+namespace json
+{
+    namespace details
+    {
+        // Limits how deeply validation recurses. Each level of nesting in the JSON takes only a few steps through a
+        // generated schema, so this only matters for a damaged schema image whose types refer back to themselves
+        inline constexpr int max_schema_nesting = 4 * decoder::max_depth;
+
+        // The field of 'type' named 'name', skipping the first 'skip' fields, or null if there isn't one
+        inline const schema_field* find_field(const schema& definition, const schema_type& type, std::string_view name,
+            std::uint32_t skip = 0)
+        {
+            auto first = definition.fields + type.first + skip;
+            if (type.hash != no_schema_hash)
+            {
+                auto& hash = definition.hashes[type.hash];
+                auto slot = name_hash(name, hash.seed, definition.bytes + hash.positions, hash.position_count) &
+                    (hash.slot_count - 1);
+                auto field = first + definition.bytes[hash.slots + slot];
+                return (definition.name(*field) == name) ? field : nullptr;
+            }
+
+            auto last = definition.fields + type.first + type.count;
+            auto itr = std::lower_bound(first, last, name, [&](const schema_field& field, std::string_view key)
+            {
+                return definition.name(field) < key;
+            });
+            return ((itr != last) && (definition.name(*itr) == name)) ? itr : nullptr;
+        }
+
+        // The members of an object that have been seen so far. Counting the required ones as they're first seen means
+        // that checking for missing members doesn't have to look at the fields again
+        struct member_set
+        {
+            void add(const schema_type& type, const schema_field* field, const schema_field* fields) noexcept
+            {
+                auto index = static_cast<std::size_t>(field - (fields + type.first));
+                auto bit = std::uint64_t(1) << (index % 64);
+                if (bits[index / 64] & bit) return;
+
+                bits[index / 64] |= bit;
+                if (!field->optional) ++required;
+            }
+
+            const char* missing(const schema_type& type) const noexcept
+            {
+                return (required == type.required) ? nullptr : "Object is missing a required member";
+            }
+
+            std::uint64_t bits[max_schema_members / 64] = {};
+            std::uint32_t required = 0;
+        };
+
+        inline void append_utf8(char* out, std::size_t& length, std::uint32_t codepoint)
+        {
+            if (codepoint < 0x80)
+            {
+                out[length++] = static_cast<char>(codepoint);
+            }
+            else if (codepoint < 0x800)
+            {
+                out[length++] = static_cast<char>(0xC0 | (codepoint >> 6));
+                out[length++] = static_cast<char>(0x80 | (codepoint & 0x3F));
+            }
+            else if (codepoint < 0x10000)
+            {
+                out[length++] = static_cast<char>(0xE0 | (codepoint >> 12));
+                out[length++] = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+                out[length++] = static_cast<char>(0x80 | (codepoint & 0x3F));
+            }
+            else
+            {
+                out[length++] = static_cast<char>(0xF0 | (codepoint >> 18));
+                out[length++] = static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+                out[length++] = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+                out[length++] = static_cast<char>(0x80 | (codepoint & 0x3F));
+            }
+        }
+
+        // Runs a schema over JSON text with the decoder's scanning primitives, without building anything. Strings are
+        // only ever looked at in place, except for keys and enumerators that contain escape sequences, which get
+        // decoded into a fixed size buffer (anything longer can't match a name in the schema anyway)
+        struct text_validator
+        {
+            static constexpr std::size_t max_name_size = 128;
+
+            text_validator(const schema& definition, std::string_view text) : definition(definition), dec(text) {}
+
+            bool validate(std::uint32_t index)
+            {
+                if (nesting == max_schema_nesting) return dec.fail("Maximum nesting depth exceeded");
+
+                ++nesting;
+                auto result = validate_type(index);
+                --nesting;
+                return result;
+            }
+
+            bool validate_type(std::uint32_t index)
+            {
+                auto& type = definition.types[index];
+                dec.skip_whitespace();
+                switch (type.op)
+                {
+                case schema_op::any:
+                    return dec.skip_value();
+
+                case schema_op::null:
+                    return dec.read_literal("null") || dec.fail("Expected 'null'");
+
+                case schema_op::boolean:
+                {
+                    boolean_t ignored;
+                    return dec.read_boolean(ignored);
+                }
+
+                case schema_op::number:
+                {
+                    number_t ignored;
+                    return dec.read_number(ignored);
+                }
+
+                case schema_op::integer:
+                {
+                    integer_t ignored;
+                    return dec.read_integer(ignored);
+                }
+
+                case schema_op::string:
+                    return skip_string();
+
+                case schema_op::enumeration:
+                {
+                    auto start = dec.current;
+                    std::string_view name;
+                    if (!read_name(name)) return false;
+                    if (find_field(definition, type, name)) return true;
+
+                    dec.current = start;
+                    return dec.fail("Unknown enumeration value");
+                }
+
+                case schema_op::object:
+                {
+                    auto start = dec.current;
+                    member_set seen;
+                    bool result = dec.read_sequence('{', '}', [&]
+                    {
+                        std::string_view key;
+                        if (!read_name(key) || !dec.expect(':')) return false;
+
+                        auto field = find_field(definition, type, key);
+                        if (!field) return dec.skip_value();
+
+                        // As when decoding, null for a member that may be left out means that it was left out
+                        seen.add(type, field, definition.fields);
+                        dec.skip_whitespace();
+                        if (field->optional && dec.read_literal("null")) return true;
+                        return validate(field->type);
+                    });
+
+                    if (!result) return false;
+                    if (auto message = seen.missing(type))
+                    {
+                        dec.current = start;
+                        return dec.fail(message);
+                    }
+
+                    return true;
+                }
+
+                case schema_op::array:
+                    return dec.read_sequence('[', ']', [&] { return validate(type.first); });
+
+                case schema_op::map:
+                    return dec.read_sequence('{', '}', [&]
+                    {
+                        return skip_string() && dec.expect(':') && validate(type.first);
+                    });
+
+                case schema_op::nullable:
+                    return dec.read_literal("null") || validate(type.first);
+
+                case schema_op::one_of:
+                {
+                    // Each alternative gets a go at the same text, which is cheap since nothing gets built
+                    auto start = dec.current;
+                    auto startDepth = dec.depth;
+                    for (std::uint32_t i = 0; i < type.count; ++i)
+                    {
+                        if (validate(definition.fields[type.first + i].type)) return true;
+
+                        dec.current = start;
+                        dec.depth = startDepth;
+                        dec.error_message = nullptr;
+                    }
+
+                    return dec.fail("Value does not match any of the allowed types");
+                }
+
+                case schema_op::dispatch:
+                {
+                    // As with decoding, find the discriminating member and then go back over the whole object
+                    auto start = dec.current;
+                    auto startDepth = dec.depth;
+                    auto& key = definition.fields[type.first];
+                    auto target = key.type;
+                    bool found = false;
+                    bool result = dec.read_sequence('{', '}', [&]
+                    {
+                        std::string_view name;
+                        if (!read_name(name) || !dec.expect(':')) return false;
+                        if (name != definition.name(key)) return dec.skip_value();
+
+                        if (!read_name(name)) return false;
+                        if (auto field = find_field(definition, type, name, 1)) target = field->type;
+                        found = true;
+                        return false; // Nothing more to look at
+                    });
+
+                    if (!result && !found) return false;
+
+                    dec.current = start;
+                    dec.depth = startDepth;
+                    return validate(target);
+                }
+                }
+
+                return dec.fail("Invalid schema");
+            }
+
+            // Moves past a string that has no escape sequences (or anything else to report), leaving 'text' viewing its
+            // characters. Other strings are left for the decoder, with 'plain' false and 'current' on the opening quote
+            bool read_plain(std::string_view& text, bool& plain)
+            {
+                if (!dec.expect('"')) return false;
+
+                auto start = dec.current;
+                auto end = dec.end;
+                auto pos = start;
+                while ((pos != end) && (*pos != '"') && (*pos != '\\') && (static_cast<unsigned char>(*pos) >= 0x20))
+                {
+                    ++pos;
+                }
+
+                plain = (pos != end) && (*pos == '"');
+                if (plain)
+                {
+                    text = std::string_view(start, static_cast<std::size_t>(pos - start));
+                    dec.current = pos + 1;
+                }
+                else
+                {
+                    dec.current = start - 1;
+                }
+
+                return true;
+            }
+
+            bool skip_string()
+            {
+                std::string_view ignored;
+                bool plain;
+                return read_plain(ignored, plain) && (plain || dec.skip_string());
+            }
+
+            // Reads a string that's going to be compared against the names in the schema
+            bool read_name(std::string_view& name)
+            {
+                bool plain;
+                if (!read_plain(name, plain)) return false;
+                if (plain) return true;
+
+                // Let 'skip_string' check the escape sequences, then decode the now known to be valid text
+                auto start = dec.current + 1;
+                if (!dec.skip_string()) return false;
+
+                std::size_t length = 0;
+                for (auto pos = start; pos != dec.current - 1; )
+                {
+                    if (length + 4 > max_name_size)
+                    {
+                        // Too long to be any of the names we're looking for
+                        name = {};
+                        return true;
+                    }
+
+                    if (*pos != '\\')
+                    {
+                        buffer[length++] = *pos++;
+                        continue;
+                    }
+
+                    ++pos;
+                    switch (*pos++)
+                    {
+                    case 'b': buffer[length++] = '\b'; break;
+                    case 'f': buffer[length++] = '\f'; break;
+                    case 'n': buffer[length++] = '\n'; break;
+                    case 'r': buffer[length++] = '\r'; break;
+                    case 't': buffer[length++] = '\t'; break;
+                    case 'u':
+                    {
+                        auto hex4 = [&]
+                        {
+                            std::uint32_t value = 0;
+                            for (int i = 0; i < 4; ++i)
+                            {
+                                auto ch = *pos++;
+                                auto digit = (ch <= '9') ? ch - '0' : (ch | 0x20) - 'a' + 10;
+                                value = (value << 4) | static_cast<std::uint32_t>(digit);
+                            }
+                            return value;
+                        };
+
+                        auto codepoint = hex4();
+                        if ((codepoint >= 0xD800) && (codepoint <= 0xDBFF))
+                        {
+                            pos += 2; // "\u"
+                            codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (hex4() - 0xDC00);
+                        }
+                        append_utf8(buffer, length, codepoint);
+                        break;
+                    }
+                    default: buffer[length++] = pos[-1]; break; // '"', '\\' and '/'
+                    }
+                }
+
+                name = std::string_view(buffer, length);
+                return true;
+            }
+
+            const schema& definition;
+            decoder dec;
+            int nesting = 0;
+            char buffer[max_name_size];
+        };
+
+        // The same checks, over a value that has already been parsed. Errors have no meaningful offset
+        inline const char* validate_value(const schema& definition, std::uint32_t index, const value& val,
+            int depth = 0)
+        {
+            if (depth == max_schema_nesting) return "Maximum nesting depth exceeded";
+
+            auto& type = definition.types[index];
+            switch (type.op)
+            {
+            case schema_op::any:
+                return nullptr;
+
+            case schema_op::null:
+                return (val.type() == value_type::null) ? nullptr : "Expected 'null'";
+
+            case schema_op::boolean:
+                return (val.type() == value_type::boolean) ? nullptr : "Expected 'true' or 'false'";
+
+            case schema_op::number:
+                return (val.type() == value_type::number) ? nullptr : "Expected a number";
+
+            case schema_op::integer:
+            {
+                if (val.type() != value_type::number) return "Expected a number";
+
+                integer_t ignored;
+                return details::to_integer(val.number(), ignored);
+            }
+
+            case schema_op::string:
+                return (val.type() == value_type::string) ? nullptr : "Expected '\"'";
+
+            case schema_op::enumeration:
+                if (val.type() != value_type::string) return "Expected '\"'";
+                return find_field(definition, type, val.string()) ? nullptr : "Unknown enumeration value";
+
+            case schema_op::object:
+            {
+                if (val.type() != value_type::object) return "Expected '{'";
+
+                member_set seen;
+                for (auto& [key, member] : val.object())
+                {
+                    auto field = find_field(definition, type, key);
+                    if (!field) continue;
+
+                    seen.add(type, field, definition.fields);
+                    if (field->optional && (member.type() == value_type::null)) continue;
+                    if (auto message = validate_value(definition, field->type, member, depth + 1)) return message;
+                }
+
+                return seen.missing(type);
+            }
+
+            case schema_op::array:
+                if (val.type() != value_type::array) return "Expected '['";
+                for (auto& element : val.array())
+                {
+                    if (auto message = validate_value(definition, type.first, element, depth + 1)) return message;
+                }
+                return nullptr;
+
+            case schema_op::map:
+                if (val.type() != value_type::object) return "Expected '{'";
+                for (auto& [key, member] : val.object())
+                {
+                    if (auto message = validate_value(definition, type.first, member, depth + 1)) return message;
+                }
+                return nullptr;
+
+            case schema_op::nullable:
+                if (val.type() == value_type::null) return nullptr;
+                return validate_value(definition, type.first, val, depth + 1);
+
+            case schema_op::one_of:
+                for (std::uint32_t i = 0; i < type.count; ++i)
+                {
+                    auto alternative = definition.fields[type.first + i].type;
+                    if (!validate_value(definition, alternative, val, depth + 1)) return nullptr;
+                }
+                return "Value does not match any of the allowed types";
+
+            case schema_op::dispatch:
+            {
+                if (val.type() != value_type::object) return "Expected '{'";
+
+                auto& key = definition.fields[type.first];
+                auto target = key.type;
+                if (auto discriminator = val.object().find(definition.name(key));
+                    (discriminator != val.object().end()) && (discriminator->second.type() == value_type::string))
+                {
+                    if (auto field = find_field(definition, type, discriminator->second.string(), 1))
+                    {
+                        target = field->type;
+                    }
+                }
+
+                return validate_value(definition, target, val, depth + 1);
+            }
+            }
+
+            return "Invalid schema";
+        }
+
+        template <typename T>
+        using schema_info = std::conditional_t<is_dispatched_v<T>, dispatch<T>, reflection<T>>;
+    }
+
+    // Checks that 'text' holds exactly one JSON value that 'schema_index' within 'definition' accepts, stopping at the
+    // first problem. Accepts exactly what decoding into the generated type would, but without building anything and
+    // without allocating
+    inline bool validate(const schema& definition, std::uint32_t schema_index, std::string_view text,
+        decode_error* error = nullptr)
+    {
+        details::text_validator validator(definition, text);
+        if (validator.validate(schema_index) && validator.dec.finish())
+        {
+            return true;
+        }
+
+        if (error) *error = validator.dec.error();
+        return false;
+    }
+
+    // As above, for a value that's already been parsed. The error offset is always zero
+    inline bool validate(const schema& definition, std::uint32_t schema_index, const value& val,
+        decode_error* error = nullptr)
+    {
+        auto message = details::validate_value(definition, schema_index, val);
+        if (message && error) *error = { 0, message };
+        return !message;
+    }
+
+    // Checks JSON against a type generated by ts2cpp (a struct, enum, or message variant)
+    template <typename T, typename Input>
+    bool validate(const Input& input, decode_error* error = nullptr)
+    {
+        using info = details::schema_info<T>;
+        if constexpr (std::is_convertible_v<const Input&, std::string_view>)
+        {
+            return validate(*info::schema_table, info::schema_index, std::string_view(input), error);
+        }
+        else
+        {
+            return validate(*info::schema_table, info::schema_index, static_cast<const value&>(input), error);
+        }
+    }
+}
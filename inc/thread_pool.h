@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ts2cpp
+{
+    // Fixed size pool of worker threads. Each worker owns a queue of tasks; a worker takes work from the back of its own
+    // queue and, once that runs dry, steals from the front of the other workers' queues. Tasks submitted from outside
+    // the pool are spread across the queues round robin, while tasks submitted from a worker go to that worker's queue.
+    // Tasks must not throw
+    class thread_pool
+    {
+    public:
+        using task = std::function<void()>;
+
+        explicit thread_pool(std::size_t threadCount = std::thread::hardware_concurrency())
+        {
+            if (threadCount == 0) threadCount = 1;
+
+            queues.reserve(threadCount);
+            for (std::size_t i = 0; i < threadCount; ++i)
+            {
+                queues.push_back(std::make_unique<worker_queue>());
+            }
+
+            threads.reserve(threadCount);
+            for (std::size_t i = 0; i < threadCount; ++i)
+            {
+                threads.emplace_back([this, i] { worker_main(i); });
+            }
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        ~thread_pool()
+        {
+            {
+                std::lock_guard lock(state_mutex);
+                stopping = true;
+            }
+            work_available.notify_all();
+
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+        }
+
+        std::size_t size() const noexcept
+        {
+            return threads.size();
+        }
+
+        // Index of the calling worker thread within its pool, or size() if called from outside the pool
+        std::size_t current_worker() const noexcept
+        {
+            return (current_pool == this) ? current_index : threads.size();
+        }
+
+        void submit(task work)
+        {
+            auto index = current_worker();
+            if (index == threads.size())
+            {
+                index = next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+            }
+
+            {
+                std::lock_guard lock(state_mutex);
+                ++pending;
+                ++queued;
+            }
+
+            {
+                auto& queue = *queues[index];
+                std::lock_guard lock(queue.mutex);
+                queue.tasks.push_back(std::move(work));
+            }
+
+            work_available.notify_one();
+        }
+
+        // Blocks until every task submitted so far has finished running. Must not be called from a worker thread
+        void wait()
+        {
+            std::unique_lock lock(state_mutex);
+            work_done.wait(lock, [&] { return pending == 0; });
+        }
+
+    private:
+        struct worker_queue
+        {
+            std::mutex mutex;
+            std::deque<task> tasks;
+        };
+
+        bool try_take(std::size_t index, task& result)
+        {
+            // Our own queue first, newest task first since its data is most likely still in cache
+            {
+                auto& queue = *queues[index];
+                std::lock_guard lock(queue.mutex);
+                if (!queue.tasks.empty())
+                {
+                    result = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                    return true;
+                }
+            }
+
+            // Otherwise steal the oldest task from someone else
+            for (std::size_t i = 1; i < queues.size(); ++i)
+            {
+                auto& queue = *queues[(index + i) % queues.size()];
+                std::lock_guard lock(queue.mutex);
+                if (!queue.tasks.empty())
+                {
+                    result = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void worker_main(std::size_t index)
+        {
+            current_pool = this;
+            current_index = index;
+
+            while (true)
+            {
+                {
+                    std::unique_lock lock(state_mutex);
+                    work_available.wait(lock, [&] { return stopping || (queued > 0); });
+                    if (queued == 0)
+                    {
+                        return; // Stopping and no work left
+                    }
+                    --queued;
+                }
+
+                // 'queued' guarantees that there's at least one task we can claim, although another worker may get to
+                // the one we would have found first, so keep looking until we find it
+                task work;
+                while (!try_take(index, work))
+                {
+                    std::this_thread::yield();
+                }
+
+                work();
+
+                bool done;
+                {
+                    std::lock_guard lock(state_mutex);
+                    done = (--pending == 0);
+                }
+
+                if (done)
+                {
+                    work_done.notify_all();
+                }
+            }
+        }
+
+        std::vector<std::unique_ptr<worker_queue>> queues;
+        std::vector<std::thread> threads;
+        std::atomic<std::size_t> next_queue{ 0 };
+
+        std::mutex state_mutex;
+        std::condition_variable work_available;
+        std::condition_variable work_done;
+        std::size_t pending = 0; // Submitted, but not yet finished
+        std::size_t queued = 0; // Submitted, but not yet claimed by a worker
+        bool stopping = false;
+
+        static inline thread_local const thread_pool* current_pool = nullptr;
+        static inline thread_local std::size_t current_index = 0;
+    };
+}
@@ -0,0 +1,492 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <json_decode.h>
+#include <json_document.h>
+#include <json_encode.h>
+#include <json_parse.h>
+#include <json_stream.h>
+
+#include "allocations.h"
+#include "proto.h"
+#include "session.h"
+
+// Written to by each stage so that the compiler can't drop work whose result is otherwise unused
+static volatile std::size_t sink;
+
+namespace
+{
+    struct stage_result
+    {
+        std::string name;
+        std::vector<std::uint64_t> samples; // Nanoseconds for each message, sorted once the stage is done
+        std::size_t bytes = 0; // Of message text handled, over all repetitions
+        std::uint64_t allocations = 0; // Over all repetitions
+        std::uint64_t allocated_bytes = 0;
+
+        std::uint64_t total() const
+        {
+            std::uint64_t result = 0;
+            for (auto sample : samples) result += sample;
+            return result;
+        }
+
+        // Nearest rank, e.g. 0.99 for the 99th percentile
+        std::uint64_t percentile(double fraction) const
+        {
+            auto rank = static_cast<std::size_t>(fraction * static_cast<double>(samples.size()));
+            return samples[std::min(rank, samples.size() - 1)];
+        }
+
+        double mean() const { return static_cast<double>(total()) / static_cast<double>(samples.size()); }
+        double mb_per_second() const { return static_cast<double>(bytes) / (1024.0 * 1024.0) / (total() / 1e9); }
+
+        double allocations_per_message() const
+        {
+            return static_cast<double>(allocations) / static_cast<double>(samples.size());
+        }
+    };
+
+    // Percentiles that get reported and compared against the baseline
+    struct percentile_info
+    {
+        const char* name;
+        double fraction;
+    };
+
+    constexpr percentile_info percentiles[] = {
+        { "p50", 0.50 },
+        { "p90", 0.90 },
+        { "p99", 0.99 },
+        { "p99.9", 0.999 },
+    };
+
+    struct bench_options
+    {
+        session_options session;
+        std::string corpus; // Framed messages to use rather than a synthetic session
+        std::string write_path; // Where to save the synthetic session, if anywhere
+        std::string json_path; // Where to write the results as JSON, if anywhere
+        std::string baseline_path; // Results to compare against, if any
+        double tolerance = 0.10; // How much slower than the baseline a percentile may be
+        int repeat = 5;
+    };
+
+    // Everything the stages work on. Stages that start from a tree or a typed message get them ready made, so that only
+    // the operation being measured is timed
+    struct corpus
+    {
+        std::vector<std::string_view> bodies;
+        std::vector<json::value> values;
+        std::vector<DebugProtocol::AnyProtocolMessage> messages;
+    };
+
+    // Runs 'func' on each message once to warm up, then 'repeat' more times, timing each call. 'func' returns the
+    // number of bytes it handled, or zero on failure
+    template <typename Func>
+    bool run_stage(const char* name, const corpus& input, int repeat, std::vector<stage_result>& results, Func&& func)
+    {
+        for (std::size_t i = 0; i < input.bodies.size(); ++i)
+        {
+            if (func(i) == 0)
+            {
+                std::printf("ERROR: Stage '%s' failed on message %zu\n", name, i);
+                return false;
+            }
+        }
+
+        stage_result result;
+        result.name = name;
+        result.samples.reserve(input.bodies.size() * static_cast<std::size_t>(repeat));
+        auto before = current_allocations();
+        for (int pass = 0; pass < repeat; ++pass)
+        {
+            for (std::size_t i = 0; i < input.bodies.size(); ++i)
+            {
+                auto start = std::chrono::steady_clock::now();
+                result.bytes += func(i);
+                auto elapsed = std::chrono::steady_clock::now() - start;
+                result.samples.push_back(static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+            }
+        }
+
+        auto after = current_allocations();
+        result.allocations = after.count - before.count;
+        result.allocated_bytes = after.bytes - before.bytes;
+        std::sort(result.samples.begin(), result.samples.end());
+        results.push_back(std::move(result));
+        return true;
+    }
+}
+
+static std::size_t traverse(const json::value& val)
+{
+    switch (val.type())
+    {
+    case json::value_type::null:
+    case json::value_type::boolean:
+        return 1;
+    case json::value_type::number:
+        return 1 + (val.number() != 0);
+    case json::value_type::string:
+        return 1 + val.string().size();
+    case json::value_type::array:
+    {
+        std::size_t result = 1;
+        for (auto& element : val.array()) result += traverse(element);
+        return result;
+    }
+    case json::value_type::object:
+    {
+        std::size_t result = 1;
+        for (auto& [key, element] : val.object()) result += key.size() + traverse(element);
+        return result;
+    }
+    }
+
+    return 0;
+}
+
+// The members a client or adapter typically looks at to route a message, most of which are there, plus one that never
+// is. 'type' and 'seq' are required, so they're looked up with 'get', which throws if they're missing
+static std::size_t look_up(const json::value& message)
+{
+    static constexpr std::string_view optional[] = {
+        "command", "event", "request_seq", "success", "arguments", "body",
+    };
+    static constexpr std::string_view body[] = {
+        "threadId", "reason", "category", "output", "stackFrames", "scopes", "variables", "allThreadsStopped",
+    };
+
+    std::size_t found = (message.get("type").type() == json::value_type::string);
+    found += (message.get("seq").type() == json::value_type::number);
+    for (auto key : optional) found += (message.try_get(key) != nullptr);
+    found += (message.try_get("__missing") != nullptr);
+
+    auto contents = message.try_get("body");
+    if (contents && (contents->type() == json::value_type::object))
+    {
+        for (auto key : body) found += (contents->try_get(key) != nullptr);
+    }
+
+    return found;
+}
+
+static bool run_stages(corpus& input, int repeat, std::vector<stage_result>& results)
+{
+    auto& bodies = input.bodies;
+    json::decode_error error = {};
+
+    // Parsing into a tree, either a 'json::value' or the zero-copy 'json::document'
+    json::parser parser;
+    json::value value;
+    auto parsed = run_stage("parse", input, repeat, results, [&](std::size_t i) -> std::size_t
+    {
+        return parser.parse(bodies[i], value) ? bodies[i].size() : 0;
+    });
+    if (!parsed) return false;
+
+    json::document document;
+    parsed = run_stage("parse/document", input, repeat, results, [&](std::size_t i) -> std::size_t
+    {
+        return document.parse(bodies[i]) ? bodies[i].size() : 0;
+    });
+    if (!parsed) return false;
+
+    // Working with the parsed trees
+    input.values.resize(bodies.size());
+    for (std::size_t i = 0; i < bodies.size(); ++i) parser.parse(bodies[i], input.values[i]);
+
+    auto succeeded = run_stage("lookup", input, repeat, results, [&](std::size_t i) -> std::size_t
+    {
+        sink = look_up(input.values[i]);
+        return bodies[i].size();
+    });
+    succeeded = succeeded && run_stage("traverse", input, repeat, results, [&](std::size_t i) -> std::size_t
+    {
+        sink = traverse(input.values[i]);
+        return bodies[i].size();
+    });
+
+    std::string buffer;
+    succeeded = succeeded && run_stage("serialize", input, repeat, results, [&](std::size_t i) -> std::size_t
+    {
+        buffer.clear();
+        json::encode(input.values[i], buffer);
+        return bodies[i].size();
+    });
+    if (!succeeded) return false;
+
+    // The same messages through the generated types, decoding into one message that gets reused as a reader would
+    DebugProtocol::AnyProtocolMessage message;
+    auto decoded = run_stage("decode", input, repeat, results, [&](std::size_t i) -> std::size_t
+    {
+        return json::decode(bodies[i], message, &error) ? bodies[i].size() : 0;
+    });
+    if (!decoded)
+    {
+        std::printf("ERROR: %s at offset %zu\n", error.message, error.offset);
+        return false;
+    }
+
+    input.messages.resize(bodies.size());
+    for (std::size_t i = 0; i < bodies.size(); ++i) json::decode(bodies[i], input.messages[i]);
+
+    return run_stage("encode", input, repeat, results, [&](std::size_t i) -> std::size_t
+    {
+        buffer.clear();
+        json::encode(input.messages[i], buffer);
+        return bodies[i].size();
+    });
+}
+
+static json::value to_json(const bench_options& options, const corpus& input, std::size_t inputSize,
+    const std::vector<stage_result>& results)
+{
+    json::object_t source;
+    if (options.corpus.empty())
+    {
+        auto& session = options.session;
+        source["seed"] = session.seed;
+        source["stack_depth"] = session.stack_depth;
+        source["variables"] = session.variables;
+        source["output_length"] = session.output_length;
+    }
+    else
+    {
+        source["file"] = options.corpus;
+    }
+    source["bytes"] = inputSize;
+    source["messages"] = input.bodies.size();
+
+    json::array_t<> stages;
+    for (auto& result : results)
+    {
+        json::object_t stage;
+        stage["name"] = result.name;
+        stage["messages"] = result.samples.size();
+        stage["mean_ns"] = result.mean();
+        for (auto& info : percentiles) stage[std::string(info.name) + "_ns"] = result.percentile(info.fraction);
+        stage["max_ns"] = result.samples.back();
+        stage["mb_per_second"] = result.mb_per_second();
+        stage["allocations_per_message"] = result.allocations_per_message();
+        stage["allocated_bytes"] = result.allocated_bytes;
+        stages.push_back(std::move(stage));
+    }
+
+    json::object_t root;
+    root["input"] = std::move(source);
+    root["stages"] = std::move(stages);
+    root["peak_rss_bytes"] = peak_rss_bytes();
+    return root;
+}
+
+// Prints each percentile that got slower by more than the tolerance since the baseline. Returns false if any did
+static bool compare_baseline(const bench_options& options, const std::vector<stage_result>& results)
+{
+    std::string text;
+    {
+        std::ifstream stream(options.baseline_path, std::ios::binary);
+        text.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+        if (!stream.good() && !stream.eof())
+        {
+            std::printf("ERROR: Failed to open baseline '%s'\n", options.baseline_path.c_str());
+            return false;
+        }
+    }
+
+    json::parser parser;
+    json::value baseline;
+    if (!parser.parse(text, baseline) || (baseline.type() != json::value_type::object))
+    {
+        std::printf("ERROR: Failed to parse baseline '%s'\n", options.baseline_path.c_str());
+        return false;
+    }
+
+    bool result = true;
+    auto stages = baseline.try_get("stages");
+    for (auto& current : results)
+    {
+        const json::value* previous = nullptr;
+        if (stages && (stages->type() == json::value_type::array))
+        {
+            for (auto& stage : stages->array())
+            {
+                auto name = stage.try_get("name");
+                if (name && (name->type() == json::value_type::string) && (name->string() == current.name))
+                {
+                    previous = &stage;
+                }
+            }
+        }
+
+        if (!previous)
+        {
+            std::printf("NOTE: No baseline for stage '%s'\n", current.name.c_str());
+            continue;
+        }
+
+        for (auto& info : percentiles)
+        {
+            auto before = previous->try_get(std::string(info.name) + "_ns");
+            if (!before || (before->type() != json::value_type::number) || (before->number() <= 0)) continue;
+
+            auto now = static_cast<double>(current.percentile(info.fraction));
+            auto change = now / before->number() - 1;
+            if (change > options.tolerance)
+            {
+                std::printf("ERROR: Stage '%s' %s regressed by %.1f%% (%.0f ns, baseline %.0f ns)\n",
+                    current.name.c_str(), info.name, change * 100, now, before->number());
+                result = false;
+            }
+        }
+    }
+
+    return result;
+}
+
+static void print_usage()
+{
+    std::printf("USAGE: json_bench [options]\n");
+    std::printf("    Times the JSON runtime on each message of a recorded or synthetic debug session: parsing into\n");
+    std::printf("    a json::value and a json::document, lookups, traversal and serialization of the parsed value,\n");
+    std::printf("    and decoding and encoding the generated DebugProtocol types. Reports latency percentiles\n");
+    std::printf("    --corpus <path>         Framed messages to use, such as sample.dap, instead of a synthetic\n");
+    std::printf("                            session\n");
+    std::printf("    --size <MB>             Size of the synthetic session (default 64)\n");
+    std::printf("    --seed <n>              Seed for the synthetic session (default 1)\n");
+    std::printf("    --stack-depth <n>       Frames in each stackTrace response (default 64)\n");
+    std::printf("    --variables <n>         Variables in each variables response (default 256)\n");
+    std::printf("    --output-length <n>     Average characters in each output event (default 16384)\n");
+    std::printf("    --write <path>          Save the synthetic session\n");
+    std::printf("    --repeat <n>            Timed passes over the messages (default 5)\n");
+    std::printf("    --json <path>           Write the results as JSON\n");
+    std::printf("    --baseline <path>       Compare against results written by --json, failing if any percentile\n");
+    std::printf("                            is slower by more than the tolerance\n");
+    std::printf("    --tolerance <percent>   Allowed slowdown against the baseline (default 10)\n");
+}
+
+int main(int argc, char** argv)
+{
+    bench_options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if ((arg == "-h") || (arg == "--help"))
+        {
+            print_usage();
+            return 0;
+        }
+        else if (i + 1 == argc)
+        {
+            print_usage();
+            return 1;
+        }
+
+        const char* param = argv[++i];
+        auto& session = options.session;
+        if (arg == "--corpus") options.corpus = param;
+        else if (arg == "--size") session.target_size = static_cast<std::size_t>(std::strtod(param, nullptr) * 1048576);
+        else if (arg == "--seed") session.seed = static_cast<std::uint32_t>(std::strtoul(param, nullptr, 10));
+        else if (arg == "--stack-depth") session.stack_depth = std::max(1, std::atoi(param));
+        else if (arg == "--variables") session.variables = std::max(1, std::atoi(param));
+        else if (arg == "--output-length") session.output_length = std::strtoul(param, nullptr, 10);
+        else if (arg == "--write") options.write_path = param;
+        else if (arg == "--repeat") options.repeat = std::max(1, std::atoi(param));
+        else if (arg == "--json") options.json_path = param;
+        else if (arg == "--baseline") options.baseline_path = param;
+        else if (arg == "--tolerance") options.tolerance = std::strtod(param, nullptr) / 100;
+        else
+        {
+            print_usage();
+            return 1;
+        }
+    }
+
+    std::string text;
+    if (!options.corpus.empty())
+    {
+        std::ifstream stream(options.corpus, std::ios::binary);
+        text.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+        if (!stream.good() && !stream.eof())
+        {
+            std::printf("ERROR: Failed to open file '%s'\n", options.corpus.c_str());
+            return 1;
+        }
+    }
+    else
+    {
+        generate_session(options.session, text);
+        if (!options.write_path.empty())
+        {
+            std::ofstream stream(options.write_path, std::ios::binary | std::ios::trunc);
+            stream.write(text.data(), static_cast<std::streamsize>(text.size()));
+            if (!stream.good())
+            {
+                std::printf("ERROR: Failed to write output file '%s'\n", options.write_path.c_str());
+                return 1;
+            }
+        }
+    }
+
+    corpus input;
+    json::decode_error error = {};
+    if (!json::split_messages(text, input.bodies, &error) || input.bodies.empty())
+    {
+        std::printf("ERROR: %s at offset %zu\n", error.message ? error.message : "No messages", error.offset);
+        return 1;
+    }
+
+    std::vector<stage_result> results;
+    try
+    {
+        if (!run_stages(input, options.repeat, results)) return 1;
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("ERROR: %s\n", e.what());
+        return 1;
+    }
+
+    std::printf("Input: %zu messages, %.1f MB\n", input.bodies.size(), static_cast<double>(text.size()) / 1048576);
+    std::printf("%-16s %9s %9s %9s %9s %9s %9s %9s %9s\n", "stage", "mean ns", "p50", "p90", "p99", "p99.9", "max",
+        "MB/s", "allocs");
+    for (auto& result : results)
+    {
+        std::printf("%-16s %9.0f", result.name.c_str(), result.mean());
+        for (auto& info : percentiles)
+        {
+            std::printf(" %9llu", static_cast<unsigned long long>(result.percentile(info.fraction)));
+        }
+        std::printf(" %9llu %9.1f %9.1f\n", static_cast<unsigned long long>(result.samples.back()),
+            result.mb_per_second(), result.allocations_per_message());
+    }
+    std::printf("Peak RSS: %.1f MB\n", static_cast<double>(peak_rss_bytes()) / 1048576);
+
+    if (!options.json_path.empty())
+    {
+        std::string output;
+        json::encode(to_json(options, input, text.size(), results), output);
+        output += '\n';
+
+        std::ofstream stream(options.json_path, std::ios::binary | std::ios::trunc);
+        stream.write(output.data(), static_cast<std::streamsize>(output.size()));
+        if (!stream.good())
+        {
+            std::printf("ERROR: Failed to write output file '%s'\n", options.json_path.c_str());
+            return 1;
+        }
+    }
+
+    if (!options.baseline_path.empty() && !compare_baseline(options, results)) return 1;
+    return 0;
+}
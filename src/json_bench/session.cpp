@@ -0,0 +1,285 @@
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include "session.h"
+
+namespace
+{
+    // splitmix64, so that the session is the same with every standard library
+    struct random_engine
+    {
+        std::uint64_t state;
+
+        std::uint64_t next() noexcept
+        {
+            auto z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        std::size_t below(std::size_t limit) noexcept
+        {
+            return static_cast<std::size_t>(next() % limit);
+        }
+    };
+
+    const char* const identifiers[] = {
+        "mesh", "vertex_count", "index_count", "positions", "normals", "bounds", "material", "texture", "sampler",
+        "staging", "queue", "device", "frame_index", "elapsed", "scale", "transform", "parent", "children", "label",
+        "visible", "lod_bias", "instance_count", "draw_calls", "allocator", "pipeline", "descriptor_set", "fence",
+    };
+    constexpr std::size_t identifier_count = sizeof(identifiers) / sizeof(identifiers[0]);
+
+    const char* const type_names[] = {
+        "int", "float", "bool", "std::size_t", "std::uint32_t", "std::string", "renderer::mesh &",
+        "std::vector<glm::vec3>", "glm::mat<4, 4, float>", "renderer::buffer", "const char *",
+    };
+    constexpr std::size_t type_count = sizeof(type_names) / sizeof(type_names[0]);
+
+    // Program output is mostly plain text, with the odd tab, quote, backslash, non-ASCII character and terminal color
+    // sequence, all of which need escaping or multi-byte handling somewhere
+    const char* const output_lines[] = {
+        "Frame 118/120: 16.7 ms (cpu 4.1 ms, gpu 12.6 ms)\n",
+        "\tuploaded \"Mesh.042\" (65912 vertices, 98304 indices)\n",
+        "warning: texture \"lion_bump.png\" is not a power of two (1000\xC3\x97" "1000)\n",
+        "loading C:\\assets\\sponza\\textures\\vase_round.png\n",
+        "\x1B[33mvalidation:\x1B[0m vkCmdDrawIndexed(): descriptor set 0 binding 2 was never updated\n",
+        "r\xC3\xA9solution: 1920\xC3\x97" "1080 @ 144 Hz\n",
+    };
+    constexpr std::size_t output_line_count = sizeof(output_lines) / sizeof(output_lines[0]);
+
+    struct writer
+    {
+        const session_options& options;
+        std::string& out;
+        random_engine rng;
+        std::string body;
+        std::uint64_t seq = 0;
+        std::uint64_t references = 1000;
+
+        void string(std::string_view str)
+        {
+            static constexpr char hex[] = "0123456789abcdef";
+
+            body += '"';
+            for (auto ch : str)
+            {
+                switch (ch)
+                {
+                case '"': body += "\\\""; break;
+                case '\\': body += "\\\\"; break;
+                case '\n': body += "\\n"; break;
+                case '\t': body += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(ch) < 0x20)
+                    {
+                        body += "\\u00";
+                        body += hex[static_cast<unsigned char>(ch) >> 4];
+                        body += hex[static_cast<unsigned char>(ch) & 0xF];
+                    }
+                    else
+                    {
+                        body += ch;
+                    }
+                    break;
+                }
+            }
+            body += '"';
+        }
+
+        void number(std::uint64_t value)
+        {
+            body += std::to_string(value);
+        }
+
+        // Frames the message that's been written to 'body'
+        void send()
+        {
+            out += "Content-Length: ";
+            out += std::to_string(body.size());
+            out += "\r\n\r\n";
+            out += body;
+            body.clear();
+        }
+
+        std::uint64_t request(std::string_view command, std::string_view arguments)
+        {
+            body += "{\"command\":";
+            string(command);
+            body += ",\"type\":\"request\",\"seq\":";
+            number(++seq);
+            if (!arguments.empty())
+            {
+                body += ",\"arguments\":";
+                body += arguments;
+            }
+            body += '}';
+            send();
+            return seq;
+        }
+
+        // Starts a response; the caller writes the body, if any, and closes the object
+        void response(std::uint64_t requestSeq, std::string_view command)
+        {
+            body += "{\"type\":\"response\",\"seq\":";
+            number(++seq);
+            body += ",\"request_seq\":";
+            number(requestSeq);
+            body += ",\"success\":true,\"command\":";
+            string(command);
+        }
+
+        void event(std::string_view name)
+        {
+            body += "{\"type\":\"event\",\"seq\":";
+            number(++seq);
+            body += ",\"event\":";
+            string(name);
+        }
+
+        void output()
+        {
+            auto length = options.output_length / 2 + rng.below(options.output_length + 1);
+            std::string text;
+            while (text.size() < length) text += output_lines[rng.below(output_line_count)];
+
+            event("output");
+            body += ",\"body\":{\"category\":";
+            string(rng.below(4) ? "stdout" : "stderr");
+            body += ",\"output\":";
+            string(text);
+            body += "}}";
+            send();
+        }
+
+        void stack_trace(std::uint64_t threadId)
+        {
+            auto seq = request("stackTrace", "{\"threadId\":" + std::to_string(threadId) +
+                ",\"startFrame\":0,\"levels\":" + std::to_string(options.stack_depth) + "}");
+            response(seq, "stackTrace");
+            body += ",\"body\":{\"stackFrames\":[";
+            for (int i = 0; i < options.stack_depth; ++i)
+            {
+                if (i > 0) body += ',';
+                body += "{\"id\":";
+                number(references + static_cast<std::uint64_t>(i));
+                body += ",\"name\":";
+                string(std::string("renderer::") + identifiers[rng.below(identifier_count)] + "::update(" +
+                    type_names[rng.below(type_count)] + ", int)");
+                body += ",\"source\":{\"name\":\"scene.cpp\",\"path\":\"/home/dev/src/renderer/scene.cpp\"},\"line\":";
+                number(1 + rng.below(2000));
+                char address[32];
+                std::snprintf(address, sizeof(address), "0x%016llx",
+                    static_cast<unsigned long long>(0x555555560000ull + rng.below(0x100000)));
+                body += ",\"column\":1,\"instructionPointerReference\":";
+                string(address);
+                body += '}';
+            }
+            body += "],\"totalFrames\":";
+            number(static_cast<std::uint64_t>(options.stack_depth));
+            body += "}}";
+            send();
+        }
+
+        void variables(std::uint64_t reference)
+        {
+            auto seq = request("variables", "{\"variablesReference\":" + std::to_string(reference) + "}");
+            response(seq, "variables");
+            body += ",\"body\":{\"variables\":[";
+            for (int i = 0; i < options.variables; ++i)
+            {
+                std::string name = identifiers[rng.below(identifier_count)];
+                auto structured = (rng.below(4) == 0);
+
+                if (i > 0) body += ',';
+                body += "{\"name\":";
+                string(name);
+                body += ",\"value\":";
+                if (structured)
+                {
+                    string("{x=" + std::to_string(rng.below(100)) + ", y=" + std::to_string(rng.below(100)) +
+                        ", label=\"" + identifiers[rng.below(identifier_count)] + "\", ...}");
+                }
+                else
+                {
+                    string(std::to_string(rng.below(1000000)));
+                }
+                body += ",\"type\":";
+                string(type_names[rng.below(type_count)]);
+                body += ",\"evaluateName\":";
+                string("this->" + name);
+                body += ",\"variablesReference\":";
+                number(structured ? ++references : 0);
+                body += '}';
+            }
+            body += "]}}";
+            send();
+        }
+
+        void step()
+        {
+            constexpr std::uint64_t threadId = 48213;
+
+            auto seq = request("next", "{\"threadId\":48213,\"granularity\":\"line\"}");
+            response(seq, "next");
+            body += '}';
+            send();
+
+            if (rng.below(2) == 0) output();
+
+            event("stopped");
+            body += ",\"body\":{\"reason\":\"step\",\"threadId\":";
+            number(threadId);
+            body += ",\"allThreadsStopped\":true}}";
+            send();
+
+            seq = request("threads", {});
+            response(seq, "threads");
+            body += ",\"body\":{\"threads\":[{\"id\":48213,\"name\":\"renderer\"},"
+                "{\"id\":48219,\"name\":\"io_worker\"},{\"id\":48220,\"name\":\"io_worker\"}]}}";
+            send();
+
+            references += static_cast<std::uint64_t>(options.stack_depth);
+            stack_trace(threadId);
+
+            seq = request("scopes", "{\"frameId\":" + std::to_string(references) + "}");
+            response(seq, "scopes");
+            auto locals = ++references;
+            body += ",\"body\":{\"scopes\":[{\"name\":\"Locals\",\"presentationHint\":\"locals\","
+                "\"variablesReference\":";
+            number(locals);
+            body += ",\"expensive\":false},{\"name\":\"Registers\",\"presentationHint\":\"registers\","
+                "\"variablesReference\":";
+            number(++references);
+            body += ",\"expensive\":true}]}}";
+            send();
+
+            variables(locals);
+        }
+    };
+}
+
+void generate_session(const session_options& options, std::string& output)
+{
+    // Output runs a little past the target to finish the step, and reallocating a large string would double the peak
+    // memory of the benchmark
+    output.reserve(output.size() + options.target_size + 4 * 1024 * 1024);
+
+    writer w{ options, output, random_engine{ options.seed }, {} };
+    auto seq = w.request("initialize", "{\"clientID\":\"vscode\",\"adapterID\":\"cppdbg\",\"linesStartAt1\":true}");
+    w.response(seq, "initialize");
+    w.body += ",\"body\":{\"supportsConfigurationDoneRequest\":true,\"supportsVariablePaging\":true}}";
+    w.send();
+    w.event("initialized");
+    w.body += '}';
+    w.send();
+
+    auto start = output.size();
+    while (output.size() - start < options.target_size) w.step();
+
+    w.event("terminated");
+    w.body += '}';
+    w.send();
+}
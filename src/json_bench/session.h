@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Shape of the debug session that 'generate_session' records. Each step goes through the messages a client exchanges
+// with an adapter after a 'next': a stopped event, then the threads, stack trace, scopes and variables of the new
+// location, along with whatever output the program wrote in the meantime
+struct session_options
+{
+    std::size_t target_size = 64 * 1024 * 1024; // Bytes; output stops at the first step past this
+    std::uint32_t seed = 1;
+
+    int stack_depth = 64; // Frames in each 'stackTrace' response
+    int variables = 256; // Variables in each 'variables' response
+    std::size_t output_length = 16 * 1024; // Average characters in each 'output' event
+};
+
+// Appends a session to 'output' as a sequence of framed messages, as 'json::message_reader' would receive them. The
+// same options always give the same text
+void generate_session(const session_options& options, std::string& output);
@@ -0,0 +1,149 @@
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <json_batch.h>
+#include <json_document.h>
+#include <json_encode.h>
+
+#include "check.h"
+#include "types.h"
+
+namespace
+{
+    // Enough messages for every worker to get several chunks, with some that fail here and there so that errors have
+    // to land at the right index
+    std::vector<std::string> make_messages()
+    {
+        std::vector<std::string> messages;
+        for (int i = 0; i < 2000; ++i)
+        {
+            auto n = std::to_string(i);
+            if (i % 97 == 13) messages.push_back(R"({"name":")" + n + R"(","id":1.5,"flags":[],"kind":"leaf","children":[]})");
+            else if (i % 131 == 7) messages.push_back("{\"name\":\"" + n);
+            else if (i % 3 == 0)
+            {
+                messages.push_back(R"({"name":")" + n + R"(","id":)" + n + R"(,"flags":[true],"kind":"branch","children":[)"
+                    R"({"name":"child of )" + n + R"(","id":null,"flags":[],"kind":"leaf","children":[]}]})");
+            }
+            else
+            {
+                messages.push_back(R"({"name":"a string that's too long to be kept inline, number )" + n +
+                    R"(","id":null,"label":"x","flags":[],"kind":"leaf","children":[],"bounds":{"min":)" + n +
+                    R"(,"max":null}})");
+            }
+        }
+        return messages;
+    }
+
+    std::string encoded(const Node& node)
+    {
+        std::string text;
+        json::encode(node, text);
+        return text;
+    }
+
+    std::string encoded(const json::value& value)
+    {
+        std::string text;
+        json::encode(value, text);
+        return text;
+    }
+
+    // What sequential decoding gives for one message: the encoded result, or the error
+    struct expected
+    {
+        bool ok;
+        std::string text;
+        json::decode_error error;
+    };
+
+    void compare(const char* check, std::string_view input, bool ok, const std::string& text,
+        const json::decode_error& error, const expected& want)
+    {
+        if (ok != want.ok)
+        {
+            fail(check, input, ok ? "was accepted" : "was rejected with " + message_of(error));
+        }
+        else if (ok && (text != want.text))
+        {
+            fail(check, input, "gave " + text + ", expected " + want.text);
+        }
+        else if (!ok && ((message_of(error) != message_of(want.error)) || (error.offset != want.error.offset)))
+        {
+            fail(check, input, "failed with '" + message_of(error) + "' at " + std::to_string(error.offset) +
+                ", expected '" + message_of(want.error) + "' at " + std::to_string(want.error.offset));
+        }
+    }
+}
+
+void check_batch()
+{
+    auto messages = make_messages();
+    std::vector<std::string_view> bodies(messages.begin(), messages.end());
+
+    // Each kind of target against the same kind of decoding done one message at a time
+    std::vector<expected> nodes, values, elements;
+    json::parser parser;
+    json::document doc;
+    for (auto body : bodies)
+    {
+        Node node;
+        expected want{};
+        want.ok = json::decode(body, node, &want.error);
+        if (want.ok) want.text = encoded(node);
+        nodes.push_back(want);
+
+        json::value value;
+        want = {};
+        want.ok = parser.parse(body, value);
+        if (want.ok) want.text = encoded(value);
+        else want.error = parser.error;
+        values.push_back(want);
+
+        want = {};
+        want.ok = doc.parse(body);
+        if (want.ok) want.text = encoded(doc.root().to_value());
+        else want.error = doc.error;
+        elements.push_back(want);
+    }
+
+    ts2cpp::thread_pool pool(4);
+    std::vector<json::decode_error> errors;
+
+    std::vector<Node> decodedNodes;
+    bool allNodes = json::decode_batch(pool, bodies, decodedNodes, &errors);
+    if (allNodes || (decodedNodes.size() != bodies.size())) fail("decode_batch", "", "didn't report the failures");
+    for (std::size_t i = 0; i < bodies.size(); ++i)
+    {
+        compare("decode_batch into types", bodies[i], !errors[i].message, encoded(decodedNodes[i]), errors[i], nodes[i]);
+    }
+
+    std::vector<json::value> decodedValues;
+    json::decode_batch(pool, bodies, decodedValues, &errors);
+    for (std::size_t i = 0; i < bodies.size(); ++i)
+    {
+        compare("decode_batch into values", bodies[i], !errors[i].message, encoded(decodedValues[i]), errors[i],
+            values[i]);
+    }
+
+    // Twice, so that the second batch reuses the documents and their arenas
+    json::document_batch documents;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        json::decode_batch(pool, bodies, documents, &errors);
+        if (documents.size() != bodies.size()) fail("decode_batch into documents", "", "gave the wrong count");
+        for (std::size_t i = 0; i < bodies.size() && i < documents.size(); ++i)
+        {
+            compare("decode_batch into documents", bodies[i], !errors[i].message,
+                encoded(documents[i].to_value()), errors[i], elements[i]);
+        }
+    }
+
+    // The same as one after the other when everything runs on the calling thread
+    std::vector<std::string_view> one(bodies.begin(), bodies.begin() + 1);
+    if (!json::decode_batch(pool, one, documents) || (encoded(documents[0].to_value()) != elements[0].text))
+    {
+        fail("decode_batch of one message", one[0], "gave something else");
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <json_decode.h>
+
+// Reports a check that failed, along with the input it failed on. 'main' fails if any did
+void fail(const char* check, std::string_view input, const std::string& detail);
+
+// The message of a decoding or validation error, for reports
+std::string message_of(const json::decode_error& error);
+
+// Checks of the parts of the runtime that don't depend on the generated types, one per file
+void check_maps();
+void check_stream();
+
+// Checks that need the generated types, one per file
+void check_batch();
+void check_dispatch();
+void check_names(const json::schema& definition, std::uint32_t settingsType);
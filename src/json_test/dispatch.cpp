@@ -0,0 +1,144 @@
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+
+#include <json_decode.h>
+#include <json_encode.h>
+#include <json_validate.h>
+
+#include "check.h"
+#include "dispatch.h"
+
+namespace
+{
+    template <typename T>
+    struct is_variant : std::false_type {};
+
+    template <typename... Ts>
+    struct is_variant<std::variant<Ts...>> : std::true_type {};
+
+    // The alternative chosen at each level, e.g. "1.2" for an 'EvaluateRequest' within 'AnyRequest'
+    template <typename T>
+    std::string alternative(const T& message)
+    {
+        if constexpr (!is_variant<T>::value)
+        {
+            return {};
+        }
+        else
+        {
+            auto inner = std::visit([](auto& value) { return alternative(value); }, message);
+            return std::to_string(message.index()) + (inner.empty() ? "" : "." + inner);
+        }
+    }
+
+    // A message, the alternative it has to be decoded as, and what encoding it has to give back
+    struct dispatch_case
+    {
+        std::string_view input;
+        std::string_view chosen;
+        std::string_view output;
+    };
+
+    constexpr dispatch_case dispatch_cases[] = {
+        {
+            R"({"seq":1,"type":"request","command":"step","arguments":{"threadId":4}})", "1.1",
+            R"({"seq":1,"type":"request","command":"step","arguments":{"threadId":4}})",
+        },
+        {
+            // The discriminators don't have to come first
+            R"({"arguments":{"expression":"x + 1"},"command":"evaluate","type":"request","seq":2})", "1.2",
+            R"({"seq":2,"type":"request","command":"evaluate","arguments":{"expression":"x + 1"}})",
+        },
+        {
+            // An unknown command falls back to 'Request', which keeps the arguments as they are
+            R"({"seq":3,"type":"request","command":"launch","arguments":{"program":"a.out","args":[]}})", "1.0",
+            R"({"seq":3,"type":"request","command":"launch","arguments":{"program":"a.out","args":[]}})",
+        },
+        {
+            R"({"seq":4,"type":"response","request_seq":2,"success":true,"command":"evaluate","body":{"result":"2"}})",
+            "3.2",
+            R"({"seq":4,"type":"response","request_seq":2,"success":true,"command":"evaluate","body":{"result":"2"}})",
+        },
+        {
+            // 'StepResponse' borrows 'StepRequest's command
+            R"({"seq":5,"type":"response","request_seq":1,"success":true,"command":"step"})", "3.1",
+            R"({"seq":5,"type":"response","request_seq":1,"success":true,"command":"step"})",
+        },
+        {
+            // 'OrphanResponse' was left out of the dispatch table, so its messages are plain 'Response's
+            R"({"seq":6,"type":"response","request_seq":1,"success":true,"command":"orphan","body":{"detail":"x"}})",
+            "3.0",
+            R"({"seq":6,"type":"response","request_seq":1,"success":true,"command":"orphan","body":{"detail":"x"}})",
+        },
+        {
+            R"({"seq":7,"type":"event","event":"stopped","body":{"reason":"step","threadId":4}})", "2.1",
+            R"({"seq":7,"type":"event","event":"stopped","body":{"reason":"step","threadId":4}})",
+        },
+        {
+            R"({"seq":8,"type":"event","event":"exited","body":{"exitCode":0}})", "2.0",
+            R"({"seq":8,"type":"event","event":"exited","body":{"exitCode":0}})",
+        },
+        {
+            // An unknown type falls back to the root of the family
+            R"({"seq":9,"type":"cancel","command":"step"})", "0",
+            R"({"seq":9,"type":"cancel"})",
+        },
+    };
+
+    // Messages whose discriminators pick an alternative that they don't match. Decoding and validation have to reject
+    // them rather than fall back to the base
+    constexpr std::string_view dispatch_rejects[] = {
+        R"({"seq":1,"type":"request","command":"step"})",
+        R"({"seq":1,"type":"request","command":"step","arguments":{"expression":"x"}})",
+        R"({"seq":4,"type":"response","request_seq":2,"success":true,"command":"evaluate"})",
+        R"({"seq":7,"type":"event","event":"stopped","body":{}})",
+        R"({"seq":1,"type":"request","command":7})",
+        R"({"seq":1,"type":"request"})",
+        R"({"seq":1})",
+    };
+}
+
+void check_dispatch()
+{
+    for (auto& test : dispatch_cases)
+    {
+        Messages::AnyProtocolMessage message;
+        json::decode_error error;
+        if (!json::decode(test.input, message, &error))
+        {
+            fail("dispatch", test.input, message_of(error));
+            continue;
+        }
+
+        if (alternative(message) != test.chosen)
+        {
+            fail("dispatch", test.input, "chose " + alternative(message) + ", expected " + std::string(test.chosen));
+        }
+
+        std::string output;
+        json::encode(message, output);
+        if (output != test.output) fail("dispatch encode", test.input, "gave " + output);
+
+        if (!json::validate<Messages::AnyProtocolMessage>(test.input, &error))
+        {
+            fail("dispatch validate", test.input, message_of(error));
+        }
+    }
+
+    for (auto input : dispatch_rejects)
+    {
+        Messages::AnyProtocolMessage message;
+        json::decode_error decodeError, validateError;
+        bool decoded = json::decode(input, message, &decodeError);
+        bool valid = json::validate<Messages::AnyProtocolMessage>(input, &validateError);
+        if (decoded) fail("dispatch rejects", input, "was decoded as " + alternative(message));
+        if (valid) fail("dispatch validate rejects", input, "was accepted");
+        if (!decoded && !valid && (message_of(decodeError) != message_of(validateError)))
+        {
+            fail("dispatch decode and validate agree", input,
+                message_of(decodeError) + " vs " + message_of(validateError));
+        }
+    }
+}
@@ -0,0 +1,54 @@
+// A small family of messages, shaped like the Debug Adapter Protocol's, for checking dispatch. 'OrphanResponse' has
+// no 'OrphanRequest' to take its 'command' from, so ts2cpp warns about it and leaves it out of 'AnyResponse'
+export module Messages {
+    export interface ProtocolMessage {
+        seq: number;
+        type: string;
+    }
+
+    export interface Request extends ProtocolMessage {
+        // type: 'request';
+        command: string;
+        arguments?: any;
+    }
+
+    export interface Event extends ProtocolMessage {
+        // type: 'event';
+        event: string;
+        body?: any;
+    }
+
+    export interface Response extends ProtocolMessage {
+        // type: 'response';
+        request_seq: number;
+        success: boolean;
+        command: string;
+        body?: any;
+    }
+
+    export interface StepRequest extends Request {
+        // command: 'step';
+        arguments: { threadId: number; };
+    }
+
+    export interface StepResponse extends Response {
+    }
+
+    export interface EvaluateRequest extends Request {
+        // command: 'evaluate';
+        arguments: { expression: string; };
+    }
+
+    export interface EvaluateResponse extends Response {
+        body: { result: string; };
+    }
+
+    export interface StoppedEvent extends Event {
+        // event: 'stopped';
+        body: { reason: string; threadId?: number; };
+    }
+
+    export interface OrphanResponse extends Response {
+        body: { detail: string; };
+    }
+}
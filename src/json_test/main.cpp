@@ -0,0 +1,409 @@
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <json_decode.h>
+#include <json_document.h>
+#include <json_encode.h>
+#include <json_parse.h>
+#include <json_schema_image.h>
+#include <json_validate.h>
+
+#include "check.h"
+#include "types.h"
+
+static int failures = 0;
+
+void fail(const char* check, std::string_view input, const std::string& detail)
+{
+    std::printf("FAILED: %s\n    input: %.*s\n    %s\n", check, static_cast<int>(input.size()), input.data(),
+        detail.c_str());
+    ++failures;
+}
+
+std::string message_of(const json::decode_error& error)
+{
+    return error.message ? error.message : "(no message)";
+}
+
+namespace
+{
+    // Valid 'Node's, and the text that encoding the decoded value should give back. Members come out in declaration
+    // order, without whitespace
+    struct round_trip_case
+    {
+        std::string_view input;
+        std::string_view output;
+    };
+
+    constexpr round_trip_case round_trips[] = {
+        {
+            R"({"name":"a","id":null,"flags":[],"kind":"leaf","children":[]})",
+            R"({"name":"a","id":null,"flags":[],"kind":"leaf","children":[]})",
+        },
+        {
+            R"({ "kind" : "branch", "children" : [], "flags" : [ true, false ], "id" : 12, "name" : "b" })",
+            R"({"name":"b","id":12,"flags":[true,false],"kind":"branch","children":[]})",
+        },
+        {
+            R"({"name":"c","id":3,"label":"x","flags":[false,true,true],"kind":"branch","children":[)"
+                R"({"name":"d","id":null,"flags":[true],"kind":"leaf","children":[]}],)"
+                R"("attributes":{"k":"v","\u00e9":"\n"},"bounds":{"min":0.5,"max":null}})",
+            R"({"name":"c","id":3,"label":"x","flags":[false,true,true],"kind":"branch","children":[)"
+                R"({"name":"d","id":null,"flags":[true],"kind":"leaf","children":[]}],)"
+                R"("attributes":{"k":"v","é":"\n"},"bounds":{"min":0.5,"max":null}})",
+        },
+        {
+            R"({"name":"e","id":-4,"flags":[],"kind":"leaf","children":[],"bounds":{"max":2,"min":1}})",
+            R"({"name":"e","id":-4,"flags":[],"kind":"leaf","children":[],"bounds":{"min":1,"max":2}})",
+        },
+        {
+            // '@integer' takes any whole number, however it's written
+            R"({"name":"g","id":2.0,"flags":[],"kind":"leaf","children":[],"bounds":{"min":1e2,"max":-0.5}})",
+            R"({"name":"g","id":2,"flags":[],"kind":"leaf","children":[],"bounds":{"min":100,"max":-0.5}})",
+        },
+        {
+            // Too close to zero for a double reads as zero, keeping the sign
+            R"({"name":"u","id":1e-400,"flags":[],"kind":"leaf","children":[],"bounds":{"min":1e-400,"max":-1e-400}})",
+            R"({"name":"u","id":0,"flags":[],"kind":"leaf","children":[],"bounds":{"min":0,"max":-0}})",
+        },
+        {
+            R"({"name":"h","id":-1.5e1,"flags":[],"kind":"leaf","children":[]})",
+            R"({"name":"h","id":-15,"flags":[],"kind":"leaf","children":[]})",
+        },
+        {
+            // Null for a member that may be left out is the same as leaving it out
+            R"({"name":"f","id":null,"label":null,"flags":[],"kind":"leaf","children":[],"bounds":null})",
+            R"({"name":"f","id":null,"flags":[],"kind":"leaf","children":[]})",
+        },
+    };
+
+    // Text that isn't a valid 'Node'. Decoding and validation have to reject each one, with the same message
+    constexpr std::string_view rejects[] = {
+        R"({"name":"a","flags":[],"kind":"leaf","children":[]})", // 'id' is required, even though it may be null
+        R"({"name":"a","id":null,"flags":[],"kind":"leaf","children":[],"bounds":{"min":1}})",
+        R"({"name":"a","id":1.5,"flags":[],"kind":"leaf","children":[]})",
+        R"({"name":"a","id":1e-1,"flags":[],"kind":"leaf","children":[]})",
+        R"({"name":"a","id":1e19,"flags":[],"kind":"leaf","children":[]})",
+        R"({"name":"a","id":9223372036854775808,"flags":[],"kind":"leaf","children":[]})",
+        R"({"name":"a","id":null,"flags":[],"kind":"leaf","children":[],"bounds":{"min":1e400,"max":null}})",
+        R"({"name":"a","id":null,"flags":[1],"kind":"leaf","children":[]})",
+        R"({"name":"a","id":null,"flags":[],"kind":"root","children":[]})",
+        R"({"name":"a","id":null,"flags":[],"kind":"leaf","children":[{}]})",
+        R"({"name":"a","id":null,"flags":[],"kind":"leaf","children":[]} x)",
+        R"({"name":"a","id":null,"flags":[],"kind":"leaf","children":[])",
+        R"([])",
+    };
+
+    // Arbitrary JSON for comparing the parsers, on top of the 'Node's above
+    constexpr std::string_view documents[] = {
+        "null", "true", "false", "0", "-0", "1e3", "-12.5e-3", "1E+2", "\"\"", "[]", "{}", " [ 1 , [ 2 , [ ] ] ] ",
+        R"("\"\\\/\b\f\n\r\t\u0041\u00e9\u20ac\ud83d\ude00")", R"({"a":{"b":{"c":[null,{"d":[]}]}}})",
+        R"({"a":1,"a":2})", R"(["a long string that doesn't fit inline", "short"])",
+        "", " ", "[", "]", "{", "[1,]", "{\"a\":1,}", "{\"a\"}", "{1:2}", "01", "1.", ".5", "+1", "-", "1e", "tru",
+        "nul", "\"abc", "\"\\x\"", "\"\\u12\"", "\"\\ud800\"", "[1 2]", "{\"a\":1 \"b\":2}", "1 2", "\"\x01\"",
+        // Beyond what a double holds: too close to zero reads as zero, too large is an error
+        "1e-400", "-1e-400", "[0.00000000000000000000000000001e-300]", "123456789012345678901234567890e-360", "1e400",
+        "-1e400", "[1.7976931348623159e308]",
+    };
+
+    void check_round_trips()
+    {
+        for (auto& test : round_trips)
+        {
+            Node node;
+            json::decode_error error;
+            if (!json::decode(test.input, node, &error))
+            {
+                fail("decode", test.input, message_of(error));
+                continue;
+            }
+
+            std::string output;
+            json::encode(node, output);
+            if (output != test.output) fail("encode", test.input, "gave " + output);
+
+            if (!json::validate<Node>(test.input, &error))
+            {
+                fail("validate", test.input, message_of(error));
+            }
+
+            json::value parsed;
+            if (!json::parse(test.input, parsed) || !json::validate<Node>(parsed, &error))
+            {
+                fail("validate value", test.input, message_of(error));
+            }
+
+            // Encoding what was decoded has to give text that decodes to the same thing
+            Node again;
+            std::string second;
+            if (!json::decode(output, again, &error)) fail("decode encoded", output, message_of(error));
+            json::encode(again, second);
+            if (second != output) fail("encode twice", output, "gave " + second);
+        }
+    }
+
+    void check_rejects()
+    {
+        for (auto input : rejects)
+        {
+            Node node;
+            json::decode_error decodeError, validateError;
+            bool decoded = json::decode(input, node, &decodeError);
+            bool valid = json::validate<Node>(input, &validateError);
+            if (decoded) fail("decode rejects", input, "was accepted");
+            if (valid) fail("validate rejects", input, "was accepted");
+            if (!decoded && !valid && (message_of(decodeError) != message_of(validateError)))
+            {
+                fail("decode and validate agree", input, message_of(decodeError) + " vs " + message_of(validateError));
+            }
+
+            // Validating the parsed value has to come to the same answer, for the same reason
+            json::value parsed;
+            if (json::parse(input, parsed))
+            {
+                if (json::validate<Node>(parsed, &validateError)) fail("validate value rejects", input, "was accepted");
+                else if (message_of(validateError) != message_of(decodeError))
+                {
+                    fail("decode and validate value agree", input,
+                        message_of(decodeError) + " vs " + message_of(validateError));
+                }
+            }
+        }
+    }
+
+    // Which of 'label', 'attributes' and 'bounds' have a value, through the accessors with the compact layout. These
+    // are the optional members, so they have bits 0 to 2 of the compact layout's 'presence' whatever their position
+    template <typename T>
+    std::string optional_members(const T& node)
+    {
+        std::string result;
+        if constexpr (json::details::has_presence<json::reflection<T>>::value)
+        {
+            result += node.label() ? '1' : '0';
+            result += node.attributes() ? '1' : '0';
+            result += node.bounds() ? '1' : '0';
+        }
+        else
+        {
+            result += node.label ? '1' : '0';
+            result += node.attributes ? '1' : '0';
+            result += node.bounds ? '1' : '0';
+        }
+        return result;
+    }
+
+    template <typename T>
+    void set_bounds(T& node)
+    {
+        if constexpr (json::details::has_presence<json::reflection<T>>::value) node.bounds() = NodeBounds{};
+        else node.bounds.emplace();
+    }
+
+    void check_optional_members()
+    {
+        constexpr std::string_view inputs[][2] = {
+            { R"({"name":"a","id":null,"flags":[],"kind":"leaf","children":[]})", "000" },
+            { R"({"name":"a","id":null,"label":"x","flags":[],"kind":"leaf","children":[]})", "100" },
+            { R"({"name":"a","id":null,"flags":[],"kind":"leaf","children":[],"attributes":{}})", "010" },
+            { R"({"name":"a","id":null,"flags":[],"kind":"leaf","children":[],"bounds":{"min":0,"max":1}})", "001" },
+            { R"({"bounds":{"min":0,"max":1},"name":"a","id":1,"label":"","flags":[],"kind":"leaf","children":[]})",
+                "101" },
+        };
+
+        for (auto& test : inputs)
+        {
+            Node node;
+            if (!json::decode(test[0], node)) fail("optional members", test[0], "failed to decode");
+            else if (optional_members(node) != test[1]) fail("optional members", test[0], "gave " + optional_members(node));
+        }
+
+        // Setting one mustn't touch the others
+        Node node;
+        set_bounds(node);
+        if (optional_members(node) != "001") fail("optional members", "bounds set", "gave " + optional_members(node));
+    }
+
+    // json::parse, json::decode into a json::value and json::document have to agree on what's valid and what it holds
+    void check_parsers(std::string_view input)
+    {
+        json::value parsed, decoded;
+        json::document doc;
+        bool parseResult = json::parse(input, parsed);
+        bool decodeResult = json::decode(input, decoded);
+        bool documentResult = doc.parse(input);
+        if ((parseResult != decodeResult) || (parseResult != documentResult))
+        {
+            fail("parsers agree", input, std::string("parse ") + (parseResult ? "accepted" : "rejected") +
+                ", decode " + (decodeResult ? "accepted" : "rejected") +
+                ", document " + (documentResult ? "accepted" : "rejected"));
+            return;
+        }
+        // A 'raw_value' has to take exactly the text that parses, and leave what it held alone otherwise
+        json::raw_value raw;
+        raw.assign("[1]");
+        bool rawResult = raw.assign(input);
+        if (rawResult != parseResult) fail("raw_value assign", input, rawResult ? "accepted" : "rejected");
+        if (!rawResult && (raw.text() != "[1]")) fail("raw_value assign", input, "changed the contents on failure");
+        if (!parseResult) return;
+
+        // Short strings are stored inline, which a const 'get<string_t>()' has to copy out
+        const auto& constParsed = parsed;
+        if ((parsed.type() == json::value_type::string) && (constParsed.get<json::string_t>() != constParsed.string()))
+        {
+            fail("get<string_t>", input, "gave " + constParsed.get<json::string_t>());
+        }
+
+        std::string fromParse, fromDecode, fromDocument;
+        json::encode(parsed, fromParse);
+        json::encode(decoded, fromDecode);
+        json::encode(doc.root().to_value(), fromDocument);
+        if (rawResult)
+        {
+            std::string fromRaw;
+            json::encode(raw.get(), fromRaw);
+            if (fromRaw != fromParse) fail("raw_value get", input, "gave " + fromRaw);
+        }
+        if ((fromParse != fromDecode) || (fromParse != fromDocument))
+        {
+            fail("parsers agree", input, "parse gave " + fromParse + ", decode gave " + fromDecode +
+                ", document gave " + fromDocument);
+        }
+    }
+
+    // Every input that the compiled tables accept or reject has to get the same answer from the image
+    void check_image(const json::schema& definition, std::uint32_t type)
+    {
+        auto compare = [&](std::string_view input)
+        {
+            json::decode_error error;
+            if (json::validate(definition, type, input, &error) != json::validate<Node>(input))
+            {
+                fail("image matches tables", input, message_of(error));
+            }
+        };
+
+        for (auto& test : round_trips) compare(test.input);
+        for (auto input : rejects) compare(input);
+    }
+
+    // A damaged image has to be rejected when loaded, or else be safe to validate with. Under the sanitizers this
+    // catches any table that loading lets through but that validation then reads out of bounds
+    void check_corrupt_images(const std::vector<std::uint32_t>& original, std::size_t size)
+    {
+        auto copy = original;
+        auto bytes = reinterpret_cast<unsigned char*>(copy.data());
+        json::schema_image image;
+
+        for (std::size_t length = 0; length < size; ++length)
+        {
+            if (image.load(bytes, length)) fail("truncated image", "", std::to_string(length) + " bytes were loaded");
+        }
+
+        std::size_t loaded = 0;
+        for (std::size_t offset = 0; offset < size; ++offset)
+        {
+            for (unsigned char flip : { 0x01, 0x80, 0xFF })
+            {
+                bytes[offset] ^= flip;
+                if (image.load(bytes, size))
+                {
+                    // The magic, version and size are always checked as a whole
+                    if (offset < offsetof(json::schema_image_header, types))
+                    {
+                        fail("damaged header", "", "byte " + std::to_string(offset) + " was changed but loaded");
+                    }
+
+                    ++loaded;
+                    auto type = image.find_type("::Node");
+                    if (type != json::no_schema_type)
+                    {
+                        for (auto& test : round_trips) json::validate(image.definition, type, test.input);
+                        for (auto input : rejects) json::validate(image.definition, type, input);
+                    }
+                }
+                bytes[offset] = reinterpret_cast<const unsigned char*>(original.data())[offset];
+            }
+        }
+
+        std::printf("%zu of %zu corrupted images loaded, and validated without faults\n", loaded, size * 3);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2)
+    {
+        std::printf("USAGE: json_test <types.schema>\n");
+        std::printf("    Checks the JSON runtime against the types that ts2cpp generated from types.ts, and against\n");
+        std::printf("    the schema image that 'ts2cpp --image' wrote for them\n");
+        return 1;
+    }
+
+    check_round_trips();
+    check_rejects();
+    check_optional_members();
+    check_dispatch();
+
+    for (auto& test : round_trips) check_parsers(test.input);
+    for (auto input : rejects) check_parsers(input);
+    for (auto input : documents) check_parsers(input);
+
+    std::ifstream stream(argv[1], std::ios::binary);
+    std::string text(std::istreambuf_iterator<char>(stream), {});
+    if (text.empty())
+    {
+        std::printf("ERROR: Failed to read '%s'\n", argv[1]);
+        return 1;
+    }
+
+    // Images have to be 4 byte aligned
+    std::vector<std::uint32_t> storage((text.size() + 3) / 4);
+    std::memcpy(storage.data(), text.data(), text.size());
+
+    json::schema_image image;
+    if (!image.load(storage.data(), text.size()))
+    {
+        std::printf("ERROR: Failed to load '%s': %s\n", argv[1], image.error);
+        return 1;
+    }
+
+    auto type = image.find_type("::Node");
+    if (type == json::no_schema_type)
+    {
+        fail("find_type", "::Node", "is not in the image");
+    }
+    else
+    {
+        check_image(image.definition, type);
+    }
+
+    auto settingsType = image.find_type("::Settings");
+    if (settingsType == json::no_schema_type)
+    {
+        fail("find_type", "::Settings", "is not in the image");
+    }
+    else
+    {
+        check_names(image.definition, settingsType);
+    }
+
+    check_corrupt_images(storage, text.size());
+    check_maps();
+    check_stream();
+    check_batch();
+
+    if (failures)
+    {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+
+    std::printf("All checks passed\n");
+    return 0;
+}
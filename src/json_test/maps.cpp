@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <json_decode.h>
+#include <json_document.h>
+#include <json_parse.h>
+
+#include "check.h"
+
+namespace
+{
+    // What a map should hold, found by scanning every entry: keys in the order they first appeared, each with the
+    // last value given for it
+    using reference_map = std::vector<std::pair<std::string, std::string>>;
+
+    // Keys that share their length and first and last characters, so that the linear path's fingerprints can't tell
+    // them apart, along with a few that are one character off from them and aren't in the map
+    std::string key_of(std::size_t i) { return "k" + std::to_string(1000 + i) + "k"; }
+
+    const std::string missing_keys[] = { "", "k", "kk", "k999k", "k1000", "1000k", "k10000k", "K1000k" };
+
+    // An object with 'count' distinct keys. Every third key appears again later with a new value, which has to win
+    std::string make_object(std::size_t count, reference_map& reference)
+    {
+        reference.clear();
+        std::string text = "{";
+        auto add = [&](const std::string& key, const std::string& val)
+        {
+            if (text.size() > 1) text += ',';
+            text += "\"" + key + "\":\"" + val + "\"";
+            auto itr = std::find_if(reference.begin(), reference.end(), [&](auto& entry) { return entry.first == key; });
+            if (itr != reference.end()) itr->second = val;
+            else reference.emplace_back(key, val);
+        };
+
+        for (std::size_t i = 0; i < count; ++i) add(key_of(i), "first " + std::to_string(i));
+        for (std::size_t i = 0; i < count; i += 3) add(key_of(i), "last " + std::to_string(i));
+        return text + "}";
+    }
+
+    template <typename Map, typename Get>
+    void compare_map(const char* check, std::string_view input, const Map& map, const reference_map& reference,
+        Get&& get)
+    {
+        if (map.size() != reference.size())
+        {
+            fail(check, input, "has " + std::to_string(map.size()) + " keys, expected " +
+                std::to_string(reference.size()));
+            return;
+        }
+
+        // Iteration keeps the order in which keys first appeared
+        std::size_t i = 0;
+        for (auto& entry : map)
+        {
+            if (entry.first != reference[i].first)
+            {
+                fail(check, input, "has " + entry.first + " in place of " + reference[i].first);
+            }
+            ++i;
+        }
+
+        for (auto& entry : reference)
+        {
+            auto itr = map.find(entry.first);
+            if (itr == map.end()) fail(check, input, "didn't find " + entry.first);
+            else if (get(itr->second) != entry.second) fail(check, input, entry.first + " has " + get(itr->second));
+        }
+
+        for (auto& key : missing_keys)
+        {
+            if (map.find(key) != map.end()) fail(check, input, "found " + key);
+        }
+    }
+
+    void check_objects()
+    {
+        constexpr auto threshold = json::object_t::index_threshold;
+        for (std::size_t count : { threshold - 1, threshold, threshold + 1, threshold * 3 + 5, std::size_t(300) })
+        {
+            reference_map reference;
+            auto text = make_object(count, reference);
+            auto value_string = [](const json::value& val) { return std::string(val.string()); };
+
+            json::value parsed;
+            if (!json::parse(text, parsed)) fail("parse large object", text, "failed");
+            else compare_map("parse large object", text, parsed.object(), reference, value_string);
+
+            json::value decoded;
+            if (!json::decode(text, decoded)) fail("decode large object", text, "failed");
+            else compare_map("decode large object", text, decoded.object(), reference, value_string);
+
+            json::map_t<json::string_t> strings;
+            if (!json::decode(text, strings)) fail("decode large map", text, "failed");
+            else compare_map("decode large map", text, strings, reference, [](auto& str) { return str; });
+
+            // Documents keep every member, duplicates included, but lookups have to agree
+            json::document doc;
+            if (!doc.parse(text))
+            {
+                fail("document large object", text, "failed");
+                continue;
+            }
+
+            for (auto& entry : reference)
+            {
+                auto found = doc.root().try_get(entry.first);
+                if (!found || (found->string() != entry.second)) fail("document large object", text, entry.first);
+            }
+            for (auto& key : missing_keys)
+            {
+                if (doc.root().try_get(key)) fail("document large object", text, "found " + key);
+            }
+        }
+    }
+
+    // Adding and removing entries across the threshold, both ways, has to leave lookups working
+    void check_erase()
+    {
+        json::map_t<int> map;
+        reference_map reference;
+        auto compare = [&](const char* step)
+        {
+            compare_map(step, "", map, reference, [](int val) { return std::to_string(val); });
+        };
+
+        for (std::size_t i = 0; i < 100; ++i)
+        {
+            map[key_of(i)] = static_cast<int>(i);
+            reference.emplace_back(key_of(i), std::to_string(i));
+            if ((i + 1) % 7 == 0) compare("flat_map insert");
+        }
+
+        // From the middle, and then from the front until it drops back under the threshold
+        for (std::size_t i = 20; i < 60; i += 2)
+        {
+            map.erase(key_of(i));
+            reference.erase(std::find_if(reference.begin(), reference.end(),
+                [&](auto& entry) { return entry.first == key_of(i); }));
+        }
+        compare("flat_map erase");
+
+        while (map.size() > 3)
+        {
+            map.erase(map.begin());
+            reference.erase(reference.begin());
+            compare("flat_map erase below the threshold");
+        }
+
+        // Duplicates through each way of adding
+        map.emplace(reference[0].first, -1);
+        map.try_emplace(reference[1].first, -1);
+        map.insert({ reference[2].first, -1 });
+        compare("flat_map duplicate insert");
+    }
+}
+
+void check_maps()
+{
+    check_objects();
+    check_erase();
+}
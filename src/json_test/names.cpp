@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <json_decode.h>
+#include <json_encode.h>
+#include <json_validate.h>
+
+#include "check.h"
+#include "types.h"
+
+namespace
+{
+    // Names that are one character off from 'name': each character changed up and down by one, dropped or doubled,
+    // each pair of neighbours swapped, and a character added at either end
+    std::vector<std::string> near_misses(std::string_view name)
+    {
+        std::vector<std::string> result;
+        for (std::size_t i = 0; i < name.size(); ++i)
+        {
+            std::string text(name);
+            for (int delta : { -1, 1 })
+            {
+                text[i] = static_cast<char>(name[i] + delta);
+                result.push_back(text);
+            }
+
+            result.push_back(std::string(name.substr(0, i)) + std::string(name.substr(i + 1)));
+            result.push_back(std::string(name.substr(0, i + 1)) + std::string(name.substr(i)));
+            if (i + 1 < name.size())
+            {
+                text = name;
+                std::swap(text[i], text[i + 1]);
+                result.push_back(text);
+            }
+        }
+
+        result.push_back("_" + std::string(name));
+        result.push_back(std::string(name) + "_");
+        return result;
+    }
+
+    // Every name has to be found at its own index through the perfect hash, which has to have been generated, and
+    // anything else has to be reported as unknown
+    template <typename Info>
+    void check_hash(const char* check)
+    {
+        if constexpr (!json::details::has_name_hash<Info>::value)
+        {
+            fail(check, "", "has no perfect hash");
+        }
+        else
+        {
+            std::vector<std::size_t> slots;
+            for (auto slot : Info::hash_slots)
+            {
+                if (slot < Info::names.size()) slots.push_back(slot);
+            }
+            std::sort(slots.begin(), slots.end());
+            if ((slots.size() != Info::names.size()) || (std::unique(slots.begin(), slots.end()) != slots.end()))
+            {
+                fail(check, "", "doesn't give every name a slot of its own");
+            }
+
+            for (std::size_t i = 0; i < Info::names.size(); ++i)
+            {
+                auto index = json::details::find_name<Info>(Info::names[i]);
+                if (index != i) fail(check, Info::names[i], "was found at " + std::to_string(index));
+
+                for (auto& miss : near_misses(Info::names[i]))
+                {
+                    if (std::find(Info::names.begin(), Info::names.end(), miss) != Info::names.end()) continue;
+                    index = json::details::find_name<Info>(miss);
+                    if (index != Info::names.size()) fail(check, miss, "was found as " + std::string(Info::names[index]));
+                }
+            }
+
+            for (std::string_view unknown : { "", "option", "option0", "option25", "optionC", "level_", "zz", "\xff" })
+            {
+                if (json::details::find_name<Info>(unknown) != Info::names.size()) fail(check, unknown, "was found");
+            }
+        }
+    }
+
+    // Unknown keys are skipped, and unknown enumerators rejected, the same way by decoding, validation against the
+    // compiled tables and validation against the image, whose hashes are generated separately
+    void check_settings(const json::schema& definition, std::uint32_t type, std::string_view input,
+        std::string_view expected)
+    {
+        Settings settings;
+        json::decode_error error;
+        bool decoded = json::decode(input, settings, &error);
+        std::string output = decoded ? std::string() : message_of(error);
+        if (decoded) json::encode(settings, output);
+        if (output != expected) fail("decode with similar names", input, "gave " + output);
+
+        bool valid = json::validate<Settings>(input, &error);
+        if (valid != decoded) fail("validate with similar names", input, valid ? "was accepted" : message_of(error));
+        valid = json::validate(definition, type, input, &error);
+        if (valid != decoded) fail("image with similar names", input, valid ? "was accepted" : message_of(error));
+    }
+}
+
+void check_names(const json::schema& definition, std::uint32_t settingsType)
+{
+    check_hash<json::reflection<Settings>>("member hash");
+    check_hash<json::reflection<SettingsLevel>>("enumerator hash");
+
+    using members = json::reflection<Settings>;
+    for (std::size_t i = 0; i < members::names.size() - 1; ++i)
+    {
+        auto name = std::string(members::names[i]);
+        auto input = "{\"" + name + "\":" + std::to_string(i) + "}";
+        check_settings(definition, settingsType, input, input);
+
+        for (auto& miss : near_misses(name))
+        {
+            if (std::find(members::names.begin(), members::names.end(), miss) != members::names.end()) continue;
+            check_settings(definition, settingsType, "{\"" + miss + "\":" + std::to_string(i) + "}", "{}");
+        }
+    }
+
+    using enumerators = json::reflection<SettingsLevel>;
+    for (auto name : enumerators::names)
+    {
+        auto input = "{\"level\":\"" + std::string(name) + "\"}";
+        check_settings(definition, settingsType, input, input);
+
+        for (auto& miss : near_misses(name))
+        {
+            if (std::find(enumerators::names.begin(), enumerators::names.end(), miss) != enumerators::names.end()) continue;
+            check_settings(definition, settingsType, "{\"level\":\"" + miss + "\"}", "Unknown enumeration value");
+        }
+    }
+}
@@ -0,0 +1,375 @@
+#include <chrono>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <json_stream.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#endif
+
+#include "check.h"
+
+namespace
+{
+    struct pipe_ends
+    {
+        json::stream_handle read;
+        json::stream_handle write;
+    };
+
+    bool open_pipe(pipe_ends& ends)
+    {
+#ifdef _WIN32
+        return ::CreatePipe(&ends.read, &ends.write, nullptr, 0);
+#else
+        int fds[2];
+        if (::pipe(fds) != 0) return false;
+        ends = { fds[0], fds[1] };
+        return true;
+#endif
+    }
+
+    void close_handle(json::stream_handle handle)
+    {
+#ifdef _WIN32
+        ::CloseHandle(handle);
+#else
+        ::close(handle);
+#endif
+    }
+
+    void write_all(json::stream_handle handle, std::string_view text)
+    {
+        while (!text.empty())
+        {
+#ifdef _WIN32
+            DWORD written = 0;
+            if (!::WriteFile(handle, text.data(), static_cast<DWORD>(text.size()), &written, nullptr)) return;
+#else
+            auto written = ::write(handle, text.data(), text.size());
+            if (written < 0)
+            {
+                if (errno == EINTR) continue;
+                return;
+            }
+#endif
+            text.remove_prefix(static_cast<std::size_t>(written));
+        }
+    }
+
+    struct read_result
+    {
+        std::vector<std::string> bodies;
+        std::string error; // Empty if the stream ended cleanly
+        std::uint64_t read_count = 0;
+    };
+
+    // Stands in for a client: writes each chunk with a call of its own, pausing in between so that the reader has
+    // usually taken in one chunk before the next arrives, then closes its end. Whatever follows an error has to fit in
+    // the pipe's buffer, so that the client doesn't block on a reader that has given up
+    read_result read_messages(const std::vector<std::string>& chunks,
+        std::size_t maxMessageSize = json::message_reader::default_max_message_size)
+    {
+        read_result result;
+        pipe_ends ends;
+        if (!open_pipe(ends))
+        {
+            result.error = "Failed to create a pipe";
+            return result;
+        }
+
+        std::thread client([&]
+        {
+            for (auto& chunk : chunks)
+            {
+                write_all(ends.write, chunk);
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+            close_handle(ends.write);
+        });
+
+        json::message_reader reader(ends.read);
+        reader.max_message_size = maxMessageSize;
+        std::string_view body;
+        while (reader.next(body)) result.bodies.emplace_back(body);
+        if (reader.error.message) result.error = reader.error.message;
+        result.read_count = reader.read_count;
+
+        client.join();
+        close_handle(ends.read);
+        return result;
+    }
+
+    std::string frame(std::string_view body)
+    {
+        return "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + std::string(body);
+    }
+
+    std::string describe(const std::vector<std::string>& chunks)
+    {
+        std::string text;
+        for (auto& chunk : chunks)
+        {
+            if (!text.empty()) text += " | ";
+            text += (chunk.size() > 60) ? chunk.substr(0, 60) + "..." : chunk;
+        }
+        return text;
+    }
+
+    void expect_messages(const char* check, const std::vector<std::string>& chunks,
+        const std::vector<std::string>& bodies)
+    {
+        auto result = read_messages(chunks);
+        if (!result.error.empty()) fail(check, describe(chunks), "failed with " + result.error);
+        if (result.bodies != bodies)
+        {
+            fail(check, describe(chunks), "gave " + std::to_string(result.bodies.size()) + " messages, expected " +
+                std::to_string(bodies.size()));
+        }
+    }
+
+    void expect_error(const char* check, const std::vector<std::string>& chunks, std::string_view error,
+        std::size_t maxMessageSize = json::message_reader::default_max_message_size)
+    {
+        auto result = read_messages(chunks, maxMessageSize);
+        if (result.error != error) fail(check, describe(chunks), "failed with '" + result.error + "'");
+    }
+
+    void check_reader()
+    {
+        // Breaks inside the name, the value and the blank line of a header, and inside a body
+        expect_messages("split reads",
+            { "Content-Le", "ngth: 7\r", "\n\r", "\n{\"a\":", "1}Content-Length: 2\r\n", "\r\n[", "]" },
+            { "{\"a\":1}", "[]" });
+        expect_messages("split reads", { "Content-Length: 2\r\nContent-Type: application/json\r\n\r\n{}" }, { "{}" });
+
+        auto several = frame("{}") + frame("[1,2]") + frame("\"three\"");
+        auto result = read_messages({ several });
+        if (result.bodies != std::vector<std::string>{ "{}", "[1,2]", "\"three\"" } || !result.error.empty())
+        {
+            fail("several messages in one read", several, "gave " + std::to_string(result.bodies.size()) + " messages");
+        }
+        else if (result.read_count != 1)
+        {
+            fail("several messages in one read", several, "took " + std::to_string(result.read_count) + " reads");
+        }
+
+        // Larger than the initial buffer, so it has to grow
+        std::string large(300 * 1024, 'x');
+        large.front() = large.back() = '"';
+        expect_messages("message larger than the buffer", { frame("1"), frame(large), frame("2") },
+            { "1", large, "2" });
+
+        expect_error("missing Content-Length", { "Content-Type: application/json\r\n\r\n{}" },
+            "Message header has no Content-Length");
+        expect_error("missing ':'", { "Content-Length 2\r\n\r\n{}" }, "Expected ':' in message header");
+        expect_error("invalid Content-Length", { "Content-Length: 2x\r\n\r\n{}" }, "Invalid Content-Length");
+        expect_error("invalid Content-Length", { "Content-Length: -2\r\n\r\n{}" }, "Invalid Content-Length");
+        expect_error("invalid Content-Length", { "Content-Length: \r\n\r\n{}" }, "Invalid Content-Length");
+        expect_error("invalid Content-Length", { "Content-Length: 99999999999999999999999\r\n\r\n" },
+            "Invalid Content-Length");
+
+        // Before the limit, the first of these made the buffer size wrap around and the second hung the reader
+        expect_error("huge Content-Length", { "Content-Length: 18446744073709551615\r\n\r\n{}" },
+            "Content-Length exceeds the maximum message size");
+        expect_error("huge Content-Length", { "Content-Length: 9223372036854775809\r\n\r\n{}" },
+            "Content-Length exceeds the maximum message size");
+        expect_error("huge Content-Length", { frame(std::string(1001, ' ')) },
+            "Content-Length exceeds the maximum message size", 1000);
+        if (read_messages({ frame(std::string(1000, ' ')) }, 1000).bodies.size() != 1)
+        {
+            fail("Content-Length at the maximum", "Content-Length: 1000", "was rejected");
+        }
+
+        expect_error("header too long", { "X-Padding: " + std::string(json::message_reader::max_header_size, 'a') },
+            "Message header too long");
+        expect_error("header too long", { "X-Padding: ", std::string(json::message_reader::max_header_size, 'a'),
+            "\r\n\r\n" }, "Message header too long");
+
+        expect_error("end of stream in a body", { frame("{}"), "Content-Length: 10\r\n\r\n{\"a\"" },
+            "Unexpected end of stream");
+        expect_error("end of stream in a header", { "Content-Length: 10\r\n" }, "Unexpected end of stream");
+        expect_messages("end of stream between messages", {}, {});
+    }
+
+    // Stands in for a server: 'writeAll' writes through a 'message_writer' on a thread of its own, which then flushes
+    // and closes its end, while the bodies are read back with a 'message_reader'. With 'nonBlocking' the write end
+    // doesn't block, and the reader starts late, so that the writer finds the pipe full and has to wait for it
+    struct write_result
+    {
+        read_result read;
+        std::string error; // From the writer
+        std::uint64_t message_count = 0;
+        std::uint64_t write_count = 0;
+    };
+
+    write_result write_messages(const std::function<void(json::message_writer&)>& writeAll, bool nonBlocking = false,
+        const json::writer_options& options = {})
+    {
+        write_result result;
+        pipe_ends ends;
+        if (!open_pipe(ends))
+        {
+            result.error = "Failed to create a pipe";
+            return result;
+        }
+
+#ifndef _WIN32
+        if (nonBlocking) ::fcntl(ends.write, F_SETFL, ::fcntl(ends.write, F_GETFL) | O_NONBLOCK);
+#else
+        static_cast<void>(nonBlocking); // Anonymous pipes always block
+#endif
+
+        std::thread server([&]
+        {
+            {
+                json::message_writer writer(ends.write, options);
+                writeAll(writer);
+                // A write that failed along the way leaves its error behind even if a later one got through
+                writer.flush();
+                if (writer.error) result.error = writer.error;
+                result.message_count = writer.message_count;
+                result.write_count = writer.write_count;
+            }
+            close_handle(ends.write);
+        });
+
+        if (nonBlocking) std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        json::message_reader reader(ends.read);
+        std::string_view body;
+        while (reader.next(body)) result.read.bodies.emplace_back(body);
+        if (reader.error.message) result.read.error = reader.error.message;
+
+        server.join();
+        close_handle(ends.read);
+        return result;
+    }
+
+    void expect_written(const char* check, const write_result& result, const std::vector<std::string>& bodies)
+    {
+        if (!result.error.empty()) fail(check, "", "writer failed with " + result.error);
+        if (!result.read.error.empty()) fail(check, "", "reader failed with " + result.read.error);
+        if (result.read.bodies != bodies)
+        {
+            std::size_t i = 0;
+            while ((i < bodies.size()) && (i < result.read.bodies.size()) && (bodies[i] == result.read.bodies[i])) ++i;
+            fail(check, "", "read " + std::to_string(result.read.bodies.size()) + " of " +
+                std::to_string(bodies.size()) + " messages, differing from message " + std::to_string(i));
+        }
+    }
+
+    // Everything the writer sends, read straight from the pipe
+    std::string written_text(const std::function<void(json::message_writer&)>& writeAll)
+    {
+        pipe_ends ends;
+        if (!open_pipe(ends)) return {};
+
+        std::string text;
+        std::thread client([&]
+        {
+            char chunk[4096];
+            while (true)
+            {
+#ifdef _WIN32
+                DWORD count = 0;
+                if (!::ReadFile(ends.read, chunk, sizeof(chunk), &count, nullptr) || (count == 0)) break;
+#else
+                auto count = ::read(ends.read, chunk, sizeof(chunk));
+                if ((count < 0) && (errno == EINTR)) continue;
+                if (count <= 0) break;
+#endif
+                text.append(chunk, static_cast<std::size_t>(count));
+            }
+        });
+
+        {
+            json::message_writer writer(ends.write);
+            writeAll(writer);
+        }
+        close_handle(ends.write);
+        client.join();
+        close_handle(ends.read);
+        return text;
+    }
+
+    void check_writer()
+    {
+        // The header is sized by the number of digits in the length, and written right aligned into the gap before
+        // the body, so lengths either side of each change in the digit count are where it would go wrong
+        std::vector<std::string> bodies;
+        for (std::size_t size : { 2, 9, 10, 11, 99, 100, 101, 999, 1000, 9999, 10000, 99999, 100000, 100001 })
+        {
+            std::string body(size, 'a');
+            body.front() = body.back() = '"';
+            bodies.push_back(std::move(body));
+        }
+
+        auto text = written_text([&](json::message_writer& writer)
+        {
+            for (auto& body : bodies) writer.write_text(body);
+        });
+        std::string expected;
+        for (auto& body : bodies) expected += frame(body);
+        if (text != expected) fail("writer framing", describe({ text }), "differs from " + describe({ expected }));
+
+        // Typed messages go through the encoder
+        json::object_t object;
+        object["a"] = 1;
+        object["b"] = "two";
+        text = written_text([&](json::message_writer& writer)
+        {
+            writer.write(json::value(object));
+            writer.write(json::value(json::null_t{}));
+        });
+        if (text != frame(R"({"a":1,"b":"two"})") + frame("null")) fail("writer framing", text, "for typed messages");
+
+        auto result = write_messages([&](json::message_writer& writer)
+        {
+            for (auto& body : bodies) writer.write_text(body);
+        });
+        expect_written("writer round trip", result, bodies);
+
+        // Much larger than a pipe's buffer, so 'writev' only takes part of it at a time
+        std::vector<std::string> large = { "1", std::string(4 * 1024 * 1024, ' '), "2", std::string(300 * 1024, ' '), "3" };
+        large[1].front() = large[1].back() = large[3].front() = large[3].back() = '"';
+        auto writeLarge = [&](json::message_writer& writer)
+        {
+            for (auto& body : large) writer.write_text(body);
+        };
+        result = write_messages(writeLarge);
+        expect_written("writer short writes", result, large);
+        if (result.write_count < 2)
+        {
+            fail("writer short writes", "", "took " + std::to_string(result.write_count) + " writes for 4 MB");
+        }
+
+        // Lots of small messages, sent in batches, with a non-blocking write end that fills up before the reader starts
+        std::vector<std::string> many;
+        for (int i = 0; i < 20000; ++i) many.push_back("{\"seq\":" + std::to_string(i) + "}");
+        json::writer_options options;
+        options.max_pending_bytes = 16 * 1024;
+        result = write_messages([&](json::message_writer& writer)
+        {
+            for (auto& body : many) writer.write_text(body);
+        }, true, options);
+        expect_written("writer without blocking", result, many);
+        if ((result.message_count != many.size()) || (result.write_count >= many.size()))
+        {
+            fail("writer without blocking", "", std::to_string(result.message_count) + " messages took " +
+                std::to_string(result.write_count) + " writes");
+        }
+
+        result = write_messages(writeLarge, true);
+        expect_written("writer without blocking", result, large);
+    }
+}
+
+void check_stream()
+{
+    check_reader();
+    check_writer();
+}
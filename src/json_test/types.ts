@@ -0,0 +1,31 @@
+// Types that json_test round-trips; each member is here for one of the cases it checks
+export interface Node {
+    name: string;
+
+    /** Required but nullable, so written out as null when empty. @integer */
+    id: number | null;
+
+    /** May be left out; null is read the same as leaving it out */
+    label?: string;
+
+    flags: boolean[];
+    kind: 'leaf' | 'branch';
+    children: Node[];
+    attributes?: { [key: string]: string };
+    bounds?: { min: number; max: number | null; };
+}
+
+
+/** Enough members and enumerators, many of them alike, that the perfect hashes have collisions to work around */
+export interface Settings {
+    option1?: number; option2?: number; option3?: number; option4?: number; option5?: number; option6?: number;
+    option7?: number; option8?: number; option9?: number; option10?: number; option11?: number; option12?: number;
+    option13?: number; option14?: number; option15?: number; option16?: number; option17?: number; option18?: number;
+    option19?: number; option20?: number; option21?: number; option22?: number; option23?: number; option24?: number;
+    optionA?: number; optiona?: number; optionB?: number;
+    value?: number; valeu?: number; vaule?: number;
+    x?: number; y?: number; xy?: number; yx?: number; xx?: number;
+    name?: number; nome?: number; mane?: number;
+    level?: 'l0' | 'l1' | 'l2' | 'l3' | 'l4' | 'l5' | 'l6' | 'l7' | 'l8' | 'l9' | 'l10' | 'l11' | 'l12' | 'l13' |
+        'l14' | 'l15' | 'l16' | 'l17' | 'l18' | 'l19' | 'trace' | 'debug' | 'Debug' | 'info' | 'infp' | 'warn' | 'wran';
+}
@@ -1,58 +1,192 @@
 #pragma once
 
-#include <memory>
-#include <string>
-#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+
+#include <arena.h>
+#include "symbol_table.h"
 
 namespace ast
 {
+    // Growable array whose storage lives in an arena. Growing copies the elements into a new, larger allocation and
+    // leaves the old one for the arena to reclaim, so elements must be trivially copyable
+    template <typename T>
+    struct list
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        void push_back(ts2cpp::arena& storage, T value)
+        {
+            if (count == capacity)
+            {
+                auto newCapacity = capacity ? capacity * 2 : 4;
+                auto newData = storage.allocate_array<T>(newCapacity);
+                if (count) std::memcpy(newData, data, count * sizeof(T));
+                data = newData;
+                capacity = newCapacity;
+            }
+
+            data[count++] = value;
+        }
+
+        std::size_t size() const noexcept { return count; }
+        bool empty() const noexcept { return count == 0; }
+
+        T* begin() noexcept { return data; }
+        const T* begin() const noexcept { return data; }
+        T* end() noexcept { return data + count; }
+        const T* end() const noexcept { return data + count; }
+
+        T& operator[](std::size_t index) noexcept { return data[index]; }
+        const T& operator[](std::size_t index) const noexcept { return data[index]; }
+
+        T* data = nullptr;
+        std::uint32_t count = 0;
+        std::uint32_t capacity = 0;
+    };
+
+    enum class node_kind
+    {
+        file,
+        module,
+        member,
+        object,
+        interface,
+        type_alias,
+        interface_reference,
+        fundamental_type_reference,
+        array,
+        enumeration,
+        union_type,
+    };
+
+    struct module;
+
+    // Identifies a named declaration by the module it's declared in (null for the file scope) and its name
+    struct scoped_name
+    {
+        const module* scope;
+        symbol name;
+
+        bool operator==(const scoped_name& other) const noexcept
+        {
+            return (scope == other.scope) && (name == other.name);
+        }
+    };
+
+    struct scoped_name_hash
+    {
+        std::size_t operator()(const scoped_name& key) const noexcept
+        {
+            return (std::hash<const void*>{}(key.scope) * 31) ^ std::hash<std::uint32_t>{}(static_cast<std::uint32_t>(key.name));
+        }
+    };
+
+    // NOTE: With the exception of 'file', all nodes are allocated out of the owning file's arena and are never
+    // destroyed, so they must not own any memory outside of the arena
     struct node
     {
-        virtual ~node() {}
+        node(node_kind kind) : kind(kind) {}
 
+        node_kind kind;
         node* parent = nullptr;
     };
 
     struct file : node
     {
+        file() : node(node_kind::file), symbols(storage) {}
+
         bool strict = false;
-        std::vector<node*> children;
+        list<node*> children;
+
+        // Backing storage for all nodes in the file. Must be declared before anything that allocates from it
+        ts2cpp::arena storage;
 
-        // For cleanup
-        std::vector<std::unique_ptr<node>> nodes;
+        // Names used anywhere in the file are interned here
+        symbol_table symbols;
+
+        // Every interface and type alias, filled in by 'resolve_file'
+        std::unordered_map<scoped_name, node*, scoped_name_hash> declarations;
+
+        template <typename T, typename... Args>
+        T* make(Args&&... args)
+        {
+            return storage.make<T>(std::forward<Args>(args)...);
+        }
     };
 
     struct module : node
     {
+        module() : node(node_kind::module) {}
+
         bool is_export = false;
-        std::string name;
-        std::vector<node*> children;
+        symbol name;
+        list<node*> children;
     };
 
     struct member : node
     {
+        member() : node(node_kind::member) {}
+
         bool is_optional = false;
-        std::string name;
+        bool is_integer = false; // Annotated with "@integer" in a preceding comment
+        symbol name;
         node* type;
     };
 
+    // A member whose value is fixed for a given interface and tells it apart from the other interfaces that extend the
+    // same base, e.g. "command: 'initialize';". Also picked up from comments of the same form, which is how proto.ts
+    // writes them
+    struct discriminator
+    {
+        symbol name;
+        symbol value;
+    };
+
     struct object : node
     {
-        std::vector<member*> named_members;
-        // TODO: unnamed members (i.e. arbitrary key:value pairs)
+        object() : node(node_kind::object) {}
+
+        list<member*> named_members;
+        list<discriminator> discriminators;
+
+        // Type of the values for arbitrary key:value pairs (i.e. '[key: string]: type'), or null if not allowed
+        node* index_type = nullptr;
     };
 
     struct interface : node
     {
+        interface() : node(node_kind::interface) {}
+
         bool is_export = false;
         node* base = nullptr;
-        std::string name;
+        symbol name;
         object* definition = nullptr;
+
+        // Members of the base (recursively) followed by the interface's own, with redeclared members replacing the
+        // base's in place. Filled in by 'resolve_file'
+        list<member*> all_members;
+    };
+
+    struct type_alias : node
+    {
+        type_alias() : node(node_kind::type_alias) {}
+
+        bool is_export = false;
+        symbol name;
+        node* type = nullptr;
     };
 
     struct interface_reference : node
     {
-        std::string name;
+        interface_reference() : node(node_kind::interface_reference) {}
+
+        symbol name;
+        node* declaration = nullptr; // The interface or type alias that 'name' refers to, bound by 'resolve_file'
     };
 
     enum class fundamental_type
@@ -61,21 +195,34 @@ namespace ast
         boolean,
         number,
         string,
+        null,
     };
 
     struct fundamental_type_reference : node
     {
         fundamental_type type;
-        fundamental_type_reference(fundamental_type type) : type(type) {}
+        fundamental_type_reference(fundamental_type type) : node(node_kind::fundamental_type_reference), type(type) {}
     };
 
     struct array : node
     {
+        array() : node(node_kind::array) {}
+
         node* type;
     };
 
     struct enumeration : node
     {
-        std::vector<std::string> values;
+        enumeration() : node(node_kind::enumeration) {}
+
+        list<symbol> values;
+    };
+
+    // E.g. 'string | null'. Unions of only string literals are parsed as an 'enumeration' instead
+    struct union_type : node
+    {
+        union_type() : node(node_kind::union_type) {}
+
+        list<node*> types;
     };
 }
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+
+// Collects the messages produced while processing a single file. Files may be processed concurrently, so nothing is
+// written directly to the console; the driver prints each file's messages once that file is done
+struct diagnostics
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    void print(const char* format, ...)
+    {
+        va_list args;
+        va_start(args, format);
+        char buffer[512];
+        auto len = std::vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+
+        if (len < 0)
+        {
+            return;
+        }
+        else if (static_cast<std::size_t>(len) < sizeof(buffer))
+        {
+            text.append(buffer, static_cast<std::size_t>(len));
+        }
+        else
+        {
+            // Message too long for the stack buffer; format again directly into the output
+            auto offset = text.size();
+            text.resize(offset + static_cast<std::size_t>(len) + 1);
+            va_start(args, format);
+            std::vsnprintf(text.data() + offset, static_cast<std::size_t>(len) + 1, format, args);
+            va_end(args);
+            text.pop_back(); // Null terminator
+        }
+    }
+
+    std::string text;
+};
@@ -0,0 +1,1586 @@
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <json.h>
+#include <json_schema_image.h>
+
+#include "generator.h"
+#include "resolver.h"
+
+using namespace std::literals;
+
+static constexpr std::string_view cpp_keywords[] = {
+    "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch", "char",
+    "char16_t", "char32_t", "char8_t", "class", "co_await", "co_return", "co_yield", "compl", "concept", "const",
+    "const_cast", "consteval", "constexpr", "constinit", "continue", "decltype", "default", "delete", "do", "double",
+    "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false", "float", "for", "friend", "goto", "if",
+    "inline", "int", "long", "mutable", "namespace", "new", "noexcept", "not", "not_eq", "nullptr", "operator", "or",
+    "or_eq", "private", "protected", "public", "register", "reinterpret_cast", "requires", "return", "short", "signed",
+    "sizeof", "static", "static_assert", "static_cast", "struct", "switch", "template", "this", "thread_local", "throw",
+    "true", "try", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual", "void", "volatile",
+    "wchar_t", "while", "xor", "xor_eq",
+};
+
+static bool is_cpp_keyword(std::string_view str) noexcept
+{
+    return std::find(std::begin(cpp_keywords), std::end(cpp_keywords), str) != std::end(cpp_keywords);
+}
+
+static constexpr bool is_identifier_character(char ch) noexcept
+{
+    return ((ch >= 'A') && (ch <= 'Z')) || ((ch >= 'a') && (ch <= 'z')) || ((ch >= '0') && (ch <= '9')) || (ch == '_');
+}
+
+// Converts an arbitrary string (e.g. an enum value such as 'function breakpoint') into a valid C++ identifier
+static std::string make_identifier(std::string_view str)
+{
+    std::string result;
+    if (str.empty() || ((str[0] >= '0') && (str[0] <= '9')))
+    {
+        result.push_back('_');
+    }
+
+    for (auto ch : str)
+    {
+        result.push_back(is_identifier_character(ch) ? ch : '_');
+    }
+
+    if (is_cpp_keyword(result))
+    {
+        result.push_back('_');
+    }
+
+    return result;
+}
+
+static std::string pascal_case(std::string_view str)
+{
+    std::string result(str);
+    if (!result.empty() && (result[0] >= 'a') && (result[0] <= 'z'))
+    {
+        result[0] = static_cast<char>(result[0] - 'a' + 'A');
+    }
+
+    return make_identifier(result);
+}
+
+static void append_string_literal(std::string& out, std::string_view str)
+{
+    out.push_back('"');
+    for (auto ch : str)
+    {
+        if ((ch == '"') || (ch == '\\')) out.push_back('\\');
+        out.push_back(ch);
+    }
+    out.push_back('"');
+}
+
+// Escapes 'str' for use within a JSON string. TypeScript names never contain control characters, so quotes and
+// backslashes are all we need to worry about
+static void append_json_escaped(std::string& out, std::string_view str)
+{
+    for (auto ch : str)
+    {
+        if ((ch == '"') || (ch == '\\')) out.push_back('\\');
+        out.push_back(ch);
+    }
+}
+
+namespace
+{
+    // Parameters for 'json::details::name_hash' under which every name gets its own slot
+    struct perfect_hash
+    {
+        std::uint32_t seed = 0;
+        std::vector<std::uint8_t> positions;
+        std::vector<std::size_t> slots; // Name index for each slot, or the number of names if unused
+    };
+}
+
+// Picks character positions that tell every name apart, then searches for a seed that maps each name to its own slot.
+// Fails if the names can only be told apart beyond the first 256 characters, in which case lookups compare names
+static bool build_perfect_hash(const std::vector<std::string_view>& names, perfect_hash& result)
+{
+    auto count_distinct = [&](const std::vector<std::uint8_t>& positions)
+    {
+        std::set<std::pair<std::size_t, std::string>> seen;
+        for (auto name : names)
+        {
+            std::string chars;
+            for (auto pos : positions) chars.push_back((pos < name.size()) ? name[pos] : '\0');
+            seen.emplace(name.size(), std::move(chars));
+        }
+        return seen.size();
+    };
+
+    // Any two names that still look the same differ at some position, so each round tells at least one more name apart
+    std::size_t maxLength = 0;
+    for (auto name : names) maxLength = std::max(maxLength, std::min<std::size_t>(name.size(), 256));
+
+    result.positions.clear();
+    auto distinct = count_distinct(result.positions);
+    while (distinct < names.size())
+    {
+        std::size_t bestPos = maxLength, bestDistinct = distinct;
+        for (std::size_t pos = 0; pos < maxLength; ++pos)
+        {
+            if (std::find(result.positions.begin(), result.positions.end(), pos) != result.positions.end()) continue;
+
+            auto candidate = result.positions;
+            candidate.push_back(static_cast<std::uint8_t>(pos));
+            if (auto count = count_distinct(candidate); count > bestDistinct)
+            {
+                bestPos = pos;
+                bestDistinct = count;
+            }
+        }
+
+        if (bestPos == maxLength) return false;
+        result.positions.push_back(static_cast<std::uint8_t>(bestPos));
+        distinct = bestDistinct;
+    }
+
+    std::vector<std::uint32_t> hashes(names.size());
+    std::size_t tableSize = 1;
+    while (tableSize < names.size()) tableSize *= 2;
+
+    // Larger tables make a collision free seed much easier to find, at the cost of a few bytes per slot
+    for (int growth = 0; growth < 4; ++growth, tableSize *= 2)
+    {
+        // Skip sizes where even a good hash would almost never land every name in its own slot. Searching them only
+        // wastes time on objects with dozens of members
+        double logChance = 0;
+        for (std::size_t i = 1; i < names.size(); ++i)
+        {
+            logChance += std::log1p(-static_cast<double>(i) / static_cast<double>(tableSize));
+        }
+        if ((growth < 3) && (logChance < std::log(0.01 / 10000))) continue;
+
+        for (std::uint32_t seed = 0; seed < 10000; ++seed)
+        {
+            result.slots.assign(tableSize, names.size());
+            bool collision = false;
+            for (std::size_t i = 0; (i < names.size()) && !collision; ++i)
+            {
+                auto& slot = result.slots[json::details::name_hash(names[i], seed, result.positions.data(),
+                    result.positions.size()) & (tableSize - 1)];
+                collision = (slot != names.size());
+                slot = i;
+            }
+
+            if (!collision)
+            {
+                result.seed = seed;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// Writes the 'hash_*' members that 'json::details::find_name' looks names up with, if there's a perfect hash for them
+static void write_name_hash(const std::vector<std::string_view>& names, std::string& output)
+{
+    perfect_hash hash;
+    if (!names.empty() && build_perfect_hash(names, hash))
+    {
+        output += "        static constexpr std::uint32_t hash_seed = " + std::to_string(hash.seed) + ";\n";
+        output += "        static constexpr std::array<std::uint8_t, " + std::to_string(hash.positions.size()) +
+            "> hash_positions = {";
+        for (std::size_t i = 0; i < hash.positions.size(); ++i)
+        {
+            output += (i == 0) ? " " : ", ";
+            output += std::to_string(hash.positions[i]);
+        }
+        output += hash.positions.empty() ? "};\n" : " };\n";
+
+        output += "        static constexpr std::array<";
+        output += (names.size() < 0xFF) ? "std::uint8_t" : "std::uint16_t";
+        output += ", " + std::to_string(hash.slots.size()) + "> hash_slots = {";
+        for (std::size_t i = 0; i < hash.slots.size(); ++i)
+        {
+            output += (i % 16 == 0) ? "\n            " : " ";
+            output += std::to_string(hash.slots[i]) + ",";
+        }
+        output += "\n        };\n";
+    }
+}
+
+namespace
+{
+    // Where the declarations for a module (or the file scope) get written to
+    struct namespace_output
+    {
+        const ast::module* scope = nullptr;
+        std::string qualifier; // E.g. "DebugProtocol::"
+        std::string body;
+        std::unordered_set<std::string> names;
+    };
+
+    // How strictly a type is aligned, for ordering the members of compact structs. Strings, vectors and the like rank
+    // below 'double' since they're only 4 byte aligned on 32-bit targets
+    enum class field_alignment
+    {
+        one,
+        two,
+        pointer,
+        eight,
+    };
+
+    // The C++ spelling of a TypeScript type, along with what we need to know to describe it in the reflection tables
+    struct type_info
+    {
+        std::string name;
+        std::string_view tag; // Name of the 'json::type_tag' enumerator
+        bool is_optional = false; // I.e. 'json::optional_t<...>'
+        field_alignment align = field_alignment::pointer;
+        std::size_t size = 0; // When the same on every target, otherwise zero
+    };
+
+    // Everything needed to write the 'json::reflection' specialization for a type once all namespaces are closed
+    struct reflected_member
+    {
+        std::string json_name;
+        std::string cpp_name;
+        std::string_view tag;
+        bool is_optional; // May be left out, i.e. 'foo?: T'
+        bool is_nullable; // May be null, i.e. 'foo: T | null'
+    };
+
+    struct reflected_type
+    {
+        const ast::node* source; // The interface, inline object, or enumeration that the type was generated from
+        std::string qualified_name;
+        bool is_enum = false;
+        std::string presence; // Name of the 'json::presence' member of compact structs with optional members
+        std::vector<reflected_member> members; // Structs
+        std::vector<std::string_view> values; // Enums
+        std::uint32_t schema_index = 0;
+    };
+
+    // Fields of the validation tables, before the names get gathered into the string table of 'json::schema'
+    struct schema_field_entry
+    {
+        std::string_view name;
+        std::uint32_t type;
+        bool optional;
+    };
+
+    // A std::variant over the interfaces that directly extend 'base' and are told apart by the value of their 'key'
+    // member. The base itself is the first alternative, which catches any value that isn't listed
+    struct message_family
+    {
+        const ast::interface* base = nullptr;
+        ast::symbol key;
+        std::vector<std::pair<const ast::interface*, ast::symbol>> alternatives; // Along with their value of 'key'
+        namespace_output* ns = nullptr; // Where the variant gets declared, once it has been
+        std::string name;
+        std::uint32_t schema_index = 0;
+        bool has_schema = false;
+    };
+
+    // Naming context for types declared inline, e.g. 'ComputerScreen' for 'Computer.screen'
+    struct naming_context
+    {
+        namespace_output* ns;
+        std::string_view owner; // The enclosing, user named, interface
+        std::string_view parent; // The enclosing struct, which may itself have been hoisted
+        bool integer = false; // The member was annotated with "@integer", so numbers within it are integers
+    };
+
+    enum class emit_state
+    {
+        in_progress,
+        done,
+    };
+
+    struct generator
+    {
+        generator(const ast::file& file, const generator_options& options, diagnostics& diag) :
+            file(file),
+            options(options),
+            diag(diag)
+        {
+        }
+
+        bool run(std::string_view sourceName, std::string& output, std::string* image);
+
+    private:
+        const char* str(ast::symbol sym) const { return file.symbols.c_str(sym); }
+
+        void add_namespace(const ast::module* scope, const ast::list<ast::node*>& children);
+        std::string unique_name(namespace_output& ns, std::string name, std::string fallback);
+
+        bool emit_declaration(const ast::node* decl);
+        bool emit_interface(const ast::interface* iface);
+        bool emit_alias(const ast::type_alias* alias);
+        bool emit_struct(const ast::node* source, const std::string& name,
+            const std::vector<const ast::member*>& members, std::string_view owner, namespace_output& ns);
+        void emit_enum(const ast::enumeration* defn, const std::string& name, namespace_output& ns);
+        type_info enum_type(const ast::enumeration* defn, std::string name) const;
+
+        const ast::interface* find_base(const ast::interface* iface) const;
+        bool has_member(const ast::interface* iface, ast::symbol name) const;
+        const ast::discriminator* find_discriminator(const ast::interface* iface, const ast::symbol* key) const;
+        bool add_families();
+        void emit_family(message_family& family);
+
+        bool resolve_type(const ast::node* type, const naming_context& context, std::string_view memberName,
+            type_info& result);
+
+        std::uint32_t add_schema_type(json::schema_op op, std::uint32_t first = 0, std::uint32_t count = 0);
+        std::uint32_t add_schema_string(std::string_view str);
+        std::uint32_t append_schema_fields(const std::vector<schema_field_entry>& fields);
+        std::uint32_t add_schema_fields(std::vector<schema_field_entry>& fields);
+        std::uint32_t add_schema_hash(const std::vector<schema_field_entry>& fields, std::size_t skip = 0);
+        std::uint32_t schema_object(const ast::node* source, const ast::list<ast::member*>& members);
+        std::uint32_t schema_index(const ast::node* type, bool integer);
+        std::uint32_t schema_family(message_family& family);
+        void build_schema();
+        void write_schema(std::string& output) const;
+        void write_image(std::string& image) const;
+
+        void write_reflection(const reflected_type& info, std::string& output) const;
+        void write_dispatch(const message_family& family, std::string& output) const;
+
+        const ast::file& file;
+        const generator_options& options;
+        diagnostics& diag;
+
+        std::vector<std::unique_ptr<namespace_output>> namespaces;
+        std::unordered_map<const ast::node*, namespace_output*> owners; // Where each named declaration lives
+        std::unordered_map<const ast::node*, emit_state> states;
+        std::unordered_set<const ast::node*> forward_declared;
+        int indirection = 0; // Arrays and maps around the type being resolved, which can hold an incomplete struct
+        std::unordered_map<const ast::node*, type_info> inline_types; // Hoisted inline objects & enums
+        std::unordered_map<std::string, type_info> struct_types; // Keyed by qualified name
+        std::vector<reflected_type> reflected;
+        std::vector<message_family> families; // In order of each base's first derived interface
+
+        std::string schema_name; // Of the 'json::schemas' entry for the file
+        std::vector<json::schema_type> schema_types;
+        std::vector<json::schema_field> schema_fields;
+        std::string schema_strings;
+        std::unordered_map<std::string_view, std::uint32_t> schema_string_offsets;
+        std::vector<json::schema_hash> schema_hashes;
+        std::vector<std::uint8_t> schema_bytes; // Hash positions and slots
+        std::unordered_map<const ast::node*, std::uint32_t> schema_nodes; // Interfaces, inline objects, and enumerations
+        std::map<std::tuple<json::schema_op, std::uint32_t, std::uint32_t>, std::uint32_t> schema_shapes; // The rest
+    };
+}
+
+static const ast::node* nullable_type(const ast::union_type* type)
+{
+    if (type->types.size() != 2) return nullptr;
+
+    auto is_null = [](const ast::node* node)
+    {
+        return (node->kind == ast::node_kind::fundamental_type_reference) &&
+            (static_cast<const ast::fundamental_type_reference*>(node)->type == ast::fundamental_type::null);
+    };
+
+    if (is_null(type->types[0])) return type->types[1];
+    else if (is_null(type->types[1])) return type->types[0];
+    return nullptr;
+}
+
+void generator::add_namespace(const ast::module* scope, const ast::list<ast::node*>& children)
+{
+    auto ns = std::make_unique<namespace_output>();
+    ns->scope = scope;
+    ns->qualifier = scope ? std::string(str(scope->name)) + "::" : "::";
+
+    // Reserve the user supplied names up front so that generated names never collide with them
+    for (auto child : children)
+    {
+        if (child->kind == ast::node_kind::interface)
+        {
+            ns->names.insert(str(static_cast<const ast::interface*>(child)->name));
+            owners.emplace(child, ns.get());
+        }
+        else if (child->kind == ast::node_kind::type_alias)
+        {
+            ns->names.insert(str(static_cast<const ast::type_alias*>(child)->name));
+            owners.emplace(child, ns.get());
+        }
+    }
+
+    namespaces.push_back(std::move(ns));
+}
+
+std::string generator::unique_name(namespace_output& ns, std::string name, std::string fallback)
+{
+    if (ns.names.insert(name).second) return name;
+    if (ns.names.insert(fallback).second) return fallback;
+
+    for (int i = 2; ; ++i)
+    {
+        auto candidate = fallback + std::to_string(i);
+        if (ns.names.insert(candidate).second) return candidate;
+    }
+}
+
+bool generator::emit_declaration(const ast::node* decl)
+{
+    if (auto itr = states.find(decl); itr != states.end())
+    {
+        // NOTE: A struct that's still in progress is incomplete, which is fine within an array or map since they're
+        // stored on the heap, but anything else (e.g. 'next?: Node') would have to contain itself
+        if (itr->second == emit_state::done) return true;
+        if (decl->kind == ast::node_kind::interface && indirection > 0)
+        {
+            // Other structs (e.g. 'B' in 'A { bs: B[] }', 'B { as: A[] }') get written out first, so need a declaration
+            if (forward_declared.insert(decl).second)
+            {
+                owners[decl]->body += "    struct " + std::string(str(static_cast<const ast::interface*>(decl)->name)) +
+                    ";\n\n";
+            }
+            return true;
+        }
+
+        auto name = (decl->kind == ast::node_kind::interface) ?
+            str(static_cast<const ast::interface*>(decl)->name) : str(static_cast<const ast::type_alias*>(decl)->name);
+        diag.print("ERROR: Type '%s' refers back to itself other than through an array or map\n", name);
+        return false;
+    }
+
+    // Each struct starts out incomplete, whatever holds it
+    auto outerIndirection = std::exchange(indirection, 0);
+    states.emplace(decl, emit_state::in_progress);
+    bool result = (decl->kind == ast::node_kind::interface) ?
+        emit_interface(static_cast<const ast::interface*>(decl)) :
+        emit_alias(static_cast<const ast::type_alias*>(decl));
+    states[decl] = emit_state::done;
+    indirection = outerIndirection;
+    return result;
+}
+
+bool generator::emit_interface(const ast::interface* iface)
+{
+    // The base, including any types it declares inline, must be named before we can reuse its members
+    if (auto base = find_base(iface); base && !emit_declaration(base))
+    {
+        diag.print("NOTE: While generating interface '%s'\n", str(iface->name));
+        return false;
+    }
+
+    std::vector<const ast::member*> members(iface->all_members.begin(), iface->all_members.end());
+    if (!emit_struct(iface, str(iface->name), members, str(iface->name), *owners[iface]))
+    {
+        diag.print("NOTE: While generating interface '%s'\n", str(iface->name));
+        return false;
+    }
+
+    return true;
+}
+
+bool generator::emit_alias(const ast::type_alias* alias)
+{
+    auto& ns = *owners[alias];
+    std::string name = str(alias->name);
+    if (alias->type->kind == ast::node_kind::enumeration)
+    {
+        // Named enumerations, e.g. "type Color = 'red' | 'green';"
+        inline_types.emplace(alias->type, enum_type(static_cast<const ast::enumeration*>(alias->type), name));
+        emit_enum(static_cast<const ast::enumeration*>(alias->type), name, ns);
+        return true;
+    }
+
+    type_info type;
+    naming_context context{ &ns, name, name };
+    if (!resolve_type(alias->type, context, {}, type))
+    {
+        diag.print("NOTE: While generating type alias '%s'\n", name.c_str());
+        return false;
+    }
+
+    ns.body += "    using " + name + " = " + type.name + ";\n\n";
+    return true;
+}
+
+bool generator::emit_struct(const ast::node* source, const std::string& name,
+    const std::vector<const ast::member*>& members, std::string_view owner, namespace_output& ns)
+{
+    reflected_type info;
+    info.source = source;
+    info.qualified_name = ns.qualifier + name;
+
+    // NOTE: Resolving member types may emit other declarations, so build the struct up separately
+    std::vector<type_info> types;
+    for (auto member : members)
+    {
+        // NOTE: Types declared inline by inherited members have already been named in the context of the base
+        naming_context context{ &ns, owner, name, member->is_integer };
+        type_info type;
+        if (!resolve_type(member->type, context, str(member->name), type))
+        {
+            diag.print("NOTE: While generating member '%s'\n", str(member->name));
+            return false;
+        }
+
+        info.members.push_back({ str(member->name), make_identifier(str(member->name)), type.tag,
+            member->is_optional, type.is_optional });
+        types.push_back(std::move(type));
+    }
+
+    std::string text = "    struct " + name + "\n    {\n";
+    std::string sizeCheck;
+    type_info self{ name, "object" };
+    if (!options.compact)
+    {
+        for (std::size_t i = 0; i < members.size(); ++i)
+        {
+            bool wrap = members[i]->is_optional && !types[i].is_optional; // 'foo?: T | null' is only optional once
+            text += "        ";
+            text += wrap ? "json::optional_t<" + types[i].name + ">" : types[i].name;
+            text += " " + info.members[i].cpp_name + ";\n";
+        }
+    }
+    else
+    {
+        // Optional members keep their value in '<name>_value', and whether it's present in a bit of a 'json::presence'
+        // member. Accessors named after the member hand out an optional-like 'json::optional_ref'. Members that are
+        // required but nullable stay 'json::optional_t<>', since they have to be written out as null when empty
+        self.align = field_alignment::one;
+        std::unordered_set<std::string> used;
+        for (auto& member : info.members) used.insert(member.cpp_name);
+        auto reserve = [&](std::string candidate)
+        {
+            while (!used.insert(candidate).second) candidate.push_back('_');
+            return candidate;
+        };
+
+        std::vector<std::size_t> optionalMembers;
+        for (std::size_t i = 0; i < members.size(); ++i)
+        {
+            if (!info.members[i].is_optional)
+            {
+                if (types[i].is_optional) types[i].size = 0; // Includes the 'std::optional' flag
+                continue;
+            }
+
+            optionalMembers.push_back(i);
+            if (types[i].is_optional)
+            {
+                // Strip the 'json::optional_t<>'; the presence bit takes its place
+                constexpr auto prefix = "json::optional_t<"sv;
+                types[i].name = types[i].name.substr(prefix.size(), types[i].name.size() - prefix.size() - 1);
+            }
+        }
+
+        std::vector<std::string> storageNames;
+        for (std::size_t i = 0; i < members.size(); ++i)
+        {
+            bool isOptional = info.members[i].is_optional;
+            storageNames.push_back(isOptional ? reserve(info.members[i].cpp_name + "_value") : info.members[i].cpp_name);
+        }
+        if (!optionalMembers.empty()) info.presence = reserve("present");
+
+        // Most strictly aligned first, which leaves no padding between members
+        std::vector<std::size_t> order(members.size());
+        for (std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&](auto lhs, auto rhs) { return types[lhs].align > types[rhs].align; });
+
+        std::size_t knownSize = 0;
+        std::vector<std::pair<std::string, std::size_t>> otherSizes; // Type name and count
+        for (auto i : order)
+        {
+            text += "        " + types[i].name + " " + storageNames[i] + ";\n";
+            self.align = std::max(self.align, types[i].align);
+            if (types[i].size)
+            {
+                knownSize += types[i].size;
+                continue;
+            }
+
+            auto itr = std::find_if(otherSizes.begin(), otherSizes.end(), [&](auto& p) { return p.first == types[i].name; });
+            if (itr == otherSizes.end()) otherSizes.emplace_back(types[i].name, 1);
+            else ++itr->second;
+        }
+
+        if (!optionalMembers.empty())
+        {
+            text += "        json::presence<" + std::to_string(optionalMembers.size()) + "> " + info.presence + ";\n";
+            knownSize += (optionalMembers.size() + 7) / 8;
+        }
+
+        // Each optional member's bit is its position among the optional members (see 'json::details::presence_bit')
+        if (!optionalMembers.empty()) text += '\n';
+        for (std::size_t bit = 0; bit < optionalMembers.size(); ++bit)
+        {
+            auto i = optionalMembers[bit];
+            auto call = "return " + info.presence + ".ref(" + storageNames[i] + ", " + std::to_string(bit) + "); }\n";
+            text += "        auto " + info.members[i].cpp_name + "() noexcept { " + call;
+            text += "        auto " + info.members[i].cpp_name + "() const noexcept { " + call;
+        }
+
+        for (std::size_t i = 0; i < members.size(); ++i)
+        {
+            info.members[i].cpp_name = std::move(storageNames[i]);
+        }
+
+        if (otherSizes.empty())
+        {
+            // Only scalars, so the size is the same everywhere
+            std::size_t alignment = (self.align == field_alignment::eight) ? 8 : (self.align == field_alignment::two) ? 2 : 1;
+            self.size = std::max<std::size_t>((knownSize + alignment - 1) / alignment * alignment, 1);
+        }
+
+        if (!members.empty())
+        {
+            sizeCheck = "    // Members are ordered by alignment, so there should be no padding between them\n";
+            sizeCheck += "    static_assert(sizeof(" + name + ") == json::details::round_up(";
+            for (auto& [typeName, count] : otherSizes)
+            {
+                sizeCheck += "\n        ";
+                if (count > 1) sizeCheck += std::to_string(count) + " * ";
+                sizeCheck += "sizeof(" + typeName + ") +";
+            }
+            if (knownSize || otherSizes.empty()) sizeCheck += (otherSizes.empty() ? "" : "\n        ") + std::to_string(knownSize);
+            else sizeCheck.resize(sizeCheck.size() - 2); // Trailing " +"
+            sizeCheck += ", alignof(" + name + ")));\n\n";
+        }
+    }
+    text += "    };\n\n" + sizeCheck;
+
+    ns.body += text;
+    struct_types[info.qualified_name] = self;
+    reflected.push_back(std::move(info));
+    return true;
+}
+
+void generator::emit_enum(const ast::enumeration* defn, const std::string& name, namespace_output& ns)
+{
+    reflected_type info;
+    info.source = defn;
+    info.qualified_name = ns.qualifier + name;
+    info.is_enum = true;
+
+    std::unordered_set<std::string> used;
+    ns.body += "    enum class " + name;
+    if (options.compact) ns.body += (defn->values.size() <= 0x100) ? " : std::uint8_t" : " : std::uint16_t";
+    ns.body += "\n    {\n";
+    for (auto value : defn->values)
+    {
+        // Distinct strings may map to the same identifier (e.g. 'a-b' and 'a_b')
+        auto id = make_identifier(str(value));
+        for (int i = 2; !used.insert(id).second; ++i)
+        {
+            id = make_identifier(str(value)) + std::to_string(i);
+        }
+
+        ns.body += "        " + id + ",\n";
+        info.values.push_back(file.symbols[value]);
+    }
+    ns.body += "    };\n\n";
+
+    reflected.push_back(std::move(info));
+}
+
+type_info generator::enum_type(const ast::enumeration* defn, std::string name) const
+{
+    type_info result{ std::move(name), "enumeration" };
+    if (options.compact)
+    {
+        bool narrow = defn->values.size() <= 0x100;
+        result.align = narrow ? field_alignment::one : field_alignment::two;
+        result.size = narrow ? 1 : 2;
+    }
+
+    return result;
+}
+
+bool generator::resolve_type(const ast::node* type, const naming_context& context, std::string_view memberName,
+    type_info& result)
+{
+    switch (type->kind)
+    {
+    case ast::node_kind::fundamental_type_reference:
+        switch (static_cast<const ast::fundamental_type_reference*>(type)->type)
+        {
+        case ast::fundamental_type::any: result = { "json::raw_value", "any" }; break;
+        case ast::fundamental_type::boolean: result = { "json::boolean_t", "boolean", false, field_alignment::one, 1 }; break;
+        case ast::fundamental_type::number:
+            if (context.integer) result = { "json::integer_t", "integer", false, field_alignment::eight, 8 };
+            else result = { "json::number_t", "number", false, field_alignment::eight, 8 };
+            break;
+        case ast::fundamental_type::string: result = { "json::string_t", "string" }; break;
+        case ast::fundamental_type::null: result = { "json::null_t", "any" }; break;
+        }
+        return true;
+
+    case ast::node_kind::interface_reference:
+    {
+        auto decl = static_cast<const ast::interface_reference*>(type)->declaration;
+        if (!emit_declaration(decl)) return false;
+
+        if (decl->kind == ast::node_kind::interface)
+        {
+            // NOTE: Only a struct that's still being emitted can be missing, and then only when it's reached through an
+            // array or map, whose alignment doesn't depend on it
+            auto name = str(static_cast<const ast::interface*>(decl)->name);
+            auto itr = struct_types.find(owners[decl]->qualifier + name);
+            result = (itr != struct_types.end()) ? itr->second : type_info{ name, "object" };
+            return true;
+        }
+
+        // Aliases have the same shape as the aliased type
+        auto alias = static_cast<const ast::type_alias*>(decl);
+        naming_context aliasContext{ owners[decl], str(alias->name), str(alias->name) };
+        if (!resolve_type(alias->type, aliasContext, {}, result)) return false;
+        result.name = str(alias->name);
+        if (result.is_optional) result.size = 0; // Includes the 'std::optional' flag
+        result.is_optional = false;
+        return true;
+    }
+
+    case ast::node_kind::array:
+    {
+        type_info element;
+        ++indirection;
+        bool resolved = resolve_type(static_cast<const ast::array*>(type)->type, context, memberName, element);
+        --indirection;
+        if (!resolved) return false;
+        result = { "json::array_t<" + element.name + ">", "array" };
+        return true;
+    }
+
+    case ast::node_kind::union_type:
+        if (auto nullable = nullable_type(static_cast<const ast::union_type*>(type)))
+        {
+            if (!resolve_type(nullable, context, memberName, result)) return false;
+            if (!result.is_optional)
+            {
+                result.name = "json::optional_t<" + result.name + ">";
+                result.is_optional = true;
+            }
+        }
+        else
+        {
+            // There's no good C++ equivalent for an arbitrary union, so leave it up to the user to sort out at runtime
+            result = { "json::raw_value", "any" };
+        }
+        return true;
+
+    case ast::node_kind::object:
+    {
+        auto obj = static_cast<const ast::object*>(type);
+        if (obj->named_members.empty() && obj->index_type)
+        {
+            type_info valueType;
+            ++indirection;
+            bool resolved = resolve_type(obj->index_type, context, memberName, valueType);
+            --indirection;
+            if (!resolved) return false;
+            result = { "json::map_t<" + valueType.name + ">", "map" };
+            return true;
+        }
+        else if (auto itr = inline_types.find(type); itr != inline_types.end())
+        {
+            result = itr->second;
+            return true;
+        }
+
+        auto name = unique_name(*context.ns, std::string(context.parent) + pascal_case(memberName),
+            std::string(context.owner) + pascal_case(memberName));
+        result = { name, "object" };
+        inline_types.emplace(type, result);
+
+        std::vector<const ast::member*> members(obj->named_members.begin(), obj->named_members.end());
+        auto outerIndirection = std::exchange(indirection, 0);
+        bool emitted = emit_struct(type, name, members, context.owner, *context.ns);
+        indirection = outerIndirection;
+        if (!emitted) return false;
+
+        result = struct_types[context.ns->qualifier + name];
+        inline_types[type] = result;
+        return true;
+    }
+
+    case ast::node_kind::enumeration:
+    {
+        if (auto itr = inline_types.find(type); itr != inline_types.end())
+        {
+            result = itr->second;
+            return true;
+        }
+
+        // NOTE: Enums are named after the interface, even when declared within an unnamed structure
+        auto name = unique_name(*context.ns, std::string(context.owner) + pascal_case(memberName),
+            std::string(context.parent) + pascal_case(memberName));
+        result = enum_type(static_cast<const ast::enumeration*>(type), name);
+        inline_types.emplace(type, result);
+        emit_enum(static_cast<const ast::enumeration*>(type), name, *context.ns);
+        return true;
+    }
+
+    default:
+        assert(false);
+        return false;
+    }
+}
+
+const ast::interface* generator::find_base(const ast::interface* iface) const
+{
+    if (!iface->base) return nullptr;
+
+    // NOTE: Resolution already checked that this is an interface
+    return static_cast<const ast::interface*>(static_cast<const ast::interface_reference*>(iface->base)->declaration);
+}
+
+bool generator::has_member(const ast::interface* iface, ast::symbol name) const
+{
+    for (auto member : iface->all_members)
+    {
+        if (member->name == name) return true;
+    }
+
+    return false;
+}
+
+// The interface's own discriminator for 'key', or its first one if 'key' is null
+const ast::discriminator* generator::find_discriminator(const ast::interface* iface, const ast::symbol* key) const
+{
+    for (auto& disc : iface->definition->discriminators)
+    {
+        if (!key || (disc.name == *key)) return &disc;
+    }
+
+    return nullptr;
+}
+
+bool generator::add_families()
+{
+    std::vector<const ast::interface*> interfaces;
+    auto add_interfaces = [&](const ast::list<ast::node*>& children)
+    {
+        for (auto child : children)
+        {
+            if (child->kind == ast::node_kind::interface) interfaces.push_back(static_cast<const ast::interface*>(child));
+        }
+    };
+
+    add_interfaces(file.children);
+    for (auto child : file.children)
+    {
+        if (child->kind == ast::node_kind::module) add_interfaces(static_cast<const ast::module*>(child)->children);
+    }
+
+    for (auto iface : interfaces)
+    {
+        auto base = find_base(iface);
+        if (!base) continue;
+
+        auto itr = std::find_if(families.begin(), families.end(), [&](auto& f) { return f.base == base; });
+        auto key = (itr != families.end()) ? &itr->key : nullptr;
+        auto disc = find_discriminator(iface, key);
+        if (!disc && !iface->definition->discriminators.empty())
+        {
+            diag.print("ERROR: Interface '%s' is told apart from the other interfaces that extend '%s' by '%s' rather "
+                "than '%s'\n", str(iface->name), str(base->name), str(iface->definition->discriminators[0].name),
+                str(*key));
+            return false;
+        }
+        else if (!disc)
+        {
+            // NOTE: This is specific to the Debug Adapter Protocol, whose proto.ts doesn't give responses a
+            // discriminator of their own. They carry the same 'command' as the request that they answer though, so
+            // 'FooResponse' borrows the discriminator of 'FooRequest'
+            auto name = file.symbols[iface->name];
+            constexpr auto suffix = "Response"sv;
+            if ((name.size() <= suffix.size()) || (name.substr(name.size() - suffix.size()) != suffix)) continue;
+
+            auto requestName = std::string(name.substr(0, name.size() - suffix.size())) + "Request";
+            auto requestSym = file.symbols.find(requestName);
+            auto request = requestSym ? find_declaration(file, owners.at(iface)->scope, *requestSym) : nullptr;
+            if (!request || (request->kind != ast::node_kind::interface))
+            {
+                diag.print("WARNING: Interface '%s' has no '%s' to take its discriminator from, so it's left out of "
+                    "the dispatch table for '%s'\n", str(iface->name), requestName.c_str(), str(base->name));
+                continue;
+            }
+
+            disc = find_discriminator(static_cast<const ast::interface*>(request), key);
+            if (!disc || !has_member(iface, disc->name))
+            {
+                diag.print("WARNING: Interface '%s' doesn't share a discriminator with '%s', so it's left out of the "
+                    "dispatch table for '%s'\n", str(iface->name), requestName.c_str(), str(base->name));
+                continue;
+            }
+        }
+
+        if (itr == families.end())
+        {
+            itr = families.emplace(families.end());
+            itr->base = base;
+            itr->key = disc->name;
+        }
+
+        for (auto& [other, value] : itr->alternatives)
+        {
+            if (value == disc->value)
+            {
+                diag.print("ERROR: Interfaces '%s' and '%s' both extend '%s' with '%s' set to '%s'\n", str(other->name),
+                    str(iface->name), str(base->name), str(disc->name), str(value));
+                return false;
+            }
+        }
+
+        itr->alternatives.emplace_back(iface, disc->value);
+    }
+
+    for (auto& family : families)
+    {
+        emit_family(family);
+    }
+
+    return true;
+}
+
+void generator::emit_family(message_family& family)
+{
+    if (!family.name.empty()) return;
+
+    // Alternatives that are the base of a family of their own are represented by that family's variant, so dispatch
+    // carries on down the hierarchy
+    std::vector<std::pair<std::string, namespace_output*>> types{ { str(family.base->name), owners[family.base] } };
+    for (auto& alternative : family.alternatives)
+    {
+        auto iface = alternative.first;
+        auto itr = std::find_if(families.begin(), families.end(), [&](auto& f) { return f.base == iface; });
+        if (itr != families.end())
+        {
+            emit_family(*itr);
+            types.emplace_back(itr->name, itr->ns);
+        }
+        else
+        {
+            types.emplace_back(str(iface->name), owners[iface]);
+        }
+    }
+
+    // The variant goes in whichever namespace gets written out last, so that every alternative has been declared
+    auto order = [&](const namespace_output* ns)
+    {
+        return std::find_if(namespaces.begin(), namespaces.end(), [&](auto& ptr) { return ptr.get() == ns; }) -
+            namespaces.begin();
+    };
+
+    family.ns = types[0].second;
+    for (auto& type : types)
+    {
+        if (order(type.second) > order(family.ns)) family.ns = type.second;
+    }
+
+    std::string baseName = str(family.base->name);
+    family.name = unique_name(*family.ns, "Any" + baseName, baseName + "Variant");
+
+    auto& body = family.ns->body;
+    body += "    // '" + baseName + "' or one of the interfaces that extend it, told apart by the value of '";
+    body += str(family.key);
+    body += "'\n    using " + family.name + " = std::variant<";
+    for (std::size_t i = 0; i < types.size(); ++i)
+    {
+        body += (i == 0) ? "\n        " : ",\n        ";
+        if (types[i].second != family.ns) body += types[i].second->qualifier;
+        body += types[i].first;
+    }
+    body += ">;\n\n";
+}
+
+std::uint32_t generator::add_schema_type(json::schema_op op, std::uint32_t first, std::uint32_t count)
+{
+    // Types that only differ in where they come from (e.g. every 'number[]') share an entry
+    auto [itr, inserted] = schema_shapes.emplace(std::make_tuple(op, first, count),
+        static_cast<std::uint32_t>(schema_types.size()));
+    if (inserted) schema_types.push_back({ op, first, count, 0, json::no_schema_hash });
+    return itr->second;
+}
+
+std::uint32_t generator::add_schema_string(std::string_view str)
+{
+    auto [itr, inserted] = schema_string_offsets.emplace(str, static_cast<std::uint32_t>(schema_strings.size()));
+    if (inserted) schema_strings += str;
+    return itr->second;
+}
+
+std::uint32_t generator::append_schema_fields(const std::vector<schema_field_entry>& fields)
+{
+    auto first = static_cast<std::uint32_t>(schema_fields.size());
+    for (auto& field : fields)
+    {
+        schema_fields.push_back({ add_schema_string(field.name), static_cast<std::uint32_t>(field.name.size()),
+            field.type, field.optional });
+    }
+    return first;
+}
+
+// Appends the fields sorted by name, which is what lets validation find them with a binary search when there's no
+// perfect hash of their names
+std::uint32_t generator::add_schema_fields(std::vector<schema_field_entry>& fields)
+{
+    std::stable_sort(fields.begin(), fields.end(), [](auto& lhs, auto& rhs) { return lhs.name < rhs.name; });
+    return append_schema_fields(fields);
+}
+
+std::uint32_t generator::add_schema_hash(const std::vector<schema_field_entry>& fields, std::size_t skip)
+{
+    // Slots hold a byte each
+    if (fields.size() - skip > 256) return json::no_schema_hash;
+
+    std::vector<std::string_view> names;
+    for (auto i = skip; i < fields.size(); ++i) names.push_back(fields[i].name);
+
+    perfect_hash hash;
+    if (names.empty() || !build_perfect_hash(names, hash)) return json::no_schema_hash;
+
+    json::schema_hash entry = { hash.seed, static_cast<std::uint32_t>(schema_bytes.size()),
+        static_cast<std::uint32_t>(hash.positions.size()), 0, static_cast<std::uint32_t>(hash.slots.size()) };
+    schema_bytes.insert(schema_bytes.end(), hash.positions.begin(), hash.positions.end());
+    entry.slots = static_cast<std::uint32_t>(schema_bytes.size());
+    for (auto slot : hash.slots)
+    {
+        schema_bytes.push_back((slot < names.size()) ? static_cast<std::uint8_t>(slot) : 0);
+    }
+
+    schema_hashes.push_back(entry);
+    return static_cast<std::uint32_t>(schema_hashes.size() - 1);
+}
+
+std::uint32_t generator::schema_object(const ast::node* source, const ast::list<ast::member*>& members)
+{
+    // The entry is added up front, so that types that refer back to this one find it
+    auto index = static_cast<std::uint32_t>(schema_types.size());
+    schema_types.push_back({ json::schema_op::object, 0, 0, 0, json::no_schema_hash });
+    schema_nodes.emplace(source, index);
+
+    std::vector<schema_field_entry> fields;
+    for (auto member : members)
+    {
+        // NOTE: 'foo: T | null' may be null but not left out; its type is a 'nullable' that accepts either
+        fields.push_back({ file.symbols[member->name], schema_index(member->type, member->is_integer),
+            member->is_optional });
+    }
+
+    if (fields.size() > json::max_schema_members)
+    {
+        schema_types[index].op = json::schema_op::any;
+        return index;
+    }
+
+    auto first = add_schema_fields(fields);
+    auto& entry = schema_types[index];
+    entry.first = first;
+    entry.count = static_cast<std::uint32_t>(fields.size());
+    entry.required = static_cast<std::uint32_t>(std::count_if(fields.begin(), fields.end(), [](auto& field)
+    {
+        return !field.optional;
+    }));
+    entry.hash = add_schema_hash(fields);
+    return index;
+}
+
+std::uint32_t generator::schema_index(const ast::node* type, bool integer)
+{
+    if (auto itr = schema_nodes.find(type); itr != schema_nodes.end()) return itr->second;
+
+    switch (type->kind)
+    {
+    case ast::node_kind::fundamental_type_reference:
+        switch (static_cast<const ast::fundamental_type_reference*>(type)->type)
+        {
+        case ast::fundamental_type::any: return add_schema_type(json::schema_op::any);
+        case ast::fundamental_type::boolean: return add_schema_type(json::schema_op::boolean);
+        case ast::fundamental_type::number: return add_schema_type(integer ? json::schema_op::integer : json::schema_op::number);
+        case ast::fundamental_type::string: return add_schema_type(json::schema_op::string);
+        case ast::fundamental_type::null: return add_schema_type(json::schema_op::null);
+        }
+        break;
+
+    case ast::node_kind::interface_reference:
+    {
+        // Aliases have the same shape as the aliased type
+        auto decl = static_cast<const ast::interface_reference*>(type)->declaration;
+        if (decl->kind == ast::node_kind::interface) return schema_index(decl, false);
+        return schema_index(static_cast<const ast::type_alias*>(decl)->type, false);
+    }
+
+    case ast::node_kind::interface:
+        return schema_object(type, static_cast<const ast::interface*>(type)->all_members);
+
+    case ast::node_kind::array:
+        return add_schema_type(json::schema_op::array, schema_index(static_cast<const ast::array*>(type)->type, integer));
+
+    case ast::node_kind::union_type:
+    {
+        auto unionType = static_cast<const ast::union_type*>(type);
+        if (auto nullable = nullable_type(unionType))
+        {
+            return add_schema_type(json::schema_op::nullable, schema_index(nullable, integer));
+        }
+
+        std::vector<schema_field_entry> fields;
+        for (auto option : unionType->types)
+        {
+            fields.push_back({ {}, schema_index(option, integer), false });
+        }
+
+        auto first = add_schema_fields(fields);
+        return add_schema_type(json::schema_op::one_of, first, static_cast<std::uint32_t>(fields.size()));
+    }
+
+    case ast::node_kind::object:
+    {
+        auto obj = static_cast<const ast::object*>(type);
+        if (obj->named_members.empty() && obj->index_type)
+        {
+            return add_schema_type(json::schema_op::map, schema_index(obj->index_type, integer));
+        }
+
+        return schema_object(type, obj->named_members);
+    }
+
+    case ast::node_kind::enumeration:
+    {
+        std::vector<schema_field_entry> fields;
+        for (auto value : static_cast<const ast::enumeration*>(type)->values)
+        {
+            fields.push_back({ file.symbols[value], 0, false });
+        }
+
+        auto first = add_schema_fields(fields);
+        auto index = add_schema_type(json::schema_op::enumeration, first, static_cast<std::uint32_t>(fields.size()));
+        schema_types[index].hash = add_schema_hash(fields);
+        schema_nodes.emplace(type, index);
+        return index;
+    }
+
+    default:
+        break;
+    }
+
+    assert(false);
+    return 0;
+}
+
+std::uint32_t generator::schema_family(message_family& family)
+{
+    if (family.has_schema) return family.schema_index;
+
+    family.schema_index = static_cast<std::uint32_t>(schema_types.size());
+    family.has_schema = true;
+    schema_types.push_back({ json::schema_op::dispatch, 0, 0, 0, json::no_schema_hash });
+
+    // The first field is the key and the base, which catches anything that isn't listed
+    std::vector<schema_field_entry> fields;
+    for (auto& [iface, value] : family.alternatives)
+    {
+        auto itr = std::find_if(families.begin(), families.end(), [&](auto& f) { return f.base == iface; });
+        auto type = (itr != families.end()) ? schema_family(*itr) : schema_index(iface, false);
+        fields.push_back({ file.symbols[value], type, false });
+    }
+
+    std::stable_sort(fields.begin(), fields.end(), [](auto& lhs, auto& rhs) { return lhs.name < rhs.name; });
+    fields.insert(fields.begin(), { file.symbols[family.key], schema_index(family.base, false), false });
+
+    auto& entry = schema_types[family.schema_index];
+    entry.first = append_schema_fields(fields);
+    entry.count = static_cast<std::uint32_t>(fields.size());
+    entry.hash = add_schema_hash(fields, 1);
+    return family.schema_index;
+}
+
+void generator::build_schema()
+{
+    for (auto& info : reflected)
+    {
+        info.schema_index = schema_index(info.source, false);
+    }
+
+    for (auto& family : families)
+    {
+        schema_family(family);
+    }
+}
+
+static const char* schema_op_name(json::schema_op op)
+{
+    switch (op)
+    {
+    case json::schema_op::any: return "any";
+    case json::schema_op::null: return "null";
+    case json::schema_op::boolean: return "boolean";
+    case json::schema_op::number: return "number";
+    case json::schema_op::integer: return "integer";
+    case json::schema_op::string: return "string";
+    case json::schema_op::enumeration: return "enumeration";
+    case json::schema_op::object: return "object";
+    case json::schema_op::array: return "array";
+    case json::schema_op::map: return "map";
+    case json::schema_op::nullable: return "nullable";
+    case json::schema_op::one_of: return "one_of";
+    case json::schema_op::dispatch: return "dispatch";
+    }
+
+    assert(false);
+    return "any";
+}
+
+void generator::write_schema(std::string& output) const
+{
+    output += "    namespace schemas\n    {\n";
+    output += "        inline constexpr schema_type " + schema_name + "_types[] = {";
+    for (auto& type : schema_types)
+    {
+        output += "\n            { schema_op::";
+        output += schema_op_name(type.op);
+        output += ", " + std::to_string(type.first) + ", " + std::to_string(type.count) + ", " +
+            std::to_string(type.required) + ", ";
+        output += (type.hash == json::no_schema_hash) ? "no_schema_hash }," : std::to_string(type.hash) + " },";
+    }
+    output += "\n        };\n";
+
+    if (!schema_fields.empty())
+    {
+        output += "\n        inline constexpr schema_field " + schema_name + "_fields[] = {";
+        for (auto& field : schema_fields)
+        {
+            output += "\n            { " + std::to_string(field.name) + ", " + std::to_string(field.name_size) + ", " +
+                std::to_string(field.type) + (field.optional ? ", true }," : ", false },");
+        }
+        output += "\n        };\n";
+    }
+
+    // One literal per name, since a name's offset is wherever it was first added
+    output += "\n        inline constexpr char " + schema_name + "_strings[] =";
+    std::vector<std::pair<std::uint32_t, std::string_view>> strings;
+    for (auto& [str, offset] : schema_string_offsets) strings.emplace_back(offset, str);
+    std::sort(strings.begin(), strings.end());
+
+    std::size_t lineLength = 0;
+    for (auto& [offset, str] : strings)
+    {
+        if ((lineLength == 0) || (lineLength + str.size() > 100))
+        {
+            output += "\n           ";
+            lineLength = 0;
+        }
+
+        output += ' ';
+        append_string_literal(output, str);
+        lineLength += str.size() + 3;
+    }
+    output += strings.empty() ? " \"\";\n" : ";\n";
+
+    if (!schema_hashes.empty())
+    {
+        output += "\n        inline constexpr schema_hash " + schema_name + "_hashes[] = {";
+        for (auto& hash : schema_hashes)
+        {
+            output += "\n            { " + std::to_string(hash.seed) + ", " + std::to_string(hash.positions) + ", " +
+                std::to_string(hash.position_count) + ", " + std::to_string(hash.slots) + ", " +
+                std::to_string(hash.slot_count) + " },";
+        }
+        output += "\n        };\n";
+
+        output += "\n        inline constexpr std::uint8_t " + schema_name + "_bytes[] = {";
+        for (std::size_t i = 0; i < schema_bytes.size(); ++i)
+        {
+            output += (i % 16 == 0) ? "\n            " : " ";
+            output += std::to_string(schema_bytes[i]) + ",";
+        }
+        output += "\n        };\n";
+    }
+
+    auto table = [&](bool empty, const char* suffix) { return empty ? std::string("nullptr") : schema_name + suffix; };
+    output += "\n        inline constexpr schema " + schema_name + " = { " + schema_name + "_types, " +
+        table(schema_fields.empty(), "_fields") + ", " + table(schema_hashes.empty(), "_hashes") + ", " +
+        table(schema_hashes.empty(), "_bytes") + ", " + schema_name + "_strings };\n";
+    output += "    }\n";
+}
+
+void generator::write_image(std::string& image) const
+{
+    // Generated types are found by their qualified C++ name, which gets added to the end of the string table
+    auto strings = schema_strings;
+    std::vector<std::pair<std::string, std::uint32_t>> typeNames;
+    for (auto& info : reflected) typeNames.emplace_back(info.qualified_name, info.schema_index);
+    for (auto& family : families) typeNames.emplace_back(family.ns->qualifier + family.name, family.schema_index);
+    std::sort(typeNames.begin(), typeNames.end());
+
+    std::vector<json::schema_image_name> names;
+    for (auto& [name, type] : typeNames)
+    {
+        names.push_back({ static_cast<std::uint32_t>(strings.size()), static_cast<std::uint32_t>(name.size()), type });
+        strings += name;
+    }
+
+    json::schema_image_header header = {};
+    std::memcpy(header.magic, json::schema_image_magic, sizeof(header.magic));
+    header.version = json::schema_image_version;
+
+    image.assign(sizeof(header), '\0');
+    auto append = [&](json::schema_image_section& section, const void* data, std::size_t count, std::size_t size)
+    {
+        image.resize((image.size() + 3) & ~std::size_t(3)); // Every table is 4 byte aligned
+        section = { static_cast<std::uint32_t>(image.size()), static_cast<std::uint32_t>(count) };
+        image.append(static_cast<const char*>(data), count * size);
+    };
+
+    // The padding after 'op' and 'optional' would otherwise be whatever was there, and the output has to be the same
+    // from run to run
+    std::vector<json::schema_type> types(schema_types.size());
+    std::memset(types.data(), 0, types.size() * sizeof(json::schema_type));
+    for (std::size_t i = 0; i < types.size(); ++i)
+    {
+        auto& type = schema_types[i];
+        types[i].op = type.op;
+        types[i].first = type.first;
+        types[i].count = type.count;
+        types[i].required = type.required;
+        types[i].hash = type.hash;
+    }
+
+    std::vector<json::schema_field> fields(schema_fields.size());
+    std::memset(fields.data(), 0, fields.size() * sizeof(json::schema_field));
+    for (std::size_t i = 0; i < fields.size(); ++i)
+    {
+        auto& field = schema_fields[i];
+        fields[i].name = field.name;
+        fields[i].name_size = field.name_size;
+        fields[i].type = field.type;
+        fields[i].optional = field.optional;
+    }
+
+    append(header.types, types.data(), types.size(), sizeof(json::schema_type));
+    append(header.fields, fields.data(), fields.size(), sizeof(json::schema_field));
+    append(header.hashes, schema_hashes.data(), schema_hashes.size(), sizeof(json::schema_hash));
+    append(header.names, names.data(), names.size(), sizeof(json::schema_image_name));
+    append(header.bytes, schema_bytes.data(), schema_bytes.size(), 1);
+    append(header.strings, strings.data(), strings.size(), 1);
+
+    header.size = static_cast<std::uint32_t>(image.size());
+    std::memcpy(image.data(), &header, sizeof(header));
+}
+
+void generator::write_reflection(const reflected_type& info, std::string& output) const
+{
+    output += "    template <>\n    struct reflection<" + info.qualified_name + ">\n    {\n";
+
+    auto count = std::to_string(info.is_enum ? info.values.size() : info.members.size());
+    output += "        static constexpr std::array<std::string_view, " + count + "> names = {";
+    if (info.is_enum)
+    {
+        for (auto value : info.values)
+        {
+            output += "\n            ";
+            append_string_literal(output, value);
+            output += ',';
+        }
+    }
+    else
+    {
+        for (auto& member : info.members)
+        {
+            output += "\n            ";
+            append_string_literal(output, member.json_name);
+            output += ',';
+        }
+    }
+    output += (count == "0") ? "};\n" : "\n        };\n";
+
+    std::vector<std::string_view> names;
+    if (info.is_enum) names = info.values;
+    else for (auto& member : info.members) names.push_back(member.json_name);
+
+    write_name_hash(names, output);
+
+    if (!info.is_enum)
+    {
+        // What encoders write ahead of each member's value, i.e. the name already quoted and escaped
+        output += "        static constexpr std::array<std::string_view, " + count + "> keys = {";
+        for (auto& member : info.members)
+        {
+            std::string key = "\"";
+            append_json_escaped(key, member.json_name);
+            key += "\":";
+
+            output += "\n            ";
+            append_string_literal(output, key);
+            output += ',';
+        }
+        output += (count == "0") ? "};\n" : "\n        };\n";
+
+        output += "        static constexpr std::array<type_tag, " + count + "> types = {";
+        for (auto& member : info.members)
+        {
+            output += "\n            type_tag::";
+            output += member.tag;
+            output += ',';
+        }
+        output += (count == "0") ? "};\n" : "\n        };\n";
+
+        output += "        static constexpr std::array<bool, " + count + "> optional = {";
+        for (auto& member : info.members)
+        {
+            output += member.is_optional ? "\n            true," : "\n            false,";
+        }
+        output += (count == "0") ? "};\n" : "\n        };\n";
+
+        output += "        static constexpr std::array<bool, " + count + "> nullable = {";
+        for (auto& member : info.members)
+        {
+            output += member.is_nullable ? "\n            true," : "\n            false,";
+        }
+        output += (count == "0") ? "};\n" : "\n        };\n";
+
+        output += "        static constexpr auto members = std::make_tuple(";
+        bool first = true;
+        for (auto& member : info.members)
+        {
+            output += first ? "\n            &" : ",\n            &";
+            output += info.qualified_name + "::" + member.cpp_name;
+            first = false;
+        }
+        output += ");\n";
+
+        if (!info.presence.empty())
+        {
+            output += "        static constexpr auto presence = &" + info.qualified_name + "::" + info.presence + ";\n";
+        }
+    }
+
+    output += "        static constexpr const schema* schema_table = &schemas::" + schema_name + ";\n";
+    output += "        static constexpr std::uint32_t schema_index = " + std::to_string(info.schema_index) + ";\n";
+    output += "    };\n";
+}
+
+void generator::write_dispatch(const message_family& family, std::string& output) const
+{
+    output += "    template <>\n    struct dispatch<" + family.ns->qualifier + family.name + ">\n    {\n";
+    output += "        static constexpr std::string_view key = ";
+    append_string_literal(output, str(family.key));
+    output += ";\n";
+
+    std::vector<std::string_view> names;
+    output += "        static constexpr std::array<std::string_view, " + std::to_string(family.alternatives.size()) +
+        "> names = {";
+    for (auto& alternative : family.alternatives)
+    {
+        names.push_back(file.symbols[alternative.second]);
+        output += "\n            ";
+        append_string_literal(output, names.back());
+        output += ',';
+    }
+    output += "\n        };\n";
+
+    write_name_hash(names, output);
+    output += "        static constexpr const schema* schema_table = &schemas::" + schema_name + ";\n";
+    output += "        static constexpr std::uint32_t schema_index = " + std::to_string(family.schema_index) + ";\n";
+    output += "    };\n";
+}
+
+bool generator::run(std::string_view sourceName, std::string& output, std::string* image)
+{
+    // The file scope first, followed by each module in declaration order
+    add_namespace(nullptr, file.children);
+    for (auto child : file.children)
+    {
+        if (child->kind == ast::node_kind::module)
+        {
+            auto mod = static_cast<const ast::module*>(child);
+            add_namespace(mod, mod->children);
+        }
+    }
+
+    // Declarations get emitted in order, except that anything a type depends on gets emitted before it
+    auto emit_children = [&](const ast::list<ast::node*>& children)
+    {
+        for (auto child : children)
+        {
+            if (((child->kind == ast::node_kind::interface) || (child->kind == ast::node_kind::type_alias)) &&
+                !emit_declaration(child))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    if (!emit_children(file.children)) return false;
+    for (auto child : file.children)
+    {
+        if ((child->kind == ast::node_kind::module) && !emit_children(static_cast<const ast::module*>(child)->children))
+        {
+            return false;
+        }
+    }
+
+    if (!add_families()) return false;
+
+    schema_name = make_identifier(sourceName.substr(0, sourceName.find('.')));
+    build_schema();
+
+    output = "// Generated by ts2cpp from '";
+    output += sourceName;
+    output += "'; do not edit\n#pragma once\n\n#include <json.h>\n";
+
+    for (auto& ns : namespaces)
+    {
+        if (ns->body.empty()) continue;
+        ns->body.pop_back(); // Trailing blank line
+
+        output += '\n';
+        if (ns->scope)
+        {
+            output += "namespace ";
+            output += str(ns->scope->name);
+            output += "\n{\n" + ns->body + "}\n";
+        }
+        else
+        {
+            // NOTE: Declarations are indented assuming that they're in a namespace; keep it consistent at file scope
+            output += ns->body;
+        }
+    }
+
+    if (!reflected.empty())
+    {
+        output += "\nnamespace json\n{\n";
+        write_schema(output);
+        for (auto& info : reflected)
+        {
+            output += '\n';
+            write_reflection(info, output);
+        }
+
+        for (auto& family : families)
+        {
+            output += '\n';
+            write_dispatch(family, output);
+        }
+        output += "}\n";
+    }
+
+    if (image) write_image(*image);
+    return true;
+}
+
+bool generate_header(const ast::file& file, std::string_view sourceName, const generator_options& options,
+    std::string& output, diagnostics& diag, std::string* image)
+{
+    generator gen(file, options, diag);
+    return gen.run(sourceName, output, image);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "ast.h"
+#include "diagnostics.h"
+
+struct generator_options
+{
+    // Track which optional members have a value with a bitset instead of 'std::optional', give enums the smallest
+    // underlying type that fits, and order members by alignment so that structs have no padding between members
+    bool compact = false;
+};
+
+// Generates a C++ header declaring a type for every interface, inline object and enumeration in 'file', along with the
+// 'json::reflection' specializations that describe them. 'sourceName' is only used for the header comment. If 'image'
+// is given, it also gets the schema image for the file (see json_schema_image.h)
+bool generate_header(const ast::file& file, std::string_view sourceName, const generator_options& options,
+    std::string& output, diagnostics& diag, std::string* image = nullptr);
@@ -1,14 +1,9 @@
 
 #include "lexer.h"
+#include "scan.h"
 
 using namespace std::literals;
 
-static constexpr bool is_whitespace(char ch) noexcept
-{
-    return (ch == ' ') || (ch == '\f') || (ch == '\n') || (ch == '\r') ||
-        (ch == '\t') || (ch == '\v');
-}
-
 static constexpr bool in_range(char ch, char begin, char end) noexcept
 {
     return (ch >= begin) && (ch <= end);
@@ -16,23 +11,49 @@ static constexpr bool in_range(char ch, char begin, char end) noexcept
 
 static constexpr bool is_valid_identifier_start(char ch) noexcept
 {
-    return in_range(ch, 'A', 'Z') || in_range(ch, 'a', 'z');
+    return in_range(ch, 'A', 'Z') || in_range(ch, 'a', 'z') || (ch == '_');
 }
 
 static constexpr bool is_valid_identifier_character(char ch) noexcept
 {
-    return is_valid_identifier_start(ch) || in_range(ch, '0', '9') || (ch == '_');
+    return is_valid_identifier_start(ch) || in_range(ch, '0', '9');
 }
 
 template <typename Func>
-static void skip_while(std::ifstream& input, Func&& func)
+static const char* skip_while(const char* pos, const char* end, Func&& func)
 {
-    while (!input.fail() && func(static_cast<char>(input.peek()))) { input.get(); }
+    while ((pos != end) && func(*pos)) { ++pos; }
+    return pos;
 }
 
-static void skip_whitespace(std::ifstream& input)
+// Matches a line comment of the form "name: 'value';", where the ';' is optional
+static bool parse_discriminator(std::string_view text, std::string_view& name, std::string_view& value)
 {
-    skip_while(input, is_whitespace);
+    auto pos = text.data();
+    auto end = pos + text.size();
+    auto is_space = [](char ch) { return (ch == ' ') || (ch == '\t') || (ch == '\r'); };
+
+    pos = skip_while(pos, end, is_space);
+    if ((pos == end) || !is_valid_identifier_start(*pos)) return false;
+    auto nameBegin = pos;
+    pos = skip_while(pos, end, is_valid_identifier_character);
+    name = std::string_view(nameBegin, static_cast<std::size_t>(pos - nameBegin));
+
+    pos = skip_while(pos, end, is_space);
+    if ((pos == end) || (*pos++ != ':')) return false;
+    pos = skip_while(pos, end, is_space);
+    if ((pos == end) || ((*pos != '\'') && (*pos != '"'))) return false;
+
+    auto quote = *pos++;
+    auto valueBegin = pos;
+    pos = skip_while(pos, end, [&](char ch) { return ch != quote; });
+    if (pos == end) return false;
+    value = std::string_view(valueBegin, static_cast<std::size_t>(pos - valueBegin));
+
+    ++pos; // Consume the closing quote
+    pos = skip_while(pos, end, is_space);
+    if ((pos != end) && (*pos == ';')) ++pos;
+    return skip_while(pos, end, is_space) == end;
 }
 
 void lexer::advance()
@@ -40,153 +61,122 @@ void lexer::advance()
     current_token = token::invalid;
     do
     {
-        skip_whitespace(input);
-        if (input.eof())
+        current = scan::skip_whitespace(current, end);
+        if (current == end)
         {
             current_token = token::eof;
             return;
         }
-        else if (input.fail())
-        {
-            std::printf("ERROR: Failed to read data from file\n");
-            return;
-        }
 
-        auto ch = input.get();
+        auto ch = *current++;
+        string_value = std::string_view(current - 1, 1);
         switch (ch)
         {
         case ';':
-            string_value = ";";
             current_token = token::semicolon;
             break;
 
         case ':':
-            string_value = ":";
             current_token = token::colon;
             break;
 
         case '{':
-            string_value = "{";
             current_token = token::open_curly;
             break;
 
         case '}':
-            string_value = "}";
             current_token = token::close_curly;
             break;
 
         case '?':
-            string_value = "?";
             current_token = token::question;
             break;
 
         case '|':
-            string_value = "|";
             current_token = token::pipe;
             break;
 
+        case '=':
+            current_token = token::equals;
+            break;
+
         case '[':
-            string_value = "[";
             current_token = token::open_bracket;
             break;
 
         case ']':
-            string_value = "]";
             current_token = token::close_bracket;
             break;
 
         case '/':
-            if (input.peek() == '/')
+            if ((current != end) && (*current == '/'))
             {
                 // Read until the end of the line
-                skip_while(input, [](char ch) { return ch != '\n'; });
-                input.get(); // Consume the '\n'
+                auto begin = current + 1;
+                current = scan::find_char(current, end, '\n');
+
+                std::string_view text(begin, static_cast<std::size_t>(current - begin));
+                if (text.find("@integer") != std::string_view::npos) integer_annotation = true;
+
+                std::string_view name, value;
+                if (parse_discriminator(text, name, value))
+                {
+                    discriminators.push_back({ file->symbols.intern(name), file->symbols.intern(value) });
+                }
+
+                if (current != end) ++current; // Consume the '\n'
             }
-            else if (input.peek() == '*')
+            else if ((current != end) && (*current == '*'))
             {
                 // Read until we get an ending '*/'
-                input.get(); // Consume the initial '*'
-                while (true)
+                auto begin = ++current; // Consume the initial '*'
+                current = scan::find_comment_end(current, end);
+                if (current == end)
                 {
-                    skip_while(input, [](char ch) { return ch != '*'; });
-                    input.get(); // Consume the '*'
-                    if (input.peek() == '/')
-                    {
-                        input.get(); // Consume the '/'
-                        break;
-                    }
-
-                    if (input.eof())
-                    {
-                        std::printf("ERROR: End of file reached while parsing comment\n");
-                        return;
-                    }
-                    else if (input.fail())
-                    {
-                        std::printf("ERROR: Failed to read data from file\n");
-                        return;
-                    }
+                    diag.print("ERROR: End of file reached while parsing comment\n");
+                    return;
                 }
+
+                std::string_view text(begin, static_cast<std::size_t>(current - begin));
+                if (text.find("@integer") != std::string_view::npos) integer_annotation = true;
+                current += 2; // Consume the '*/'
+            }
+            else if (current == end)
+            {
+                diag.print("ERROR: End of file reached after '/'\n");
+                return;
             }
             else
             {
-                std::printf("ERROR: Unexpected character '%c' after '/'\n", input.peek());
+                diag.print("ERROR: Unexpected character '%c' after '/'\n", *current);
                 return;
             }
             break;
 
         case '\'':
         case '\"':
+        {
             // NOTE: All strings we will be processing will be quite simple as they are almost exclusively used as
             // identifiers, so keep it simple for now
-            string_value.clear();
-            while (true)
+            auto begin = current;
+            current = scan::find_char(current, end, ch);
+            if (current == end)
             {
-                auto next = input.get();
-                if (next == ch)
-                {
-                    current_token = token::string;
-                    break;
-                }
-                else if (input.eof())
-                {
-                    std::printf("ERROR: End of file encountered while parsing string\n");
-                    return;
-                }
-                else if (input.fail())
-                {
-                    std::printf("ERROR: Failed to read data from file\n");
-                    return;
-                }
-                else
-                {
-                    string_value.push_back(static_cast<char>(next));
-                }
+                diag.print("ERROR: End of file encountered while parsing string\n");
+                return;
             }
-            break;
+
+            string_value = std::string_view(begin, static_cast<std::size_t>(current - begin));
+            ++current; // Consume the closing quote
+            current_token = token::string;
+        }   break;
 
         default:
-            if (is_valid_identifier_start(static_cast<char>(ch)))
+            if (is_valid_identifier_start(ch))
             {
-                string_value.clear();
-                while (true)
-                {
-                    string_value.push_back(static_cast<char>(ch));
-                    auto next = input.peek();
-                    if (is_valid_identifier_character(static_cast<char>(next)))
-                    {
-                        ch = input.get(); // Consume and keep going
-                    }
-                    else if (!input.fail() || input.eof())
-                    {
-                        break;
-                    }
-                    else
-                    {
-                        std::printf("ERROR: Failed to read data from file\n");
-                        return;
-                    }
-                }
+                auto begin = current - 1;
+                current = skip_while(current, end, is_valid_identifier_character);
+                string_value = std::string_view(begin, static_cast<std::size_t>(current - begin));
 
                 if (string_value == "string"sv)
                 {
@@ -204,6 +194,10 @@ void lexer::advance()
                 {
                     current_token = token::type_any;
                 }
+                else if (string_value == "null"sv)
+                {
+                    current_token = token::type_null;
+                }
                 else if (string_value == "export"sv)
                 {
                     current_token = token::keyword_export;
@@ -220,6 +214,10 @@ void lexer::advance()
                 {
                     current_token = token::keyword_module;
                 }
+                else if (string_value == "type"sv)
+                {
+                    current_token = token::keyword_type;
+                }
                 else
                 {
                     current_token = token::identifier;
@@ -227,7 +225,7 @@ void lexer::advance()
             }
             else
             {
-                std::printf("ERROR: Invalid character '%c'\n", ch);
+                diag.print("ERROR: Invalid character '%c'\n", ch);
                 return;
             }
         }
@@ -1,8 +1,10 @@
 #pragma once
 
-#include <fstream>
+#include <string_view>
+#include <vector>
 
 #include "ast.h"
+#include "diagnostics.h"
 
 enum class token
 {
@@ -19,18 +21,21 @@ enum class token
     colon, // :
     question, // ?
     pipe, // |
+    equals, // =
 
     // Keywords
     keyword_export,
     keyword_module,
     keyword_interface,
     keyword_extends,
+    keyword_type,
 
     // Types
     type_any,
     type_boolean,
     type_string,
     type_number,
+    type_null,
 
     // Arbitrary string values
     string,
@@ -39,7 +44,14 @@ enum class token
 
 struct lexer
 {
-    lexer(std::ifstream& input, ast::file* file) : input(input), file(file) { advance(); }
+    lexer(std::string_view text, ast::file* file, diagnostics& diag) :
+        current(text.data()),
+        end(text.data() + text.size()),
+        file(file),
+        diag(diag)
+    {
+        advance();
+    }
 
     explicit operator bool() const noexcept
     {
@@ -48,8 +60,21 @@ struct lexer
 
     void advance();
 
-    std::ifstream& input;
+    // The lexer scans the full input in-place; 'current' always points at the first character not yet consumed
+    const char* current;
+    const char* end;
     ast::file* file;
+    diagnostics& diag;
     token current_token = token::invalid;
-    std::string string_value;
+
+    // Text of the current token. This always refers directly into the input text, so it is only valid for as long as
+    // the input is
+    std::string_view string_value;
+
+    // Discriminators found in comments (e.g. "// command: 'initialize';") since the parser last took them
+    std::vector<ast::discriminator> discriminators;
+
+    // Set when a comment since the parser last cleared it contained "@integer", which marks the next member as holding
+    // integers
+    bool integer_annotation = false;
 };
@@ -1,26 +1,282 @@
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include <thread_pool.h>
+
+#include "generator.h"
 #include "parser.h"
+#include "resolver.h"
+#include "source.h"
 
-int main(int argc, char** argv)
+namespace fs = std::filesystem;
+
+struct job
 {
-    const char* filename = "proto.ts";
-    if (argc > 1) filename = argv[1];
+    std::string filename;
+    std::string output_filename;
+    std::string image_filename; // Empty unless a schema image was asked for
+    diagnostics diag;
+    bool succeeded = false;
+};
 
-    std::ifstream input(filename);
-    if (input.fail())
+// Leaves the file alone if it already has the right contents so that anything that depends on it doesn't get rebuilt
+static bool write_if_changed(const std::string& filename, const std::string& contents)
+{
     {
-        std::printf("ERROR: Failed to open file '%s'\n", filename);
-        return 1;
+        std::ifstream existing(filename, std::ios::binary);
+        if (existing)
+        {
+            std::string current((std::istreambuf_iterator<char>(existing)), std::istreambuf_iterator<char>());
+            if (current == contents) return true;
+        }
+    }
+
+    std::ofstream stream(filename, std::ios::binary | std::ios::trunc);
+    stream.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    return stream.good();
+}
+
+static void run_job(job& work, const generator_options& options)
+{
+    source_buffer input;
+    if (!input.open(work.filename.c_str()))
+    {
+        work.diag.print("ERROR: Failed to open file '%s'\n", work.filename.c_str());
+        return;
     }
 
-    auto file = parse_file(input);
+    auto file = parse_file(input.text(), work.diag);
     if (!file)
     {
-        std::printf("Error encountered while parsing file; aborting\n");
+        work.diag.print("Error encountered while parsing file '%s'; aborting\n", work.filename.c_str());
+        return;
+    }
+
+    if (!resolve_file(*file, work.diag))
+    {
+        work.diag.print("Error encountered while resolving types in file '%s'; aborting\n", work.filename.c_str());
+        return;
+    }
+
+    std::string header, image;
+    auto sourceName = fs::path(work.filename).filename().string();
+    auto imagePtr = work.image_filename.empty() ? nullptr : &image;
+    if (!generate_header(*file, sourceName, options, header, work.diag, imagePtr))
+    {
+        work.diag.print("Error encountered while generating code for file '%s'; aborting\n", work.filename.c_str());
+        return;
+    }
+
+    if (!write_if_changed(work.output_filename, header))
+    {
+        work.diag.print("ERROR: Failed to write output file '%s'\n", work.output_filename.c_str());
+        return;
+    }
+
+    if (imagePtr && !write_if_changed(work.image_filename, image))
+    {
+        work.diag.print("ERROR: Failed to write output file '%s'\n", work.image_filename.c_str());
+        return;
+    }
+
+    work.succeeded = true;
+}
+
+static bool add_input(const std::string& path, std::vector<std::string>& inputs);
+
+// Response files list one input per line. Blank lines are ignored and inputs may themselves be directories or other
+// response files
+static bool add_response_file(const std::string& path, std::vector<std::string>& inputs)
+{
+    std::ifstream stream(path);
+    if (stream.fail())
+    {
+        std::printf("ERROR: Failed to open response file '%s'\n", path.c_str());
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(stream, line))
+    {
+        if (!line.empty() && (line.back() == '\r')) line.pop_back();
+        if (line.empty()) continue;
+        if (!add_input(line, inputs)) return false;
+    }
+
+    return true;
+}
+
+static bool add_input(const std::string& path, std::vector<std::string>& inputs)
+{
+    if (!path.empty() && (path[0] == '@'))
+    {
+        return add_response_file(path.substr(1), inputs);
+    }
+
+    std::error_code ec;
+    if (!fs::is_directory(path, ec))
+    {
+        inputs.push_back(path);
+        return true;
+    }
+
+    // Directory traversal order is unspecified, so sort to keep the output the same from run to run
+    std::vector<std::string> files;
+    for (auto& entry : fs::recursive_directory_iterator(path, ec))
+    {
+        if (entry.is_regular_file(ec) && (entry.path().extension() == ".ts"))
+        {
+            files.push_back(entry.path().string());
+        }
+    }
+
+    if (ec)
+    {
+        std::printf("ERROR: Failed to enumerate directory '%s'\n", path.c_str());
+        return false;
+    }
+
+    std::sort(files.begin(), files.end());
+    inputs.insert(inputs.end(), files.begin(), files.end());
+    return true;
+}
+
+static void print_usage()
+{
+    std::printf("USAGE: ts2cpp [-j <jobs>] [-o <directory>] [--compact] [--image] <input>...\n");
+    std::printf("    Each input may be a .ts file, a directory (searched recursively for .ts files), or '@<path>' to\n");
+    std::printf("    read more inputs from a response file. Defaults to 'proto.ts' when no inputs are given\n");
+    std::printf("    A header is generated for each input, named after the input with a '.h' extension. Headers are\n");
+    std::printf("    written next to their input unless an output directory is given\n");
+    std::printf("    --compact tracks optional members in a bitset rather than with std::optional, narrows enums, and\n");
+    std::printf("    orders members to avoid padding\n");
+    std::printf("    --image also writes a '.schema' file next to each header, which programs can map to validate\n");
+    std::printf("    JSON against the generated types without parsing the input again (see json_schema_image.h)\n");
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t jobCount = std::thread::hardware_concurrency();
+    std::string outputDirectory;
+    generator_options options;
+    bool writeImages = false;
+    std::vector<std::string> inputs;
+    bool hasInputArgs = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if ((arg == "-j") || (arg == "--jobs"))
+        {
+            if (++i == argc)
+            {
+                print_usage();
+                return 1;
+            }
+            jobCount = std::strtoul(argv[i], nullptr, 10);
+        }
+        else if ((arg == "-o") || (arg == "--output"))
+        {
+            if (++i == argc)
+            {
+                print_usage();
+                return 1;
+            }
+            outputDirectory = argv[i];
+        }
+        else if (arg == "--compact")
+        {
+            options.compact = true;
+        }
+        else if (arg == "--image")
+        {
+            writeImages = true;
+        }
+        else if ((arg == "-h") || (arg == "--help"))
+        {
+            print_usage();
+            return 0;
+        }
+        else
+        {
+            // An empty directory or response file is most likely a mistake, so don't quietly fall back to the default
+            auto count = inputs.size();
+            if (!add_input(arg, inputs)) return 1;
+            if (inputs.size() == count)
+            {
+                std::printf("ERROR: No inputs found in '%s'\n", arg.c_str());
+                return 1;
+            }
+            hasInputArgs = true;
+        }
+    }
+
+    if (!hasInputArgs) inputs.push_back("proto.ts");
+
+    if (!outputDirectory.empty())
+    {
+        std::error_code ec;
+        fs::create_directories(outputDirectory, ec);
+        if (ec)
+        {
+            std::printf("ERROR: Failed to create output directory '%s'\n", outputDirectory.c_str());
+            return 1;
+        }
+    }
+
+    std::vector<job> jobs(inputs.size());
+    std::vector<std::string> outputs;
+    for (std::size_t i = 0; i < inputs.size(); ++i)
+    {
+        fs::path output = inputs[i];
+        output.replace_extension(".h");
+        if (!outputDirectory.empty()) output = fs::path(outputDirectory) / output.filename();
+
+        jobs[i].filename = std::move(inputs[i]);
+        jobs[i].output_filename = output.string();
+        if (writeImages) jobs[i].image_filename = output.replace_extension(".schema").string();
+        outputs.push_back(jobs[i].output_filename);
+    }
+
+    // Two inputs writing to the same header would race with each other
+    std::sort(outputs.begin(), outputs.end());
+    if (auto itr = std::adjacent_find(outputs.begin(), outputs.end()); itr != outputs.end())
+    {
+        std::printf("ERROR: More than one input would generate '%s'\n", itr->c_str());
         return 1;
     }
 
-    return 0;
+    if ((jobCount <= 1) || (jobs.size() == 1))
+    {
+        for (auto& work : jobs)
+        {
+            run_job(work, options);
+        }
+    }
+    else
+    {
+        ts2cpp::thread_pool pool(std::min(jobCount, jobs.size()));
+        for (auto& work : jobs)
+        {
+            pool.submit([&work, &options] { run_job(work, options); });
+        }
+        pool.wait();
+    }
+
+    // Report in input order so that the output doesn't depend on scheduling
+    int result = 0;
+    for (auto& work : jobs)
+    {
+        std::fputs(work.diag.text.c_str(), stdout);
+        if (!work.succeeded) result = 1;
+    }
+
+    return result;
 }
@@ -16,17 +16,17 @@ static ast::module* parse_module(lexer& lex)
 
     if (lex.current_token != token::identifier)
     {
-        std::printf("ERROR: Unexpected token '%s' for name of module; expected an identifier\n", lex.string_value.c_str());
+        lex.diag.print("ERROR: Unexpected token '%.*s' for name of module; expected an identifier\n", static_cast<int>(lex.string_value.size()), lex.string_value.data());
         return nullptr;
     }
 
-    auto result = std::make_unique<ast::module>();
-    result->name.swap(lex.string_value);
+    auto result = lex.file->make<ast::module>();
+    result->name = lex.file->symbols.intern(lex.string_value);
 
     lex.advance();
     if (lex.current_token != token::open_curly)
     {
-        std::printf("ERROR: Unexpected token '%s' after declaration of module '%s'; expected an '{'\n", lex.string_value.c_str(), result->name.c_str());
+        lex.diag.print("ERROR: Unexpected token '%.*s' after declaration of module '%s'; expected an '{'\n", static_cast<int>(lex.string_value.size()), lex.string_value.data(), lex.file->symbols.c_str(result->name));
         return nullptr;
     }
 
@@ -40,52 +40,50 @@ static ast::module* parse_module(lexer& lex)
             auto ptr = parse_export(lex);
             if (!ptr)
             {
-                std::printf("NOTE: While processing module '%s'\n", result->name.c_str());
+                lex.diag.print("NOTE: While processing module '%s'\n", lex.file->symbols.c_str(result->name));
                 return nullptr;
             }
-            ptr->parent = result.get();
-            result->children.push_back(std::move(ptr));
+            ptr->parent = result;
+            result->children.push_back(lex.file->storage, ptr);
         }   break;
 
         default:
-            std::printf("ERROR: Unexpected token '%s' while parsing module '%s' body\n", lex.string_value.c_str(), result->name.c_str());
+            lex.diag.print("ERROR: Unexpected token '%.*s' while parsing module '%s' body\n", static_cast<int>(lex.string_value.size()), lex.string_value.data(), lex.file->symbols.c_str(result->name));
             return nullptr;
         }
     }
 
     lex.advance(); // Consume the '}'
-
-    auto resultPtr = result.get();
-    lex.file->nodes.push_back(std::move(result));
-    return resultPtr;
+    return result;
 }
 
-static ast::node* parse_type_reference(lexer& lex)
+static ast::node* parse_primary_type(lexer& lex)
 {
     ast::node* result = nullptr;
     switch (lex.current_token)
     {
     case token::type_string:
-        result = new ast::fundamental_type_reference(ast::fundamental_type::string);
-        lex.file->nodes.emplace_back(result);
+        result = lex.file->make<ast::fundamental_type_reference>(ast::fundamental_type::string);
         lex.advance();
         break;
 
     case token::type_boolean:
-        result = new ast::fundamental_type_reference(ast::fundamental_type::boolean);
-        lex.file->nodes.emplace_back(result);
+        result = lex.file->make<ast::fundamental_type_reference>(ast::fundamental_type::boolean);
         lex.advance();
         break;
 
     case token::type_number:
-        result = new ast::fundamental_type_reference(ast::fundamental_type::number);
-        lex.file->nodes.emplace_back(result);
+        result = lex.file->make<ast::fundamental_type_reference>(ast::fundamental_type::number);
         lex.advance();
         break;
 
     case token::type_any:
-        result = new ast::fundamental_type_reference(ast::fundamental_type::any);
-        lex.file->nodes.emplace_back(result);
+        result = lex.file->make<ast::fundamental_type_reference>(ast::fundamental_type::any);
+        lex.advance();
+        break;
+
+    case token::type_null:
+        result = lex.file->make<ast::fundamental_type_reference>(ast::fundamental_type::null);
         lex.advance();
         break;
 
@@ -95,55 +93,137 @@ static ast::node* parse_type_reference(lexer& lex)
 
     case token::identifier:
     {
-        auto ref = std::make_unique<ast::interface_reference>();
-        ref->name.swap(lex.string_value);
-        result = ref.get();
-        lex.file->nodes.push_back(std::move(ref));
+        auto ref = lex.file->make<ast::interface_reference>();
+        ref->name = lex.file->symbols.intern(lex.string_value);
+        result = ref;
         lex.advance();
     }   break;
 
     case token::string:
     {
-        auto defn = std::make_unique<ast::enumeration>();
-        while (true)
+        // Adjacent string literals in a union get merged into a single enumeration by 'parse_type_reference'
+        auto defn = lex.file->make<ast::enumeration>();
+        defn->values.push_back(lex.file->storage, lex.file->symbols.intern(lex.string_value));
+        result = defn;
+        lex.advance();
+    }   break;
+
+    default:
+        lex.diag.print("ERROR: Unexpected identifier '%.*s'; expected a type or identifier\n", static_cast<int>(lex.string_value.size()), lex.string_value.data());
+        return nullptr;
+    }
+
+    if (!result)
+    {
+        return nullptr;
+    }
+
+    while (lex.current_token == token::open_bracket)
+    {
+        auto arr = lex.file->make<ast::array>();
+        arr->type = result;
+        result->parent = arr;
+        result = arr;
+
+        lex.advance();
+        if (lex.current_token != token::close_bracket)
         {
-            defn->values.push_back(std::move(lex.string_value));
-            lex.advance();
+            lex.diag.print("ERROR: Unexpected token '%.*s' while parsing array type; expected ']'\n", static_cast<int>(lex.string_value.size()), lex.string_value.data());
+            return nullptr;
+        }
+        lex.advance();
+    }
+
+    return result;
+}
 
-            if (lex.current_token != token::pipe)
+static ast::node* parse_type_reference(lexer& lex)
+{
+    auto first = parse_primary_type(lex);
+    if (!first || (lex.current_token != token::pipe))
+    {
+        return first;
+    }
+
+    auto result = lex.file->make<ast::union_type>();
+    ast::enumeration* literals = nullptr;
+    auto add_type = [&](ast::node* type)
+    {
+        if (type->kind == ast::node_kind::enumeration)
+        {
+            auto defn = static_cast<ast::enumeration*>(type);
+            if (literals)
             {
-                break;
+                for (auto value : defn->values)
+                {
+                    literals->values.push_back(lex.file->storage, value);
+                }
+                return;
             }
-            lex.advance();
+            literals = defn;
         }
 
-        result = defn.get();
-        lex.file->nodes.push_back(std::move(defn));
-    }   break;
+        type->parent = result;
+        result->types.push_back(lex.file->storage, type);
+    };
 
-    default:
-        std::printf("ERROR: Unexpected identifier '%s'; expected a type or identifier\n", lex.string_value.c_str());
-        return nullptr;
+    add_type(first);
+    while (lex.current_token == token::pipe)
+    {
+        lex.advance();
+        auto type = parse_primary_type(lex);
+        if (!type)
+        {
+            return nullptr;
+        }
+        add_type(type);
+    }
+
+    // A union of only string literals is just an enumeration
+    if (result->types.size() == 1)
+    {
+        result->types[0]->parent = nullptr;
+        return result->types[0];
     }
 
     return result;
 }
 
+// Moves the discriminators that the lexer found in comments since the last call over to 'obj'
+static void take_discriminators(lexer& lex, ast::object* obj)
+{
+    for (auto& disc : lex.discriminators)
+    {
+        obj->discriminators.push_back(lex.file->storage, disc);
+    }
+    lex.discriminators.clear();
+}
+
 static ast::object* parse_object(lexer& lex)
 {
     assert(lex.current_token == token::open_curly);
+    lex.discriminators.clear(); // Anything seen before the '{' doesn't belong to this object
+    lex.integer_annotation = false;
     lex.advance(); // Consume the '{'
 
-    auto result = std::make_unique<ast::object>();
-    while (lex.current_token != token::close_curly)
+    auto result = lex.file->make<ast::object>();
+    while (true)
     {
+        // NOTE: Nested objects take their own discriminators before we get here
+        take_discriminators(lex, result);
+        if (lex.current_token == token::close_curly) break;
+
         switch (lex.current_token)
         {
-        case token::keyword_module: // Allowed as an identifier in certain contexts
+        case token::keyword_module: // Allowed as identifiers in certain contexts
+        case token::keyword_type:
         case token::identifier:
         {
-            auto member = std::make_unique<ast::member>();
-            member->name.swap(lex.string_value);
+            auto member = lex.file->make<ast::member>();
+            member->parent = result;
+            member->name = lex.file->symbols.intern(lex.string_value);
+            member->is_integer = lex.integer_annotation;
+            lex.integer_annotation = false;
             lex.advance();
 
             if (lex.current_token == token::question)
@@ -154,7 +234,7 @@ static ast::object* parse_object(lexer& lex)
 
             if (lex.current_token != token::colon)
             {
-                std::printf("ERROR: Unexpected token '%s' while parsing object member '%s'; expected ':'\n", lex.string_value.c_str(), member->name.c_str());
+                lex.diag.print("ERROR: Unexpected token '%.*s' while parsing object member '%s'; expected ':'\n", static_cast<int>(lex.string_value.size()), lex.string_value.data(), lex.file->symbols.c_str(member->name));
                 return nullptr;
             }
             lex.advance();
@@ -162,50 +242,107 @@ static ast::object* parse_object(lexer& lex)
             ast::node* type = parse_type_reference(lex);
             if (!type)
             {
-                std::printf("NOTE: While processing object member '%s'\n", member->name.c_str());
+                lex.diag.print("NOTE: While processing object member '%s'\n", lex.file->symbols.c_str(member->name));
                 return nullptr;
             }
+            type->parent = member;
+            member->type = type;
 
-            if (lex.current_token == token::open_bracket)
+            // A single string literal, e.g. "command: 'initialize';"
+            if ((type->kind == ast::node_kind::enumeration) &&
+                (static_cast<ast::enumeration*>(type)->values.size() == 1))
             {
-                auto arr = std::make_unique<ast::array>();
-                arr->type = type;
-                type->parent = arr.get();
-                type = arr.get();
-                lex.file->nodes.push_back(std::move(arr));
+                result->discriminators.push_back(lex.file->storage,
+                    { member->name, static_cast<ast::enumeration*>(type)->values[0] });
+            }
 
+            // The separator is optional after the last member
+            if (lex.current_token == token::semicolon)
+            {
                 lex.advance();
-                if (lex.current_token != token::close_bracket)
-                {
-                    std::printf("ERROR: Unexpected token '%s' while parsing object member '%s'; expected ']'\n", lex.string_value.c_str(), member->name.c_str());
-                    return nullptr;
-                }
-                lex.advance();
+            }
+            else if (lex.current_token != token::close_curly)
+            {
+                lex.diag.print("ERROR: Unexpected token '%.*s' while parsing object member '%s'; expected ';'\n", static_cast<int>(lex.string_value.size()), lex.string_value.data(), lex.file->symbols.c_str(member->name));
+                return nullptr;
+            }
+
+            result->named_members.push_back(lex.file->storage, member);
+        }   break;
+
+        case token::open_bracket:
+        {
+            // Index signature, i.e. '[key: string]: type;'
+            if (result->index_type)
+            {
+                lex.diag.print("ERROR: Object has more than one index signature\n");
+                return nullptr;
+            }
+
+            lex.advance();
+            if (lex.current_token != token::identifier)
+            {
+                lex.diag.print("ERROR: Unexpected token '%.*s' while parsing index signature; expected an identifier\n", static_cast<int>(lex.string_value.size()), lex.string_value.data());
+                return nullptr;
             }
 
-            if (lex.current_token != token::semicolon)
+            lex.advance();
+            if (lex.current_token != token::colon)
             {
-                std::printf("ERROR: Unexpected token '%s' while parsing object member '%s'; expected ';'\n", lex.string_value.c_str(), member->name.c_str());
+                lex.diag.print("ERROR: Unexpected token '%.*s' while parsing index signature; expected ':'\n", static_cast<int>(lex.string_value.size()), lex.string_value.data());
                 return nullptr;
             }
+
             lex.advance();
+            if (lex.current_token != token::type_string)
+            {
+                lex.diag.print("ERROR: Unexpected token '%.*s' while parsing index signature; only 'string' keys are supported\n", static_cast<int>(lex.string_value.size()), lex.string_value.data());
+                return nullptr;
+            }
 
-            auto memberPtr = member.get();
-            lex.file->nodes.push_back(std::move(member));
-            result->named_members.push_back(memberPtr);
+            lex.advance();
+            if (lex.current_token != token::close_bracket)
+            {
+                lex.diag.print("ERROR: Unexpected token '%.*s' while parsing index signature; expected ']'\n", static_cast<int>(lex.string_value.size()), lex.string_value.data());
+                return nullptr;
+            }
+
+            lex.advance();
+            if (lex.current_token != token::colon)
+            {
+                lex.diag.print("ERROR: Unexpected token '%.*s' while parsing index signature; expected ':'\n", static_cast<int>(lex.string_value.size()), lex.string_value.data());
+                return nullptr;
+            }
+
+            lex.advance();
+            auto type = parse_type_reference(lex);
+            if (!type)
+            {
+                lex.diag.print("NOTE: While processing index signature\n");
+                return nullptr;
+            }
+            type->parent = result;
+            result->index_type = type;
+
+            if (lex.current_token == token::semicolon)
+            {
+                lex.advance();
+            }
+            else if (lex.current_token != token::close_curly)
+            {
+                lex.diag.print("ERROR: Unexpected token '%.*s' while parsing index signature; expected ';'\n", static_cast<int>(lex.string_value.size()), lex.string_value.data());
+                return nullptr;
+            }
         }   break;
 
         default:
-            std::printf("ERROR: Unexpected token '%s' while parsing object body\n", lex.string_value.c_str());
+            lex.diag.print("ERROR: Unexpected token '%.*s' while parsing object body\n", static_cast<int>(lex.string_value.size()), lex.string_value.data());
             return nullptr;
         }
     }
 
     lex.advance(); // Consume the '}'
-
-    auto resultPtr = result.get();
-    lex.file->nodes.push_back(std::move(result));
-    return resultPtr;
+    return result;
 }
 
 static ast::interface* parse_interface(lexer& lex)
@@ -215,12 +352,12 @@ static ast::interface* parse_interface(lexer& lex)
 
     if (lex.current_token != token::identifier)
     {
-        std::printf("ERROR: Unexpected token '%s' for name of interface; expected an identifier\n", lex.string_value.c_str());
+        lex.diag.print("ERROR: Unexpected token '%.*s' for name of interface; expected an identifier\n", static_cast<int>(lex.string_value.size()), lex.string_value.data());
         return nullptr;
     }
 
-    auto result = std::make_unique<ast::interface>();
-    result->name.swap(lex.string_value);
+    auto result = lex.file->make<ast::interface>();
+    result->name = lex.file->symbols.intern(lex.string_value);
 
     lex.advance();
     if (lex.current_token == token::keyword_extends)
@@ -228,34 +365,71 @@ static ast::interface* parse_interface(lexer& lex)
         lex.advance();
         if (lex.current_token != token::identifier)
         {
-            std::printf("ERROR: Unexpected token '%s' while parsing 'extends' type for interface '%s'; expected an identifier\n", lex.string_value.c_str(), result->name.c_str());
+            lex.diag.print("ERROR: Unexpected token '%.*s' while parsing 'extends' type for interface '%s'; expected an identifier\n", static_cast<int>(lex.string_value.size()), lex.string_value.data(), lex.file->symbols.c_str(result->name));
             return nullptr;
         }
 
-        auto baseRef = std::make_unique<ast::interface_reference>();
-        baseRef->name.swap(lex.string_value);
-        result->base = baseRef.get();
-        lex.file->nodes.push_back(std::move(baseRef));
+        auto baseRef = lex.file->make<ast::interface_reference>();
+        baseRef->name = lex.file->symbols.intern(lex.string_value);
+        result->base = baseRef;
         lex.advance();
     }
 
     if (lex.current_token != token::open_curly)
     {
-        std::printf("ERROR: Unexpected token '%s' after declaration of interface '%s'; expected an '{'\n", lex.string_value.c_str(), result->name.c_str());
+        lex.diag.print("ERROR: Unexpected token '%.*s' after declaration of interface '%s'; expected an '{'\n", static_cast<int>(lex.string_value.size()), lex.string_value.data(), lex.file->symbols.c_str(result->name));
         return nullptr;
     }
 
     result->definition = parse_object(lex);
     if (!result->definition)
     {
-        std::printf("NOTE: While processing interface '%s'\n", result->name.c_str());
+        lex.diag.print("NOTE: While processing interface '%s'\n", lex.file->symbols.c_str(result->name));
         return nullptr;
     }
-    result->definition->parent = result.get();
+    result->definition->parent = result;
 
-    auto resultPtr = result.get();
-    lex.file->nodes.push_back(std::move(result));
-    return resultPtr;
+    return result;
+}
+
+static ast::type_alias* parse_type_alias(lexer& lex)
+{
+    assert(lex.current_token == token::keyword_type);
+    lex.advance();
+
+    if (lex.current_token != token::identifier)
+    {
+        lex.diag.print("ERROR: Unexpected token '%.*s' for name of type alias; expected an identifier\n", static_cast<int>(lex.string_value.size()), lex.string_value.data());
+        return nullptr;
+    }
+
+    auto result = lex.file->make<ast::type_alias>();
+    result->name = lex.file->symbols.intern(lex.string_value);
+
+    lex.advance();
+    if (lex.current_token != token::equals)
+    {
+        lex.diag.print("ERROR: Unexpected token '%.*s' after declaration of type alias '%s'; expected an '='\n", static_cast<int>(lex.string_value.size()), lex.string_value.data(), lex.file->symbols.c_str(result->name));
+        return nullptr;
+    }
+
+    lex.advance();
+    result->type = parse_type_reference(lex);
+    if (!result->type)
+    {
+        lex.diag.print("NOTE: While processing type alias '%s'\n", lex.file->symbols.c_str(result->name));
+        return nullptr;
+    }
+    result->type->parent = result;
+
+    if (lex.current_token != token::semicolon)
+    {
+        lex.diag.print("ERROR: Unexpected token '%.*s' while parsing type alias '%s'; expected ';'\n", static_cast<int>(lex.string_value.size()), lex.string_value.data(), lex.file->symbols.c_str(result->name));
+        return nullptr;
+    }
+    lex.advance();
+
+    return result;
 }
 
 static ast::node* parse_export(lexer& lex)
@@ -278,57 +452,71 @@ static ast::node* parse_export(lexer& lex)
         return result;
     }
 
+    case token::keyword_type:
+    {
+        auto result = parse_type_alias(lex);
+        if (result) result->is_export = true;
+        return result;
+    }
+
     default:
-        std::printf("ERROR: Unexpected token '%s' while parsing export\n", lex.string_value.c_str());
+        lex.diag.print("ERROR: Unexpected token '%.*s' while parsing export\n", static_cast<int>(lex.string_value.size()), lex.string_value.data());
         return nullptr;
     }
 }
 
-std::unique_ptr<ast::file> parse_file(std::ifstream& input)
+std::unique_ptr<ast::file> parse_file(std::string_view text, diagnostics& diag)
 {
     auto result = std::make_unique<ast::file>();
 
-    lexer lex(input, result.get());
+    lexer lex(text, result.get(), diag);
+    bool firstToken = true;
     while (lex)
     {
-        bool firstToken = true;
         switch (lex.current_token)
         {
         case token::string:
             if (lex.string_value != "use strict"sv)
             {
-                std::printf("ERROR: String '%s' unexpected at file scope\n", lex.string_value.c_str());
+                lex.diag.print("ERROR: String '%.*s' unexpected at file scope\n", static_cast<int>(lex.string_value.size()), lex.string_value.data());
                 return nullptr;
             }
             else if (lex.advance(); lex.current_token != token::semicolon)
             {
-                std::printf("ERROR: Missing ';' after 'use strict'\n");
+                lex.diag.print("ERROR: Missing ';' after 'use strict'\n");
                 return nullptr;
             }
             else if (!firstToken)
             {
-                std::printf("ERROR: 'use strict' must be the first statement\n");
+                lex.diag.print("ERROR: 'use strict' must be the first statement\n");
                 return nullptr;
             }
             result->strict = true;
+            lex.advance(); // Consume the ';'
             break;
 
         case token::keyword_export:
         {
+            // NOTE: Declarations consume their own trailing tokens
             auto ptr = parse_export(lex);
             if (!ptr) return nullptr;
             ptr->parent = result.get();
-            result->children.push_back(ptr);
+            result->children.push_back(result->storage, ptr);
         }   break;
 
         default:
-            std::printf("ERROR: Token '%s' unexpected at file scope\n", lex.string_value.c_str());
+            lex.diag.print("ERROR: Token '%.*s' unexpected at file scope\n", static_cast<int>(lex.string_value.size()), lex.string_value.data());
             return nullptr;
         }
 
-        lex.advance();
         firstToken = false;
     }
 
+    if (lex.current_token == token::invalid)
+    {
+        // The lexer has already reported the error
+        return nullptr;
+    }
+
     return result;
 }
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <memory>
+#include <string_view>
+
 #include "ast.h"
+#include "diagnostics.h"
 
-std::unique_ptr<ast::file> parse_file(std::ifstream& input);
+std::unique_ptr<ast::file> parse_file(std::string_view text, diagnostics& diag);
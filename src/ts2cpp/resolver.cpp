@@ -0,0 +1,248 @@
+
+#include <unordered_map>
+#include <vector>
+
+#include "resolver.h"
+
+namespace
+{
+    enum class flatten_state
+    {
+        in_progress,
+        done,
+    };
+
+    struct resolver
+    {
+        resolver(ast::file& file, diagnostics& diag) : file(file), diag(diag) {}
+
+        bool run();
+
+    private:
+        const char* str(ast::symbol sym) const { return file.symbols.c_str(sym); }
+
+        bool add_declarations(const ast::module* scope, const ast::list<ast::node*>& children);
+        bool bind(ast::node* type, const ast::module* scope);
+        bool flatten(ast::interface* iface);
+
+        ast::file& file;
+        diagnostics& diag;
+        std::unordered_map<const ast::interface*, flatten_state> states;
+    };
+}
+
+static ast::symbol declaration_name(const ast::node* node)
+{
+    return (node->kind == ast::node_kind::interface) ? static_cast<const ast::interface*>(node)->name :
+        static_cast<const ast::type_alias*>(node)->name;
+}
+
+const ast::node* find_declaration(const ast::file& file, const ast::module* scope, ast::symbol name)
+{
+    if (scope)
+    {
+        if (auto itr = file.declarations.find({ scope, name }); itr != file.declarations.end()) return itr->second;
+    }
+
+    auto itr = file.declarations.find({ nullptr, name });
+    return (itr != file.declarations.end()) ? itr->second : nullptr;
+}
+
+bool resolver::add_declarations(const ast::module* scope, const ast::list<ast::node*>& children)
+{
+    for (auto child : children)
+    {
+        // Modules only get one level of namespace in the generated code, and names are only looked up in their own
+        // module and the file scope
+        if (scope && (child->kind == ast::node_kind::module))
+        {
+            diag.print("ERROR: Module '%s' is nested in module '%s', which is not supported\n",
+                str(static_cast<const ast::module*>(child)->name), str(scope->name));
+            return false;
+        }
+
+        // NOTE: TypeScript merges repeated interface declarations, but the generated code can't, so they're an error
+        if ((child->kind == ast::node_kind::interface) || (child->kind == ast::node_kind::type_alias))
+        {
+            auto name = declaration_name(child);
+            if (!file.declarations.emplace(ast::scoped_name{ scope, name }, child).second)
+            {
+                diag.print("ERROR: Duplicate declaration of '%s'\n", str(name));
+                if (scope) diag.print("NOTE: In module '%s'\n", str(scope->name));
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool resolver::bind(ast::node* type, const ast::module* scope)
+{
+    switch (type->kind)
+    {
+    case ast::node_kind::interface_reference:
+    {
+        auto ref = static_cast<ast::interface_reference*>(type);
+        ref->declaration = const_cast<ast::node*>(find_declaration(file, scope, ref->name));
+        if (!ref->declaration)
+        {
+            diag.print("ERROR: Reference to unknown type '%s'\n", str(ref->name));
+            return false;
+        }
+        return true;
+    }
+
+    case ast::node_kind::array:
+        return bind(static_cast<ast::array*>(type)->type, scope);
+
+    case ast::node_kind::union_type:
+        for (auto option : static_cast<ast::union_type*>(type)->types)
+        {
+            if (!bind(option, scope)) return false;
+        }
+        return true;
+
+    case ast::node_kind::object:
+    {
+        auto obj = static_cast<ast::object*>(type);
+        for (auto member : obj->named_members)
+        {
+            if (!bind(member->type, scope))
+            {
+                diag.print("NOTE: While resolving member '%s'\n", str(member->name));
+                return false;
+            }
+        }
+        return !obj->index_type || bind(obj->index_type, scope);
+    }
+
+    case ast::node_kind::interface:
+    {
+        auto iface = static_cast<ast::interface*>(type);
+        if (iface->base && !bind(iface->base, scope)) return false;
+        return bind(iface->definition, scope);
+    }
+
+    case ast::node_kind::type_alias:
+        return bind(static_cast<ast::type_alias*>(type)->type, scope);
+
+    default:
+        return true;
+    }
+}
+
+// Each interface is flattened once, on top of its base's already flattened members, so long inheritance chains (e.g.
+// 'ErrorResponse -> Response -> ProtocolMessage') don't get walked again for every interface that extends them
+bool resolver::flatten(ast::interface* iface)
+{
+    if (auto itr = states.find(iface); itr != states.end())
+    {
+        if (itr->second == flatten_state::done) return true;
+
+        diag.print("ERROR: Interface '%s' circularly extends itself\n", str(iface->name));
+        return false;
+    }
+
+    states.emplace(iface, flatten_state::in_progress);
+
+    // Positions of the members so far, so that redeclarations can be found without a search
+    std::unordered_map<ast::symbol, std::size_t> positions;
+    if (iface->base)
+    {
+        auto baseRef = static_cast<const ast::interface_reference*>(iface->base);
+        if (baseRef->declaration->kind != ast::node_kind::interface)
+        {
+            diag.print("ERROR: Interface '%s' extends '%s', which is not a known interface\n", str(iface->name),
+                str(baseRef->name));
+            return false;
+        }
+
+        auto base = static_cast<ast::interface*>(baseRef->declaration);
+        if (!flatten(base))
+        {
+            diag.print("NOTE: While resolving interface '%s'\n", str(iface->name));
+            return false;
+        }
+
+        for (auto member : base->all_members)
+        {
+            positions.emplace(member->name, iface->all_members.size());
+            iface->all_members.push_back(file.storage, member);
+        }
+    }
+
+    // Members redeclared by a derived interface replace the base's declaration in place. The exception is a
+    // discriminator (e.g. "command: 'initialize';"), which keeps the base's type so that every interface in the family
+    // agrees on it
+    for (auto member : iface->definition->named_members)
+    {
+        if (auto itr = positions.find(member->name); itr != positions.end())
+        {
+            bool isLiteral = (member->type->kind == ast::node_kind::enumeration) &&
+                (static_cast<const ast::enumeration*>(member->type)->values.size() == 1);
+            if (!isLiteral) iface->all_members[itr->second] = member;
+        }
+        else
+        {
+            positions.emplace(member->name, iface->all_members.size());
+            iface->all_members.push_back(file.storage, member);
+        }
+    }
+
+    states[iface] = flatten_state::done;
+    return true;
+}
+
+bool resolver::run()
+{
+    if (!add_declarations(nullptr, file.children)) return false;
+    for (auto child : file.children)
+    {
+        if ((child->kind == ast::node_kind::module) &&
+            !add_declarations(static_cast<const ast::module*>(child), static_cast<const ast::module*>(child)->children))
+        {
+            return false;
+        }
+    }
+
+    // Bind everything before flattening, which follows the bindings of base interfaces
+    std::vector<ast::interface*> interfaces;
+    auto bind_all = [&](const ast::module* scope, const ast::list<ast::node*>& children)
+    {
+        for (auto child : children)
+        {
+            if ((child->kind != ast::node_kind::interface) && (child->kind != ast::node_kind::type_alias)) continue;
+            if (!bind(child, scope))
+            {
+                diag.print("NOTE: While resolving '%s'\n", str(declaration_name(child)));
+                return false;
+            }
+            if (child->kind == ast::node_kind::interface) interfaces.push_back(static_cast<ast::interface*>(child));
+        }
+        return true;
+    };
+
+    if (!bind_all(nullptr, file.children)) return false;
+    for (auto child : file.children)
+    {
+        if ((child->kind == ast::node_kind::module) &&
+            !bind_all(static_cast<const ast::module*>(child), static_cast<const ast::module*>(child)->children))
+        {
+            return false;
+        }
+    }
+
+    for (auto iface : interfaces)
+    {
+        if (!flatten(iface)) return false;
+    }
+
+    return true;
+}
+
+bool resolve_file(ast::file& file, diagnostics& diag)
+{
+    resolver res(file, diag);
+    return res.run();
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "ast.h"
+#include "diagnostics.h"
+
+// Binds every 'interface_reference' in 'file' to the declaration that it names, first looking in the enclosing module
+// and then at file scope, and fills in each interface's 'all_members'. Fails on references to unknown types and on
+// interfaces that extend something other than an interface, or (indirectly) themselves
+bool resolve_file(ast::file& file, diagnostics& diag);
+
+// The interface or type alias named 'name' as seen from 'scope', or null if there isn't one. Only valid once the file
+// has been resolved
+const ast::node* find_declaration(const ast::file& file, const ast::module* scope, ast::symbol name);
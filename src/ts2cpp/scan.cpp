@@ -0,0 +1,271 @@
+
+#include <cstdint>
+
+#include "scan.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define TS2CPP_SCAN_X64 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define TS2CPP_TARGET_AVX2
+#else
+#define TS2CPP_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+using namespace scan;
+
+static constexpr bool is_whitespace(char ch) noexcept
+{
+    return (ch == ' ') || (ch == '\f') || (ch == '\n') || (ch == '\r') ||
+        (ch == '\t') || (ch == '\v');
+}
+
+static const char* skip_whitespace_scalar(const char* pos, const char* end) noexcept
+{
+    while ((pos != end) && is_whitespace(*pos)) ++pos;
+    return pos;
+}
+
+static const char* find_char_scalar(const char* pos, const char* end, char ch) noexcept
+{
+    while ((pos != end) && (*pos != ch)) ++pos;
+    return pos;
+}
+
+static const char* find_comment_end_scalar(const char* pos, const char* end) noexcept
+{
+    while (true)
+    {
+        pos = find_char_scalar(pos, end, '*');
+        if (pos == end) return end;
+        else if ((end - pos >= 2) && (pos[1] == '/')) return pos;
+        ++pos;
+    }
+}
+
+#ifdef TS2CPP_SCAN_X64
+
+static unsigned count_trailing_zeros(std::uint32_t value) noexcept
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return index;
+#else
+    return static_cast<unsigned>(__builtin_ctz(value));
+#endif
+}
+
+// NOTE: The whitespace characters other than ' ' are the contiguous range '\t' (9) through '\r' (13). An unsigned
+// "ch - 9 <= 4" check covers them, which SSE2 can express as "min(ch - 9, 4) == ch - 9"
+static const char* skip_whitespace_sse2(const char* pos, const char* end) noexcept
+{
+    auto spaces = _mm_set1_epi8(' ');
+    auto tab = _mm_set1_epi8('\t');
+    auto rangeMax = _mm_set1_epi8('\r' - '\t');
+    for (; end - pos >= 16; pos += 16)
+    {
+        auto data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+        auto offset = _mm_sub_epi8(data, tab);
+        auto ws = _mm_or_si128(_mm_cmpeq_epi8(data, spaces), _mm_cmpeq_epi8(_mm_min_epu8(offset, rangeMax), offset));
+        auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(ws)) ^ 0xFFFF;
+        if (mask) return pos + count_trailing_zeros(mask);
+    }
+
+    return skip_whitespace_scalar(pos, end);
+}
+
+static const char* find_char_sse2(const char* pos, const char* end, char ch) noexcept
+{
+    auto needle = _mm_set1_epi8(ch);
+    for (; end - pos >= 16; pos += 16)
+    {
+        auto data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+        auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(data, needle)));
+        if (mask) return pos + count_trailing_zeros(mask);
+    }
+
+    return find_char_scalar(pos, end, ch);
+}
+
+static const char* find_comment_end_sse2(const char* pos, const char* end) noexcept
+{
+    // Compare against '*' at each position and '/' at each position + 1; a match in both is the "*/" we're after
+    auto star = _mm_set1_epi8('*');
+    auto slash = _mm_set1_epi8('/');
+    for (; end - pos >= 17; pos += 16)
+    {
+        auto first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+        auto second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos + 1));
+        auto match = _mm_and_si128(_mm_cmpeq_epi8(first, star), _mm_cmpeq_epi8(second, slash));
+        auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(match));
+        if (mask) return pos + count_trailing_zeros(mask);
+    }
+
+    return find_comment_end_scalar(pos, end);
+}
+
+TS2CPP_TARGET_AVX2 static const char* skip_whitespace_avx2(const char* pos, const char* end) noexcept
+{
+    auto spaces = _mm256_set1_epi8(' ');
+    auto tab = _mm256_set1_epi8('\t');
+    auto rangeMax = _mm256_set1_epi8('\r' - '\t');
+    for (; end - pos >= 32; pos += 32)
+    {
+        auto data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+        auto offset = _mm256_sub_epi8(data, tab);
+        auto ws = _mm256_or_si256(
+            _mm256_cmpeq_epi8(data, spaces),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(offset, rangeMax), offset));
+        auto mask = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(ws));
+        if (mask) return pos + count_trailing_zeros(mask);
+    }
+
+    return skip_whitespace_sse2(pos, end);
+}
+
+TS2CPP_TARGET_AVX2 static const char* find_char_avx2(const char* pos, const char* end, char ch) noexcept
+{
+    auto needle = _mm256_set1_epi8(ch);
+    for (; end - pos >= 32; pos += 32)
+    {
+        auto data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+        auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(data, needle)));
+        if (mask) return pos + count_trailing_zeros(mask);
+    }
+
+    return find_char_sse2(pos, end, ch);
+}
+
+TS2CPP_TARGET_AVX2 static const char* find_comment_end_avx2(const char* pos, const char* end) noexcept
+{
+    auto star = _mm256_set1_epi8('*');
+    auto slash = _mm256_set1_epi8('/');
+    for (; end - pos >= 33; pos += 32)
+    {
+        auto first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+        auto second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos + 1));
+        auto match = _mm256_and_si256(_mm256_cmpeq_epi8(first, star), _mm256_cmpeq_epi8(second, slash));
+        auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(match));
+        if (mask) return pos + count_trailing_zeros(mask);
+    }
+
+    return find_comment_end_sse2(pos, end);
+}
+
+static bool cpu_supports_avx2() noexcept
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    // AVX2 also requires that the OS saves the YMM registers on context switch
+    __cpuid(info, 1);
+    constexpr int osxsave = 1 << 27;
+    if (!(info[2] & osxsave) || ((_xgetbv(0) & 0x6) != 0x6)) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+namespace
+{
+    struct kernels
+    {
+        isa kind;
+        const char* (*skip_whitespace)(const char*, const char*) noexcept;
+        const char* (*find_char)(const char*, const char*, char) noexcept;
+        const char* (*find_comment_end)(const char*, const char*) noexcept;
+    };
+}
+
+static constexpr kernels scalar_kernels = {
+    isa::scalar, skip_whitespace_scalar, find_char_scalar, find_comment_end_scalar };
+#ifdef TS2CPP_SCAN_X64
+static constexpr kernels sse2_kernels = { isa::sse2, skip_whitespace_sse2, find_char_sse2, find_comment_end_sse2 };
+static constexpr kernels avx2_kernels = { isa::avx2, skip_whitespace_avx2, find_char_avx2, find_comment_end_avx2 };
+#endif
+
+static const kernels* best_kernels() noexcept
+{
+#ifdef TS2CPP_SCAN_X64
+    return cpu_supports_avx2() ? &avx2_kernels : &sse2_kernels;
+#else
+    return &scalar_kernels;
+#endif
+}
+
+// NOTE: Picked on first use rather than by a dynamic initializer, so that scanning also works during the static
+// initialization of other translation units
+static const kernels*& selected() noexcept
+{
+    static const kernels* current = best_kernels();
+    return current;
+}
+
+const char* scan::skip_whitespace(const char* pos, const char* end) noexcept
+{
+    return selected()->skip_whitespace(pos, end);
+}
+
+const char* scan::find_char(const char* pos, const char* end, char ch) noexcept
+{
+    return selected()->find_char(pos, end, ch);
+}
+
+const char* scan::find_comment_end(const char* pos, const char* end) noexcept
+{
+    return selected()->find_comment_end(pos, end);
+}
+
+isa scan::current_isa() noexcept
+{
+    return selected()->kind;
+}
+
+bool scan::select_isa(isa value) noexcept
+{
+    switch (value)
+    {
+    case isa::scalar:
+        selected() = &scalar_kernels;
+        return true;
+
+#ifdef TS2CPP_SCAN_X64
+    case isa::sse2:
+        selected() = &sse2_kernels;
+        return true;
+
+    case isa::avx2:
+        if (!cpu_supports_avx2()) return false;
+        selected() = &avx2_kernels;
+        return true;
+#endif
+
+    default:
+        return false;
+    }
+}
+
+const char* scan::isa_name(isa value) noexcept
+{
+    switch (value)
+    {
+    case isa::scalar: return "scalar";
+    case isa::sse2: return "sse2";
+    case isa::avx2: return "avx2";
+    }
+
+    return "unknown";
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+// Helpers for skipping over the long runs of characters that the lexer doesn't care about (whitespace, comment bodies,
+// string contents). Where available these process 16 or 32 bytes at a time; the implementation is picked at runtime
+// based on what the CPU supports. All functions return 'end' if no match is found
+namespace scan
+{
+    enum class isa
+    {
+        scalar,
+        sse2,
+        avx2,
+    };
+
+    // Returns the first character in the range that is not whitespace
+    const char* skip_whitespace(const char* pos, const char* end) noexcept;
+
+    // Returns the first occurrence of 'ch' in the range
+    const char* find_char(const char* pos, const char* end, char ch) noexcept;
+
+    // Returns a pointer to the '*' of the first occurrence of "*/" in the range
+    const char* find_comment_end(const char* pos, const char* end) noexcept;
+
+    // The implementation currently in use. Selecting an implementation is mostly useful for benchmarking; it fails if
+    // the CPU does not support the requested instruction set
+    isa current_isa() noexcept;
+    bool select_isa(isa value) noexcept;
+    const char* isa_name(isa value) noexcept;
+}
@@ -0,0 +1,201 @@
+
+#include <cerrno>
+#include <cstring>
+
+#include "source.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+using native_handle = HANDLE;
+
+static bool read_some(native_handle handle, char* dest, std::size_t capacity, std::size_t& bytesRead)
+{
+    DWORD count = 0;
+    auto toRead = static_cast<DWORD>((capacity > MAXDWORD) ? MAXDWORD : capacity);
+    if (!::ReadFile(handle, dest, toRead, &count, nullptr))
+    {
+        // Reading from the end of a pipe is reported as an error
+        bytesRead = 0;
+        return ::GetLastError() == ERROR_BROKEN_PIPE;
+    }
+
+    bytesRead = count;
+    return true;
+}
+
+#else
+
+using native_handle = int;
+
+static bool read_some(native_handle fd, char* dest, std::size_t capacity, std::size_t& bytesRead)
+{
+    while (true)
+    {
+        auto count = ::read(fd, dest, capacity);
+        if (count >= 0)
+        {
+            bytesRead = static_cast<std::size_t>(count);
+            return true;
+        }
+        else if (errno != EINTR)
+        {
+            return false;
+        }
+    }
+}
+
+#endif
+
+// Fallback for when the input can't be mapped. We don't know the size up front, so read everything in as few calls as
+// possible, growing geometrically
+static bool read_all(native_handle handle, std::size_t sizeHint, std::unique_ptr<char[]>& buffer, std::size_t& size)
+{
+    std::size_t capacity = (sizeHint > 0) ? sizeHint : 64 * 1024;
+    buffer = std::make_unique<char[]>(capacity);
+    size = 0;
+
+    while (true)
+    {
+        if (size == capacity)
+        {
+            auto newCapacity = capacity * 2;
+            auto newBuffer = std::make_unique<char[]>(newCapacity);
+            std::memcpy(newBuffer.get(), buffer.get(), size);
+            buffer = std::move(newBuffer);
+            capacity = newCapacity;
+        }
+
+        std::size_t count;
+        if (!read_some(handle, buffer.get() + size, capacity - size, count))
+        {
+            return false;
+        }
+        else if (count == 0)
+        {
+            return true;
+        }
+
+        size += count;
+    }
+}
+
+bool source_buffer::open(const char* filename)
+{
+    close();
+
+#ifdef _WIN32
+    auto file = ::CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    bool result = false;
+    LARGE_INTEGER fileSize = {};
+    if ((::GetFileType(file) == FILE_TYPE_DISK) && ::GetFileSizeEx(file, &fileSize))
+    {
+        if (fileSize.QuadPart == 0)
+        {
+            // Empty files can't be mapped, but there's nothing to read either
+            result = true;
+        }
+        else if (auto mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr))
+        {
+            auto view = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            ::CloseHandle(mapping); // The view keeps the mapping alive
+            if (view)
+            {
+                data = static_cast<const char*>(view);
+                size = static_cast<std::size_t>(fileSize.QuadPart);
+                mapped = true;
+                result = true;
+            }
+        }
+    }
+
+    if (!result)
+    {
+        auto hint = static_cast<std::size_t>(fileSize.QuadPart);
+        result = read_all(file, hint, buffer, size);
+        data = buffer.get();
+    }
+
+    ::CloseHandle(file);
+#else
+    auto fd = ::open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    bool result = false;
+    struct stat info = {};
+    if ((::fstat(fd, &info) == 0) && S_ISREG(info.st_mode))
+    {
+        if (info.st_size == 0)
+        {
+            // Empty files can't be mapped, but there's nothing to read either
+            result = true;
+        }
+        else
+        {
+            auto len = static_cast<std::size_t>(info.st_size);
+            auto view = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view != MAP_FAILED)
+            {
+                // We scan the file front to back exactly once
+                ::madvise(view, len, MADV_SEQUENTIAL);
+                data = static_cast<const char*>(view);
+                size = len;
+                mapped = true;
+                result = true;
+            }
+        }
+    }
+
+    if (!result)
+    {
+        auto hint = S_ISREG(info.st_mode) ? static_cast<std::size_t>(info.st_size) : 0;
+        result = read_all(fd, hint, buffer, size);
+        data = buffer.get();
+    }
+
+    ::close(fd);
+#endif
+
+    if (!result)
+    {
+        close();
+    }
+
+    return result;
+}
+
+void source_buffer::close() noexcept
+{
+    if (mapped)
+    {
+#ifdef _WIN32
+        ::UnmapViewOfFile(data);
+#else
+        ::munmap(const_cast<char*>(data), size);
+#endif
+    }
+
+    data = nullptr;
+    size = 0;
+    mapped = false;
+    buffer.reset();
+}
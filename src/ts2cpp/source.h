@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+// Read-only view of the full contents of an input file. Regular files are memory mapped; anything that can't be mapped
+// (pipes, character devices, etc.) gets read into memory with a single bulk read
+struct source_buffer
+{
+    source_buffer() = default;
+    source_buffer(const source_buffer&) = delete;
+    source_buffer& operator=(const source_buffer&) = delete;
+    source_buffer(source_buffer&& other) noexcept { swap(other); }
+    source_buffer& operator=(source_buffer&& other) noexcept
+    {
+        source_buffer(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    ~source_buffer() { close(); }
+
+    bool open(const char* filename);
+    void close() noexcept;
+
+    std::string_view text() const noexcept
+    {
+        return std::string_view(data, size);
+    }
+
+    void swap(source_buffer& other) noexcept
+    {
+        std::swap(data, other.data);
+        std::swap(size, other.size);
+        std::swap(mapped, other.mapped);
+        std::swap(buffer, other.buffer);
+    }
+
+    const char* data = nullptr;
+    std::size_t size = 0;
+    bool mapped = false;
+
+    // Only used when the file could not be mapped
+    std::unique_ptr<char[]> buffer;
+};
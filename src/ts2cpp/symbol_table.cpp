@@ -0,0 +1,35 @@
+
+#include <cstring>
+
+#include "symbol_table.h"
+
+using namespace ast;
+
+symbol_table::symbol_table(ts2cpp::arena& storage) : storage(storage)
+{
+    // Index zero is always the empty string so that a default constructed symbol is meaningful
+    strings.push_back(store({}));
+    lookup.emplace(strings.back(), symbol{});
+}
+
+symbol symbol_table::intern(std::string_view str)
+{
+    if (auto itr = lookup.find(str); itr != lookup.end())
+    {
+        return itr->second;
+    }
+
+    auto result = static_cast<symbol>(strings.size());
+    std::string_view stored(store(str), str.size());
+    strings.push_back(stored);
+    lookup.emplace(stored, result);
+    return result;
+}
+
+const char* symbol_table::store(std::string_view str)
+{
+    auto result = storage.allocate_array<char>(str.size() + 1); // +1 for the null terminator
+    if (!str.empty()) std::memcpy(result, str.data(), str.size());
+    result[str.size()] = '\0';
+    return result;
+}
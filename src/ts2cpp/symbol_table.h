@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <arena.h>
+
+namespace ast
+{
+    // Handle to a string interned in a 'symbol_table'. Two symbols from the same table are equal if and only if their
+    // strings are equal. The default value refers to the empty string
+    enum class symbol : std::uint32_t {};
+
+    struct symbol_table
+    {
+        symbol_table(ts2cpp::arena& storage);
+        symbol_table(const symbol_table&) = delete;
+        symbol_table& operator=(const symbol_table&) = delete;
+
+        symbol intern(std::string_view str);
+
+        // Returns the symbol for 'str' if it has already been interned, otherwise nullptr
+        const symbol* find(std::string_view str) const
+        {
+            auto itr = lookup.find(str);
+            return (itr == lookup.end()) ? nullptr : &itr->second;
+        }
+
+        std::string_view operator[](symbol sym) const noexcept
+        {
+            return strings[static_cast<std::size_t>(sym)];
+        }
+
+        // Interned strings are always null terminated, so they can be handed directly to printf and friends
+        const char* c_str(symbol sym) const noexcept
+        {
+            return strings[static_cast<std::size_t>(sym)].data();
+        }
+
+        std::size_t size() const noexcept
+        {
+            return strings.size();
+        }
+
+        std::vector<std::string_view> strings;
+        std::unordered_map<std::string_view, symbol> lookup;
+
+    private:
+        const char* store(std::string_view str);
+
+        // Backing storage for the string data
+        ts2cpp::arena& storage;
+    };
+}
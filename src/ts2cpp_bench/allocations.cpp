@@ -0,0 +1,75 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "allocations.h"
+
+// Kept in a translation unit of their own, so that the compiler doesn't inline the replacements into code that uses
+// 'new' and mistake the 'std::free' for a mismatched deallocation
+static std::atomic<std::uint64_t> allocation_count{ 0 };
+static std::atomic<std::uint64_t> allocation_bytes{ 0 };
+
+void* operator new(std::size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (auto ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+allocation_totals current_allocations() noexcept
+{
+    return { allocation_count.load(std::memory_order_relaxed), allocation_bytes.load(std::memory_order_relaxed) };
+}
+
+std::uint64_t peak_rss_bytes() noexcept
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters = {};
+    counters.cb = sizeof(counters);
+    if (!::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage = {};
+    if (::getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<std::uint64_t>(usage.ru_maxrss); // Bytes on macOS, kilobytes elsewhere
+#else
+    return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
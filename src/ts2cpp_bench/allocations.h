@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+// Totals for every allocation the process has made through 'operator new', which allocations.cpp replaces so that each
+// stage of the benchmark can report how much it allocated
+struct allocation_totals
+{
+    std::uint64_t count;
+    std::uint64_t bytes;
+};
+
+allocation_totals current_allocations() noexcept;
+
+// Highest resident set size the process has reached so far
+std::uint64_t peak_rss_bytes() noexcept;
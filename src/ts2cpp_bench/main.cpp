@@ -0,0 +1,405 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <json_encode.h>
+#include <json_parse.h>
+
+#include "allocations.h"
+#include "generator.h"
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "scan.h"
+#include "source.h"
+#include "synthetic.h"
+
+namespace
+{
+    struct stage_result
+    {
+        std::string name; // E.g. "lex/avx2"
+        double seconds = 0; // Best of the repetitions
+        std::size_t input_bytes = 0;
+        std::size_t tokens = 0; // Zero if the stage doesn't deal in tokens
+        std::uint64_t allocations = 0; // In one repetition
+        std::uint64_t allocated_bytes = 0;
+        std::uint64_t peak_rss = 0; // Of the process once the stage is done
+
+        double mb_per_second() const { return static_cast<double>(input_bytes) / (1024.0 * 1024.0) / seconds; }
+        double tokens_per_second() const { return static_cast<double>(tokens) / seconds; }
+    };
+
+    struct bench_options
+    {
+        synthetic_options synthetic;
+        std::string input; // Benchmark this file rather than a synthetic schema
+        std::string write_path; // Where to save the synthetic schema, if anywhere
+        std::string json_path; // Where to write the results as JSON, if anywhere
+        std::string baseline_path; // Results to compare against, if any
+        std::string stages = "lex,parse,resolve,codegen"; // Which stages to time
+        double tolerance = 0.10; // How much slower than the baseline a stage may be
+        int repeat = 3;
+
+        bool wants(std::string_view stage) const
+        {
+            std::string_view list = stages;
+            while (!list.empty())
+            {
+                auto end = std::min(list.find(','), list.size());
+                if (list.substr(0, end) == stage) return true;
+                list.remove_prefix(std::min(end + 1, list.size()));
+            }
+            return false;
+        }
+    };
+
+    // Times one repetition of 'func', along with what it allocates
+    template <typename Func>
+    void measure(stage_result& result, bool first, Func&& func)
+    {
+        auto before = current_allocations();
+        auto start = std::chrono::steady_clock::now();
+        func();
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (first)
+        {
+            result.seconds = seconds;
+            auto after = current_allocations();
+            result.allocations = after.count - before.count;
+            result.allocated_bytes = after.bytes - before.bytes;
+        }
+        else
+        {
+            result.seconds = std::min(result.seconds, seconds);
+        }
+    }
+}
+
+static bool count_tokens(std::string_view text, std::size_t& tokens)
+{
+    diagnostics diag;
+    ast::file file;
+    lexer lex(text, &file, diag);
+    tokens = 1;
+    while (lex)
+    {
+        lex.advance();
+        ++tokens;
+    }
+
+    if (lex.current_token != token::eof)
+    {
+        std::printf("ERROR: Lexing failed\n%s", diag.text.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+static bool run_stages(std::string_view text, const bench_options& options, std::vector<stage_result>& results)
+{
+    // Lexing, once with each implementation of the scanning helpers that the CPU supports
+    std::size_t tokens = 0;
+    auto defaultIsa = scan::current_isa();
+    for (auto isa : { scan::isa::scalar, scan::isa::sse2, scan::isa::avx2 })
+    {
+        if (!options.wants("lex") || !scan::select_isa(isa)) continue;
+
+        stage_result result;
+        result.name = std::string("lex/") + scan::isa_name(isa);
+        result.input_bytes = text.size();
+        for (int i = 0; i < options.repeat; ++i)
+        {
+            bool succeeded = true;
+            measure(result, i == 0, [&] { succeeded = count_tokens(text, tokens); });
+            if (!succeeded) return false;
+        }
+
+        result.tokens = tokens;
+        result.peak_rss = peak_rss_bytes();
+        results.push_back(std::move(result));
+    }
+    scan::select_isa(defaultIsa);
+
+    // Parsing and resolving. Resolving modifies the file, so each repetition needs a fresh one. Code generation needs a
+    // resolved file, so they run (though aren't reported) even if it's the only stage asked for
+    bool codegen = options.wants("codegen");
+    if (!options.wants("parse") && !options.wants("resolve") && !codegen) return true;
+
+    stage_result parse{ "parse" }, resolve{ "resolve" };
+    parse.input_bytes = resolve.input_bytes = text.size();
+    parse.tokens = tokens;
+    std::unique_ptr<ast::file> file;
+    for (int i = 0; i < options.repeat; ++i)
+    {
+        file.reset();
+        diagnostics diag;
+        measure(parse, i == 0, [&] { file = parse_file(text, diag); });
+        if (!file)
+        {
+            std::printf("ERROR: Parsing failed\n%s", diag.text.c_str());
+            return false;
+        }
+        parse.peak_rss = peak_rss_bytes();
+
+        bool resolved = false;
+        measure(resolve, i == 0, [&] { resolved = resolve_file(*file, diag); });
+        if (!resolved)
+        {
+            std::printf("ERROR: Resolving failed\n%s", diag.text.c_str());
+            return false;
+        }
+        resolve.peak_rss = peak_rss_bytes();
+    }
+    if (options.wants("parse")) results.push_back(std::move(parse));
+    if (options.wants("resolve")) results.push_back(std::move(resolve));
+    if (!codegen) return true;
+
+    // Generating the header from the last file that was parsed and resolved
+    stage_result generate{ "codegen" };
+    generate.input_bytes = text.size();
+    for (int i = 0; i < options.repeat; ++i)
+    {
+        std::string header;
+        diagnostics diag;
+        bool generated = false;
+        measure(generate, i == 0, [&] { generated = generate_header(*file, "synthetic.ts", {}, header, diag); });
+        if (!generated)
+        {
+            std::printf("ERROR: Generating the header failed\n%s", diag.text.c_str());
+            return false;
+        }
+    }
+    generate.peak_rss = peak_rss_bytes();
+    results.push_back(std::move(generate));
+    return true;
+}
+
+static json::value to_json(const bench_options& options, std::size_t inputSize,
+    const std::vector<stage_result>& results)
+{
+    json::object_t input;
+    if (options.input.empty())
+    {
+        auto& synthetic = options.synthetic;
+        input["seed"] = synthetic.seed;
+        input["comment_density"] = synthetic.comment_density;
+        input["comment_length"] = synthetic.comment_length;
+        input["nesting_depth"] = synthetic.nesting_depth;
+        input["enum_width"] = synthetic.enum_width;
+        input["extends_depth"] = synthetic.extends_depth;
+        input["members_per_interface"] = synthetic.members_per_interface;
+        input["interfaces_per_module"] = synthetic.interfaces_per_module;
+    }
+    else
+    {
+        input["file"] = options.input;
+    }
+    input["bytes"] = inputSize;
+
+    json::array_t<> stages;
+    for (auto& result : results)
+    {
+        json::object_t stage;
+        stage["name"] = result.name;
+        stage["seconds"] = result.seconds;
+        stage["mb_per_second"] = result.mb_per_second();
+        if (result.tokens) stage["tokens_per_second"] = result.tokens_per_second();
+        stage["allocations"] = result.allocations;
+        stage["allocated_bytes"] = result.allocated_bytes;
+        stage["peak_rss_bytes"] = result.peak_rss;
+        stages.push_back(std::move(stage));
+    }
+
+    json::object_t root;
+    root["input"] = std::move(input);
+    root["stages"] = std::move(stages);
+    return root;
+}
+
+// Prints each stage whose throughput dropped by more than the tolerance since the baseline. Returns false if any did
+static bool compare_baseline(const bench_options& options, const std::vector<stage_result>& results)
+{
+    source_buffer text;
+    if (!text.open(options.baseline_path.c_str()))
+    {
+        std::printf("ERROR: Failed to open baseline '%s'\n", options.baseline_path.c_str());
+        return false;
+    }
+
+    json::parser parser;
+    json::value baseline;
+    if (!parser.parse(text.text(), baseline) || (baseline.type() != json::value_type::object))
+    {
+        std::printf("ERROR: Failed to parse baseline '%s'\n", options.baseline_path.c_str());
+        return false;
+    }
+
+    bool result = true;
+    auto stages = baseline.try_get("stages");
+    for (auto& current : results)
+    {
+        const json::value* previous = nullptr;
+        if (stages && (stages->type() == json::value_type::array))
+        {
+            for (auto& stage : stages->array())
+            {
+                auto name = stage.try_get("name");
+                if (name && (name->type() == json::value_type::string) && (name->string() == current.name))
+                {
+                    previous = stage.try_get("mb_per_second");
+                }
+            }
+        }
+
+        if (!previous || (previous->type() != json::value_type::number))
+        {
+            std::printf("NOTE: No baseline for stage '%s'\n", current.name.c_str());
+            continue;
+        }
+
+        auto change = current.mb_per_second() / previous->number() - 1;
+        if (change < -options.tolerance)
+        {
+            std::printf("ERROR: Stage '%s' regressed by %.1f%% (%.1f MB/s, baseline %.1f MB/s)\n", current.name.c_str(),
+                -change * 100, current.mb_per_second(), previous->number());
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+static void print_usage()
+{
+    std::printf("USAGE: ts2cpp_bench [options]\n");
+    std::printf("    Times lexing (with each scanning implementation the CPU supports), parsing, resolving, and\n");
+    std::printf("    code generation on a synthetic schema, or on an existing file\n");
+    std::printf("    --size <MB>             Size of the synthetic schema (default 16)\n");
+    std::printf("    --seed <n>              Seed for the synthetic schema (default 1)\n");
+    std::printf("    --comments <0-1>        Chance that a member or interface has a doc comment (default 0.5)\n");
+    std::printf("    --comment-length <n>    Average characters per comment (default 80)\n");
+    std::printf("    --nesting <n>           Depth of inline objects within each other (default 2)\n");
+    std::printf("    --enum-width <n>        Values in each string literal union (default 8)\n");
+    std::printf("    --extends <n>           Length of chains of interfaces that extend each other (default 4)\n");
+    std::printf("    --input <path>          Benchmark this file instead of a synthetic schema\n");
+    std::printf("    --write <path>          Save the synthetic schema\n");
+    std::printf("    --stages <list>         Comma separated stages to time (default lex,parse,resolve,codegen)\n");
+    std::printf("    --repeat <n>            Repetitions of each stage; the fastest is reported (default 3)\n");
+    std::printf("    --json <path>           Write the results as JSON\n");
+    std::printf("    --baseline <path>       Compare against results written by --json, failing if any stage is\n");
+    std::printf("                            slower by more than the tolerance\n");
+    std::printf("    --tolerance <percent>   Allowed slowdown against the baseline (default 10)\n");
+}
+
+int main(int argc, char** argv)
+{
+    bench_options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if ((arg == "-h") || (arg == "--help"))
+        {
+            print_usage();
+            return 0;
+        }
+        else if (i + 1 == argc)
+        {
+            print_usage();
+            return 1;
+        }
+
+        const char* param = argv[++i];
+        auto& synthetic = options.synthetic;
+        if (arg == "--size") synthetic.target_size = static_cast<std::size_t>(std::strtod(param, nullptr) * 1048576);
+        else if (arg == "--seed") synthetic.seed = static_cast<std::uint32_t>(std::strtoul(param, nullptr, 10));
+        else if (arg == "--comments") synthetic.comment_density = std::strtod(param, nullptr);
+        else if (arg == "--comment-length") synthetic.comment_length = std::strtoul(param, nullptr, 10);
+        else if (arg == "--nesting") synthetic.nesting_depth = std::atoi(param);
+        else if (arg == "--enum-width") synthetic.enum_width = std::max(1, std::atoi(param));
+        else if (arg == "--extends") synthetic.extends_depth = std::max(1, std::atoi(param));
+        else if (arg == "--input") options.input = param;
+        else if (arg == "--write") options.write_path = param;
+        else if (arg == "--stages") options.stages = param;
+        else if (arg == "--repeat") options.repeat = std::max(1, std::atoi(param));
+        else if (arg == "--json") options.json_path = param;
+        else if (arg == "--baseline") options.baseline_path = param;
+        else if (arg == "--tolerance") options.tolerance = std::strtod(param, nullptr) / 100;
+        else
+        {
+            print_usage();
+            return 1;
+        }
+    }
+
+    std::string synthetic;
+    source_buffer file;
+    std::string_view text;
+    if (!options.input.empty())
+    {
+        if (!file.open(options.input.c_str()))
+        {
+            std::printf("ERROR: Failed to open file '%s'\n", options.input.c_str());
+            return 1;
+        }
+        text = file.text();
+    }
+    else
+    {
+        generate_synthetic(options.synthetic, synthetic);
+        text = synthetic;
+
+        if (!options.write_path.empty())
+        {
+            std::ofstream stream(options.write_path, std::ios::binary | std::ios::trunc);
+            stream.write(synthetic.data(), static_cast<std::streamsize>(synthetic.size()));
+            if (!stream.good())
+            {
+                std::printf("ERROR: Failed to write output file '%s'\n", options.write_path.c_str());
+                return 1;
+            }
+        }
+    }
+
+    std::vector<stage_result> results;
+    if (!run_stages(text, options, results)) return 1;
+
+    std::printf("Input: %.1f MB\n", static_cast<double>(text.size()) / (1024 * 1024));
+    std::printf("%-12s %10s %10s %12s %12s %12s %12s\n", "stage", "ms", "MB/s", "Mtokens/s", "allocs", "alloc MB",
+        "peak RSS MB");
+    for (auto& result : results)
+    {
+        char tokens[32] = "-";
+        if (result.tokens) std::snprintf(tokens, sizeof(tokens), "%.2f", result.tokens_per_second() / 1e6);
+        std::printf("%-12s %10.1f %10.1f %12s %12llu %12.1f %12.1f\n", result.name.c_str(), result.seconds * 1000,
+            result.mb_per_second(), tokens, static_cast<unsigned long long>(result.allocations),
+            static_cast<double>(result.allocated_bytes) / (1024 * 1024),
+            static_cast<double>(result.peak_rss) / (1024 * 1024));
+    }
+
+    if (!options.json_path.empty())
+    {
+        std::string output;
+        json::encode(to_json(options, text.size(), results), output);
+        output += '\n';
+
+        std::ofstream stream(options.json_path, std::ios::binary | std::ios::trunc);
+        stream.write(output.data(), static_cast<std::streamsize>(output.size()));
+        if (!stream.good())
+        {
+            std::printf("ERROR: Failed to write output file '%s'\n", options.json_path.c_str());
+            return 1;
+        }
+    }
+
+    if (!options.baseline_path.empty() && !compare_baseline(options, results)) return 1;
+    return 0;
+}
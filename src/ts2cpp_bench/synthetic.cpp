@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <string>
+
+#include "synthetic.h"
+
+namespace
+{
+    // std::mt19937 would do, but the distributions layered on top of it differ between standard libraries, and the
+    // output needs to be the same everywhere so that results can be compared
+    struct random_engine
+    {
+        std::uint64_t state;
+
+        std::uint64_t next() noexcept
+        {
+            // splitmix64
+            auto z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        std::size_t below(std::size_t limit) noexcept
+        {
+            return static_cast<std::size_t>(next() % limit);
+        }
+
+        bool chance(double probability) noexcept
+        {
+            return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0) < probability;
+        }
+    };
+
+    const char* const words[] = {
+        "thread", "frame", "source", "line", "column", "variable", "scope", "module", "breakpoint", "address",
+        "condition", "expression", "result", "value", "format", "process", "memory", "offset", "count", "name",
+        "path", "reference", "category", "output", "reason", "description", "exception", "checksum", "target",
+        "instruction", "location", "presentation", "hint", "kind", "label", "detail", "filter", "step",
+    };
+    constexpr std::size_t word_count = sizeof(words) / sizeof(words[0]);
+
+    struct writer
+    {
+        const synthetic_options& options;
+        std::string& out;
+        random_engine rng;
+
+        void indent(int level)
+        {
+            out.append(static_cast<std::size_t>(level) * 4, ' ');
+        }
+
+        // Mostly '/** ... */' doc comments, wrapped like the ones in proto.ts, with the odd run of '//' lines
+        void comment(int level, bool integer)
+        {
+            auto length = options.comment_length / 2 + rng.below(options.comment_length + 1);
+            bool lineComments = rng.chance(0.2);
+            std::size_t lineLength = 0;
+
+            indent(level);
+            out += lineComments ? "// " : "/** ";
+            for (std::size_t written = 0; written < length; )
+            {
+                std::string_view word = words[rng.below(word_count)];
+                if (lineLength + word.size() > 80)
+                {
+                    out += '\n';
+                    indent(level);
+                    out += lineComments ? "// " : "    ";
+                    lineLength = 0;
+                }
+
+                out += word;
+                out += ' ';
+                lineLength += word.size() + 1;
+                written += word.size() + 1;
+            }
+
+            if (integer) out += "@integer ";
+            out += lineComments ? "\n" : "*/\n";
+        }
+
+        void enumeration(const std::string& prefix)
+        {
+            for (int i = 0; i < options.enum_width; ++i)
+            {
+                if (i > 0) out += " | ";
+                out += '\'';
+                out += prefix;
+                out += words[static_cast<std::size_t>(i) % word_count];
+                out += std::to_string(i);
+                out += '\'';
+            }
+        }
+
+        // Writes a member's type, which is most often one of the simple ones
+        void type(int level, int depth, std::size_t index, std::size_t moduleIndex, bool& integer)
+        {
+            switch (rng.below(12))
+            {
+            case 0:
+            case 1:
+                integer = rng.chance(0.5);
+                out += "number";
+                break;
+            case 2:
+            case 3:
+                out += "string";
+                break;
+            case 4:
+                out += "boolean";
+                break;
+            case 5:
+                out += rng.chance(0.5) ? "string[]" : "number[]";
+                break;
+            case 6:
+                enumeration("");
+                break;
+            case 7:
+                if (depth < options.nesting_depth)
+                {
+                    object(level, depth + 1, index, moduleIndex);
+                }
+                else
+                {
+                    out += "any";
+                }
+                break;
+            case 8:
+                if (index > 0)
+                {
+                    out += "Type" + std::to_string(rng.below(index));
+                    if (rng.chance(0.5)) out += " | null";
+                }
+                else
+                {
+                    out += "string | null";
+                }
+                break;
+            case 9:
+                out += "{ [key: string]: ";
+                out += rng.chance(0.5) ? "string" : "number";
+                out += "; }";
+                break;
+            case 10:
+                out += "Kind" + std::to_string(moduleIndex);
+                break;
+            default:
+                out += "any";
+                break;
+            }
+        }
+
+        void member(int level, int depth, const std::string& suffix, std::size_t index, std::size_t moduleIndex)
+        {
+            auto comment = options.comment_density > 0 && rng.chance(options.comment_density);
+            std::string body;
+            bool integer = false;
+            {
+                // The type is written first so that a comment can say whether it holds integers
+                auto start = out.size();
+                type(level, depth, index, moduleIndex, integer);
+                body = out.substr(start);
+                out.resize(start);
+            }
+
+            if (comment) this->comment(level, integer);
+            else if (integer)
+            {
+                indent(level);
+                out += "/** @integer */\n";
+            }
+
+            indent(level);
+            out += words[rng.below(word_count)];
+            out += suffix;
+            if (rng.chance(0.3)) out += '?';
+            out += ": ";
+            out += body;
+            out += ";\n";
+        }
+
+        void object(int level, int depth, std::size_t index, std::size_t moduleIndex)
+        {
+            out += "{\n";
+            auto count = std::max(1, options.members_per_interface / 2);
+            for (int i = 0; i < count; ++i)
+            {
+                member(level + 1, depth, std::to_string(i), index, moduleIndex);
+            }
+            indent(level);
+            out += '}';
+        }
+
+        void interface(std::size_t index, std::size_t moduleIndex)
+        {
+            if (options.comment_density > 0 && rng.chance(options.comment_density)) comment(1, false);
+
+            out += "    export interface Type" + std::to_string(index);
+            auto chainLength = static_cast<std::size_t>(std::max(1, options.extends_depth));
+            auto chainPosition = index % chainLength;
+            if (chainPosition != 0) out += " extends Type" + std::to_string(index - 1);
+            out += " {\n";
+
+            // Member names are unique along each chain, since a derived interface can't redeclare a member
+            for (int i = 0; i < options.members_per_interface; ++i)
+            {
+                auto suffix = std::to_string(chainPosition * static_cast<std::size_t>(options.members_per_interface) +
+                    static_cast<std::size_t>(i));
+                member(2, 0, suffix, index, moduleIndex);
+            }
+            out += "    }\n\n";
+        }
+
+        void module(std::size_t moduleIndex)
+        {
+            out += "export module Module" + std::to_string(moduleIndex) + " {\n\n";
+            out += "    export type Kind" + std::to_string(moduleIndex) + " = ";
+            enumeration("kind");
+            out += ";\n\n";
+
+            for (int i = 0; i < options.interfaces_per_module; ++i)
+            {
+                interface(static_cast<std::size_t>(i), moduleIndex);
+            }
+            out += "}\n\n";
+        }
+    };
+}
+
+void generate_synthetic(const synthetic_options& options, std::string& output)
+{
+    // Output runs a little past the target to finish the module, and reallocating a string of hundreds of MB would
+    // double the peak memory that the benchmark reports
+    output.reserve(output.size() + options.target_size + 4 * 1024 * 1024);
+
+    writer w{ options, output, random_engine{ options.seed } };
+    output += "/*---------------------------------------------------------------------------------------------\n";
+    output += " *  Synthetic schema generated by ts2cpp_bench\n";
+    output += " *--------------------------------------------------------------------------------------------*/\n\n";
+    output += "'use strict';\n\n";
+
+    auto start = output.size();
+    for (std::size_t moduleIndex = 0; output.size() - start < options.target_size; ++moduleIndex)
+    {
+        w.module(moduleIndex);
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Shape of the TypeScript that 'generate_synthetic' writes. Interfaces are spread over modules, and each one is made up
+// of members of every kind that ts2cpp handles, so that scaling up the size scales up every path through the frontend
+struct synthetic_options
+{
+    std::size_t target_size = 16 * 1024 * 1024; // Bytes; output stops at the first module boundary past this
+    std::uint32_t seed = 1;
+
+    double comment_density = 0.5; // Chance that a member or interface gets a doc comment
+    std::size_t comment_length = 80; // Average characters per comment
+
+    int nesting_depth = 2; // Of inline '{ ... }' objects within each other
+    int enum_width = 8; // Values in each string literal union
+    int extends_depth = 4; // Length of each chain of interfaces that extend the one before
+
+    int members_per_interface = 8;
+    int interfaces_per_module = 200;
+};
+
+// Appends a synthetic schema to 'output'. The same options always give the same text
+void generate_synthetic(const synthetic_options& options, std::string& output);
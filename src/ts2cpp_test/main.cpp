@@ -0,0 +1,186 @@
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ast.h"
+#include "diagnostics.h"
+#include "lexer.h"
+#include "scan.h"
+
+static int failures = 0;
+
+static void fail(const char* check, scan::isa isa, std::string_view input, const std::string& detail)
+{
+    std::printf("FAILED: %s (%s)\n    input: %.*s\n    %s\n", check, scan::isa_name(isa),
+        static_cast<int>(input.size()), input.data(), detail.c_str());
+    ++failures;
+}
+
+namespace
+{
+    constexpr scan::isa vector_isas[] = { scan::isa::sse2, scan::isa::avx2 };
+
+    // A copy of 'text' in a heap block of exactly its size, so that the sanitizers catch any read past the end
+    struct exact_buffer
+    {
+        explicit exact_buffer(std::string_view text) : data(new char[text.size() ? text.size() : 1]), size(text.size())
+        {
+            text.copy(data.get(), size);
+        }
+
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+    };
+
+    // Where each scanning function stops from each starting offset, as offsets from the start of 'text'
+    std::vector<std::size_t> scan_offsets(std::string_view text)
+    {
+        exact_buffer buffer(text);
+        auto begin = buffer.data.get(), end = begin + buffer.size;
+        std::vector<std::size_t> result;
+        for (auto pos = begin; pos <= end; ++pos)
+        {
+            result.push_back(static_cast<std::size_t>(scan::skip_whitespace(pos, end) - begin));
+            result.push_back(static_cast<std::size_t>(scan::find_char(pos, end, '"') - begin));
+            result.push_back(static_cast<std::size_t>(scan::find_char(pos, end, '\n') - begin));
+            result.push_back(static_cast<std::size_t>(scan::find_comment_end(pos, end) - begin));
+        }
+        return result;
+    }
+
+    // Inputs where what the scanners look for falls on either side of the 16 and 32 byte block edges, for each
+    // starting offset. Also bytes above 0x7F, which signed comparisons could mistake for whitespace or the target
+    std::vector<std::string> scan_inputs()
+    {
+        std::vector<std::string> inputs = { "", " ", "*", "*/", "\"", "\n" };
+        for (std::size_t length : { 15, 16, 17, 31, 32, 33, 47, 48, 63, 64, 65, 100 })
+        {
+            for (std::size_t at = 0; at < length; ++at)
+            {
+                std::string spaces(length, ' ');
+                spaces[at] = 'x';
+                inputs.push_back(spaces);
+
+                std::string mixed(length, '\t');
+                for (std::size_t i = 0; i < length; i += 3) mixed[i] = "\r\n\f\v "[i % 5];
+                mixed[at] = '"';
+                inputs.push_back(mixed);
+
+                // A '*' that ends a block with its '/' at the start of the next, after '*'s that aren't followed by '/'
+                std::string comment(length, 'c');
+                for (std::size_t i = 0; i < at; i += 4) comment[i] = '*';
+                comment[at] = '*';
+                if (at + 1 < length) comment[at + 1] = '/';
+                inputs.push_back(comment);
+
+                std::string high(length, '\xA0');
+                high[at] = '\n';
+                inputs.push_back(high);
+            }
+        }
+        return inputs;
+    }
+
+    void check_scanners(const std::vector<scan::isa>& isas)
+    {
+        for (auto& input : scan_inputs())
+        {
+            scan::select_isa(scan::isa::scalar);
+            auto expected = scan_offsets(input);
+            for (auto isa : isas)
+            {
+                scan::select_isa(isa);
+                if (scan_offsets(input) != expected) fail("scanners match scalar", isa, input, "stopped elsewhere");
+            }
+        }
+    }
+
+    // Kind, offset and length of each token, and any diagnostics
+    std::string tokens_of(std::string_view text)
+    {
+        exact_buffer buffer(text);
+        diagnostics diag;
+        ast::file file;
+        lexer lex(std::string_view(buffer.data.get(), buffer.size), &file, diag);
+        std::string result;
+        while (true)
+        {
+            result += std::to_string(static_cast<int>(lex.current_token)) + "@" +
+                std::to_string(lex.string_value.data() - buffer.data.get()) + "+" +
+                std::to_string(lex.string_value.size()) + (lex.integer_annotation ? "i " : " ");
+            if (!lex) break;
+            lex.advance();
+        }
+        return result + std::to_string(lex.discriminators.size()) + " " + diag.text;
+    }
+
+    // Comments, strings with escapes, and runs of whitespace, shifted along a byte at a time so that each part crosses
+    // the block edges somewhere
+    void check_lexer(const std::vector<scan::isa>& isas)
+    {
+        constexpr std::string_view body =
+            "export interface Foo extends Bar {\n"
+            "    // command: 'initialize';\n"
+            "    /** A comment with * and / and ** / and \\* but only one end, and @integer */\n"
+            "    value: number;\t\t\r\n"
+            "    name: \"a \\\" string with \\\\ escapes \\n and a ' quote\";\n"
+            "    /* short */ kind: 'a' | 'b' | \"\";\n"
+            "    /***/ /**//***//* * / */ empty?: null;\n"
+            "}\n";
+        constexpr std::string_view unterminated[] = {
+            "/* never ends * / *",
+            "\"never ends '",
+            "// at the end of the file",
+        };
+
+        std::vector<std::string> inputs;
+        for (std::size_t shift = 0; shift <= 64; ++shift)
+        {
+            inputs.push_back(std::string(shift, ' ') + std::string(body));
+            inputs.push_back(std::string(shift, '\n') + std::string(body) + std::string(shift, '\t'));
+            for (auto tail : unterminated) inputs.push_back(std::string(shift, ' ') + "x " + std::string(tail));
+        }
+
+        for (auto& input : inputs)
+        {
+            scan::select_isa(scan::isa::scalar);
+            auto expected = tokens_of(input);
+            for (auto isa : isas)
+            {
+                scan::select_isa(isa);
+                auto actual = tokens_of(input);
+                if (actual != expected)
+                {
+                    fail("lexer matches scalar", isa, input, "gave " + actual + "\n    expected " + expected);
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    // Only what this CPU supports; the scalar kernels are the reference
+    std::vector<scan::isa> isas;
+    auto defaultIsa = scan::current_isa();
+    for (auto isa : vector_isas)
+    {
+        if (scan::select_isa(isa)) isas.push_back(isa);
+        else std::printf("NOTE: %s isn't supported here, so it isn't checked\n", scan::isa_name(isa));
+    }
+    scan::select_isa(defaultIsa);
+
+    check_scanners(isas);
+    check_lexer(isas);
+
+    if (failures)
+    {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+
+    std::printf("All checks passed\n");
+    return 0;
+}